@@ -59,7 +59,6 @@ t_pppClient::t_pppClient(const t_pppOptions* opt) {
   _log      = new ostringstream();
   _ephUser  = new bncEphUser(false);
   _pppUtils = new t_pppUtils();
-  _newEph = 0;
 }
 
 // Destructor
@@ -71,8 +70,6 @@ t_pppClient::~t_pppClient() {
   delete _ephUser;
   delete _log;
   delete _pppUtils;
-  if (_newEph)
-    delete _newEph;
 }
 
 //
@@ -86,23 +83,16 @@ void t_pppClient::processEpoch(const vector<t_satObs*>& satObs, t_output* output
     const t_satObs* obs     = satObs[ii];
     t_prn prn = obs->_prn;
     if (prn.system() == 'E') {prn.setFlags(1);} // force I/NAV usage
-    t_satData*   satData = new t_satData();
+    t_satData*   satData = _epoData->insert(prn);
+    if (!satData) {
+      continue;
+    }
 
     if (_epoData->tt.undef()) {
       _epoData->tt = obs->_time;
     }
 
     satData->tt       = obs->_time;
-    satData->prn      = QString(prn.toInternalString().c_str());
-    satData->slipFlag = false;
-    satData->P1       = 0.0;
-    satData->P2       = 0.0;
-    satData->P5       = 0.0;
-    satData->P7       = 0.0;
-    satData->L1       = 0.0;
-    satData->L2       = 0.0;
-    satData->L5       = 0.0;
-    satData->L7       = 0.0;
     for (unsigned ifrq = 0; ifrq < obs->_obs.size(); ifrq++) {
       t_frqObs* frqObs = obs->_obs[ifrq];
       double cb = 0.0;
@@ -142,18 +132,12 @@ void t_pppClient::processEpoch(const vector<t_satObs*>& satObs, t_output* output
 
   // Data Pre-Processing
   // -------------------
-  QMutableMapIterator<QString, t_satData*> it(_epoData->satData);
+  t_epoData::t_iterator it(_epoData);
   while (it.hasNext()) {
-    it.next();
-    QString    prn     = it.key();
-    t_satData* satData = it.value();
-
+    t_satData* satData = it.next();
     if (cmpToT(satData) != success) {
-      delete satData;
-      it.remove();
-      continue;
+      _epoData->remove(satData);
     }
-
   }
 
   // Filter Solution
@@ -204,10 +188,9 @@ void t_pppClient::putNewObs(t_satData* satData) {
       satData->lambda3 = a1 * t_CST::c / f1 + a2 * t_CST::c / f2;
       satData->lkA     = a1;
       satData->lkB     = a2;
-      _epoData->satData[satData->prn] = satData;
     }
     else {
-      delete satData;
+      _epoData->remove(satData);
     }
   }
 
@@ -219,12 +202,12 @@ void t_pppClient::putNewObs(t_satData* satData) {
 
       int channel = 0;
       if (satData->system() == 'R') {
-        const t_eph* eph = _ephUser->ephLast(satData->prn);
+        QSharedPointer<const t_eph> eph = _ephUser->ephLast(satData->prn);
         if (eph) {
           channel = eph->slotNum();
         }
         else {
-          delete satData;
+          _epoData->remove(satData);
           return;
         }
       }
@@ -242,10 +225,9 @@ void t_pppClient::putNewObs(t_satData* satData) {
       satData->lambda3 = a1 * t_CST::c / f1 + a2 * t_CST::c / f2;
       satData->lkA     = a1;
       satData->lkB     = a2;
-      _epoData->satData[satData->prn] = satData;
     }
     else {
-      delete satData;
+      _epoData->remove(satData);
     }
   }
 
@@ -265,10 +247,9 @@ void t_pppClient::putNewObs(t_satData* satData) {
       satData->lambda3 = a1 * t_CST::c / f1 + a5 * t_CST::c / f5;
       satData->lkA     = a1;
       satData->lkB     = a5;
-      _epoData->satData[satData->prn] = satData;
     }
     else {
-      delete satData;
+      _epoData->remove(satData);
     }
   }
 
@@ -288,29 +269,43 @@ void t_pppClient::putNewObs(t_satData* satData) {
       satData->lambda3 = a2 * t_CST::c / f2 + a7 * t_CST::c / f7;
       satData->lkA     = a2;
       satData->lkB     = a7;
-      _epoData->satData[satData->prn] = satData;
     }
     else {
-      delete satData;
+      _epoData->remove(satData);
     }
   }
   else {
-    delete satData;
+    _epoData->remove(satData);
+  }
+}
+
+// Corrections of the last or previous ephemeris with the given IOD
+////////////////////////////////////////////////////////////////////////////
+t_pppClient::t_ephCorr* t_pppClient::ephCorr(const t_prn& prn, unsigned int iod) {
+  QSharedPointer<const t_eph> eLast = _ephUser->ephLast(prn);
+  QSharedPointer<const t_eph> ePrev = _ephUser->ephPrev(prn);
+  QSharedPointer<const t_eph> eph;
+  if      (eLast && eLast->IOD() == iod) {
+    eph = eLast;
+  }
+  else if (ePrev && ePrev->IOD() == iod) {
+    eph = ePrev;
+  }
+  else {
+    return 0;
   }
+  t_ephCorr& corr = _ephCorr[eph.data()];
+  corr._eph = eph;
+  return &corr;
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppClient::putOrbCorrections(const std::vector<t_orbCorr*>& corr) {
   for (unsigned ii = 0; ii < corr.size(); ii++) {
-    QString prn = QString(corr[ii]->_prn.toInternalString().c_str());
-    t_eph* eLast = _ephUser->ephLast(prn);
-    t_eph* ePrev = _ephUser->ephPrev(prn);
-    if      (eLast && eLast->IOD() == corr[ii]->_iod) {
-      eLast->setOrbCorr(corr[ii]);
-    }
-    else if (ePrev && ePrev->IOD() == corr[ii]->_iod) {
-      ePrev->setOrbCorr(corr[ii]);
+    t_ephCorr* ephC = ephCorr(corr[ii]->_prn, corr[ii]->_iod);
+    if (ephC) {
+      ephC->_orbCorr = QSharedPointer<const t_orbCorr>(new t_orbCorr(*corr[ii]));
     }
   }
 }
@@ -319,14 +314,9 @@ void t_pppClient::putOrbCorrections(const std::vector<t_orbCorr*>& corr) {
 ////////////////////////////////////////////////////////////////////////////
 void t_pppClient::putClkCorrections(const std::vector<t_clkCorr*>& corr) {
   for (unsigned ii = 0; ii < corr.size(); ii++) {
-    QString prn = QString(corr[ii]->_prn.toInternalString().c_str());
-    t_eph* eLast = _ephUser->ephLast(prn);
-    t_eph* ePrev = _ephUser->ephPrev(prn);
-    if      (eLast && eLast->IOD() == corr[ii]->_iod) {
-      eLast->setClkCorr(corr[ii]);
-    }
-    else if (ePrev && ePrev->IOD() == corr[ii]->_iod) {
-      ePrev->setClkCorr(corr[ii]);
+    t_ephCorr* ephC = ephCorr(corr[ii]->_prn, corr[ii]->_iod);
+    if (ephC) {
+      ephC->_clkCorr = QSharedPointer<const t_clkCorr>(new t_clkCorr(*corr[ii]));
     }
   }
 }
@@ -352,29 +342,23 @@ void t_pppClient::putTec(const t_vTec* /*vTec*/) {
 //
 //////////////////////////////////////////////////////////////////////////////
 void t_pppClient::putEphemeris(const t_eph* eph) {
-  bool check = _opt->_realTime;
-  if (_newEph)
-    delete _newEph;
-  _newEph = 0;
-  const t_ephGPS* ephGPS = dynamic_cast<const t_ephGPS*>(eph);
-  const t_ephGlo* ephGlo = dynamic_cast<const t_ephGlo*>(eph);
-  const t_ephGal* ephGal = dynamic_cast<const t_ephGal*>(eph);
-  const t_ephBDS* ephBDS = dynamic_cast<const t_ephBDS*>(eph);
-  if      (ephGPS) {
-    _newEph = new t_ephGPS(*ephGPS);
-  }
-  else if (ephGlo) {
-    _newEph = new t_ephGlo(*ephGlo);
+  if (eph->type() == t_eph::SBAS) {
+    return;
   }
-  else if (ephGal) {
-    _newEph = new t_ephGal(*ephGal);
-  }
-  else if (ephBDS) {
-    _newEph = new t_ephBDS(*ephBDS);
+  if (_ephUser->putNewEph(eph, _opt->_realTime) != success) {
+    return;
   }
 
-  if (_newEph) {
-    _ephUser->putNewEph(_newEph, check);
+  // Forget the corrections of ephemerides no longer stored
+  // ------------------------------------------------------
+  QSharedPointer<const t_eph> eLast = _ephUser->ephLast(eph->prn());
+  QSharedPointer<const t_eph> ePrev = _ephUser->ephPrev(eph->prn());
+  QMutableMapIterator<const t_eph*, t_ephCorr> it(_ephCorr);
+  while (it.hasNext()) {
+    const t_eph* ephC = it.next().key();
+    if (ephC->prn() == eph->prn() && ephC != eLast.data() && ephC != ePrev.data()) {
+      it.remove();
+    }
   }
 }
 
@@ -383,17 +367,31 @@ void t_pppClient::putEphemeris(const t_eph* eph) {
 t_irc t_pppClient::getSatPos(const bncTime& tt, const QString& prn,
                               ColumnVector& xc, ColumnVector& vv) {
 
-  t_eph* eLast = _ephUser->ephLast(prn);
-  t_eph* ePrev = _ephUser->ephPrev(prn);
-  if      (eLast && eLast->getCrd(tt, xc, vv, _opt->useOrbClkCorr()) == success) {
+  QSharedPointer<const t_eph> eLast = _ephUser->ephLast(prn);
+  QSharedPointer<const t_eph> ePrev = _ephUser->ephPrev(prn);
+  if      (eLast && getSatPos(tt, eLast.data(), xc, vv) == success) {
     return success;
   }
-  else if (ePrev && ePrev->getCrd(tt, xc, vv, _opt->useOrbClkCorr()) == success) {
+  else if (ePrev && getSatPos(tt, ePrev.data(), xc, vv) == success) {
     return success;
   }
   return failure;
 }
 
+// Satellite Position from one Ephemeris (corrected if required)
+////////////////////////////////////////////////////////////////////////////
+t_irc t_pppClient::getSatPos(const bncTime& tt, const t_eph* eph,
+                              ColumnVector& xc, ColumnVector& vv) const {
+  if (!_opt->useOrbClkCorr()) {
+    return eph->getCrd(tt, xc, vv);
+  }
+  QMap<const t_eph*, t_ephCorr>::const_iterator it = _ephCorr.constFind(eph);
+  if (it == _ephCorr.constEnd() || !it.value()._orbCorr || !it.value()._clkCorr) {
+    return failure;
+  }
+  return eph->getCrd(tt, xc, vv, it.value()._orbCorr.data(), it.value()._clkCorr.data());
+}
+
 // Correct Time of Transmission
 ////////////////////////////////////////////////////////////////////////////
 t_irc t_pppClient::cmpToT(t_satData* satData) {
@@ -404,12 +402,12 @@ t_irc t_pppClient::cmpToT(t_satData* satData) {
   }
 
   double clkSat = 0.0;
+  ColumnVector xc(4);
+  ColumnVector vv(3);
   for (int ii = 1; ii <= 10; ii++) {
 
     bncTime ToT = satData->tt - prange / t_CST::c - clkSat;
 
-    ColumnVector xc(4);
-    ColumnVector vv(3);
     if (getSatPos(ToT, satData->prn, xc, vv) != success) {
       return failure;
     }
@@ -418,8 +416,10 @@ t_irc t_pppClient::cmpToT(t_satData* satData) {
     clkSat = xc(4);
 
     if ( fabs(clkSat-clkSatOld) * t_CST::c < 1.e-4 ) {
-      satData->xx      = xc.Rows(1,3);
-      satData->vv      = vv;
+      for (int iCrd = 0; iCrd < 3; iCrd++) {
+        satData->xx[iCrd] = xc[iCrd];
+        satData->vv[iCrd] = vv[iCrd];
+      }
       satData->clk     = clkSat * t_CST::c;
       return success;
     }
@@ -50,20 +50,30 @@ class t_pppClient : public interface_pppClient {
   void                putCodeBiases(const std::vector<t_satCodeBias*>& satCodeBias);
   void                putPhaseBiases(const std::vector<t_satPhaseBias*>& satPhaseBias);
   std::ostringstream& log() {return *_log;}
+  bool                logDetails() const {return _opt->_logLevel > 0;}
   const t_pppOptions* opt() const {return _opt;}
   void                reset();
 
  private:
+  // Orbit and clock corrections referring to a stored ephemeris
+  class t_ephCorr {
+   public:
+    QSharedPointer<const t_eph>     _eph;
+    QSharedPointer<const t_orbCorr> _orbCorr;
+    QSharedPointer<const t_clkCorr> _clkCorr;
+  };
   t_irc getSatPos(const bncTime& tt, const QString& prn, ColumnVector& xc, ColumnVector& vv);
+  t_irc getSatPos(const bncTime& tt, const t_eph* eph, ColumnVector& xc, ColumnVector& vv) const;
+  t_ephCorr* ephCorr(const t_prn& prn, unsigned int iod);
   void  putNewObs(t_satData* satData);
   t_irc cmpToT(t_satData* satData);
   bncEphUser*         _ephUser;
+  QMap<const t_eph*, t_ephCorr> _ephCorr;
   t_pppOptions*       _opt;
   t_epoData*          _epoData;
   t_pppFilter*        _filter;
   t_pppUtils*         _pppUtils;
   std::ostringstream* _log;
-  t_eph*              _newEph;
 };
 
 } // namespace
@@ -41,8 +41,10 @@
 #include <iomanip>
 #include <cmath>
 #include <sstream>
+#include <vector>
 #include <newmatio.h>
 #include <newmatap.h>
+#include <QElapsedTimer>
 
 #include "pppFilter.h"
 #include "pppClient.h"
@@ -63,6 +65,21 @@ const double   BDS_WEIGHT_FACTOR     = 2.0;
 #define LOG (_pppClient->log())
 #define OPT (_pppClient->opt())
 
+// Filter report - the arguments are not evaluated if the details are not logged
+#define LOG_DETAILS if (!_pppClient->logDetails()) {} else LOG
+
+const int t_epoData::numSys;
+const int t_epoData::maxSat;
+const int t_epoData::_maxPrn[t_epoData::numSys] = {
+  t_prn::MAXPRN_BDS, t_prn::MAXPRN_GALILEO, t_prn::MAXPRN_GPS, t_prn::MAXPRN_GLONASS
+};
+const int t_epoData::_first[t_epoData::numSys] = {
+  0,
+  t_prn::MAXPRN_BDS,
+  t_prn::MAXPRN_BDS + t_prn::MAXPRN_GALILEO,
+  t_prn::MAXPRN_BDS + t_prn::MAXPRN_GALILEO + t_prn::MAXPRN_GPS
+};
+
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 t_pppParam::t_pppParam(t_pppParam::parType typeIn, int indexIn,
@@ -89,13 +106,13 @@ double t_pppParam::partial(t_satData* satData, bool phase) {
   // Coordinates
   // -----------
   if      (type == CRD_X) {
-    return (xx - satData->xx(1)) / satData->rho;
+    return (xx - satData->xx[0]) / satData->rho;
   }
   else if (type == CRD_Y) {
-    return (xx - satData->xx(2)) / satData->rho;
+    return (xx - satData->xx[1]) / satData->rho;
   }
   else if (type == CRD_Z) {
-    return (xx - satData->xx(3)) / satData->rho;
+    return (xx - satData->xx[2]) / satData->rho;
   }
 
   // Receiver Clocks
@@ -173,6 +190,15 @@ t_pppFilter::t_pppFilter(t_pppClient* pppClient) {
     _antex = new bncAntex(OPT->_antexFileName.c_str());
   }
 
+  // Receiver antenna resolved once for all frequencies
+  // ---------------------------------------------------
+  for (int iFrq = 0; iFrq < t_frequency::max; iFrq++) {
+    _rcvFrqMap[iFrq] = 0;
+    if (_antex) {
+      _rcvFrqMap[iFrq] = _antex->rcvFrqMap(OPT->_antNameRover, t_frequency::type(iFrq));
+    }
+  }
+
   // Bancroft Coordinates
   // --------------------
   _xcBanc.ReSize(4);  _xcBanc  = 0.0;
@@ -277,19 +303,15 @@ t_irc t_pppFilter::cmpBancroft(t_epoData* epoData) {
 
   Matrix BB(epoData->sizeSys('G'), 4);
 
-  QMapIterator<QString, t_satData*> it(epoData->satData);
+  t_epoData::t_iterator it(epoData, 'G');
   int iObsBanc = 0;
   while (it.hasNext()) {
-    it.next();
-    t_satData* satData = it.value();
-    if (satData->system() == 'G') {
-      ++iObsBanc;
-      QString    prn     = it.key();
-      BB(iObsBanc, 1) = satData->xx(1);
-      BB(iObsBanc, 2) = satData->xx(2);
-      BB(iObsBanc, 3) = satData->xx(3);
-      BB(iObsBanc, 4) = satData->P3 + satData->clk;
-    }
+    t_satData* satData = it.next();
+    ++iObsBanc;
+    BB(iObsBanc, 1) = satData->xx[0];
+    BB(iObsBanc, 2) = satData->xx[1];
+    BB(iObsBanc, 3) = satData->xx[2];
+    BB(iObsBanc, 4) = satData->P3 + satData->clk;
   }
 
   bancroft(BB, _xcBanc);
@@ -306,14 +328,12 @@ t_irc t_pppFilter::cmpBancroft(t_epoData* epoData) {
 
   // Compute Satellite Elevations
   // ----------------------------
-  QMutableMapIterator<QString, t_satData*> im(epoData->satData);
+  t_epoData::t_iterator im(epoData);
   while (im.hasNext()) {
-    im.next();
-    t_satData* satData = im.value();
+    t_satData* satData = im.next();
     cmpEle(satData);
     if (satData->eleSat < OPT->_minEle) {
-      delete satData;
-      im.remove();
+      epoData->remove(satData);
     }
   }
 
@@ -331,7 +351,9 @@ double t_pppFilter::cmpValue(t_satData* satData, bool phase) {
   xRec(2) = y();
   xRec(3) = z();
 
-  double rho0 = (satData->xx - xRec).norm_Frobenius();
+  double rho0 = sqrt((satData->xx[0] - xRec(1)) * (satData->xx[0] - xRec(1)) +
+                     (satData->xx[1] - xRec(2)) * (satData->xx[1] - xRec(2)) +
+                     (satData->xx[2] - xRec(3)) * (satData->xx[2] - xRec(3)));
   double dPhi = t_CST::omega * rho0 / t_CST::c;
 
   xRec(1) = x() * cos(dPhi) - y() * sin(dPhi);
@@ -340,7 +362,9 @@ double t_pppFilter::cmpValue(t_satData* satData, bool phase) {
 
   xRec += _tides->displacement(_time, xRec);
 
-  satData->rho = (satData->xx - xRec).norm_Frobenius();
+  satData->rho = sqrt((satData->xx[0] - xRec(1)) * (satData->xx[0] - xRec(1)) +
+                      (satData->xx[1] - xRec(2)) * (satData->xx[1] - xRec(2)) +
+                      (satData->xx[2] - xRec(3)) * (satData->xx[2] - xRec(3)));
 
   double tropDelay = delay_saast(satData->eleSat) +
                      trp() / sin(satData->eleSat);
@@ -370,14 +394,15 @@ double t_pppFilter::cmpValue(t_satData* satData, bool phase) {
   }
   double phaseCenter = 0.0;
   if (_antex) {
-    bool found;
-    phaseCenter = satData->lkA * _antex->rcvCorr(OPT->_antNameRover, frqA,
-                                                 satData->eleSat, satData->azSat,
-                                                 found)
-                + satData->lkB * _antex->rcvCorr(OPT->_antNameRover, frqB,
-                                                 satData->eleSat, satData->azSat,
-                                                 found);
-    if (!found) {
+    const bncAntex::t_frqMap* frqMapA = _rcvFrqMap[frqA];
+    const bncAntex::t_frqMap* frqMapB = _rcvFrqMap[frqB];
+    if (frqMapA) {
+      phaseCenter += satData->lkA * _antex->rcvCorr(frqMapA, satData->eleSat, satData->azSat);
+    }
+    if (frqMapB) {
+      phaseCenter += satData->lkB * _antex->rcvCorr(frqMapB, satData->eleSat, satData->azSat);
+    }
+    else {
       LOG << "ANTEX: antenna >" << OPT->_antNameRover << "< not found\n";
     }
   }
@@ -563,7 +588,7 @@ void t_pppFilter::predict(int iPhase, t_epoData* epoData) {
       t_pppParam* par = im.next();
       bool removed = false;
       if (par->type == t_pppParam::AMB_L3) {
-        if (epoData->satData.find(par->prn) == epoData->satData.end()) {
+        if (!epoData->find(par->prn)) {
           removed = true;
           delete par;
           im.remove();
@@ -577,11 +602,9 @@ void t_pppFilter::predict(int iPhase, t_epoData* epoData) {
 
     // Add new ambiguity parameters
     // ----------------------------
-    QMapIterator<QString, t_satData*> it(epoData->satData);
+    t_epoData::t_iterator it(epoData);
     while (it.hasNext()) {
-      it.next();
-      t_satData* satData = it.value();
-      addAmb(satData);
+      addAmb(it.next());
     }
 
     int nPar = _params.size();
@@ -618,11 +641,11 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
   _time = epoData->tt; // current epoch time
 
   if (OPT->useOrbClkCorr()) {
-    LOG << "Precise Point Positioning of Epoch " << _time.datestr() <<  "_" << _time.timestr(3)
+    LOG_DETAILS << "Precise Point Positioning of Epoch " << _time.datestr() <<  "_" << _time.timestr(3)
         << "\n---------------------------------------------------------------\n";
   }
   else {
-    LOG << "Single Point Positioning of Epoch " << _time.datestr() <<  "_" << _time.timestr(3)
+    LOG_DETAILS << "Single Point Positioning of Epoch " << _time.datestr() <<  "_" << _time.timestr(3)
         << "\n---------------------------------------------------------------\n";
   }
 
@@ -639,14 +662,14 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
   while (itPar.hasNext()) {
     t_pppParam* par = itPar.next();
     if      (par->type == t_pppParam::RECCLK) {
-      LOG << "\n" << _time.datestr() << "_" << _time.timestr(3)
+      LOG_DETAILS << "\n" << _time.datestr() << "_" << _time.timestr(3)
           << " CLK     " << setw(10) << setprecision(3) << par->xx
           << " +- " << setw(6) << setprecision(3)
           << sqrt(_QQ(par->index,par->index));
     }
     else if (par->type == t_pppParam::AMB_L3) {
       ++par->numEpo;
-      LOG << "\n" << _time.datestr() << "_" << _time.timestr(3)
+      LOG_DETAILS << "\n" << _time.datestr() << "_" << _time.timestr(3)
           << " AMB " << par->prn.mid(0,3).toLatin1().data() << " "
           << setw(10) << setprecision(3) << par->xx
           << " +- " << setw(6) << setprecision(3)
@@ -655,7 +678,7 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
     }
     else if (par->type == t_pppParam::TROPO) {
       double aprTrp = delay_saast(M_PI/2.0);
-      LOG << "\n" << _time.datestr() << "_" << _time.timestr(3)
+      LOG_DETAILS << "\n" << _time.datestr() << "_" << _time.timestr(3)
           << " TRP     " << par->prn.mid(0,3).toLatin1().data()
           << setw(7) << setprecision(3) << aprTrp << " "
           << setw(6) << setprecision(3) << showpos << par->xx << noshowpos
@@ -663,26 +686,26 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
           << sqrt(_QQ(par->index,par->index));
     }
     else if (par->type == t_pppParam::GLONASS_OFFSET) {
-      LOG << "\n" << _time.datestr() << "_" << _time.timestr(3)
+      LOG_DETAILS << "\n" << _time.datestr() << "_" << _time.timestr(3)
           << " OFFGLO  " << setw(10) << setprecision(3) << par->xx
           << " +- " << setw(6) << setprecision(3)
           << sqrt(_QQ(par->index,par->index));
     }
     else if (par->type == t_pppParam::GALILEO_OFFSET) {
-      LOG << "\n" << _time.datestr() << "_" << _time.timestr(3)
+      LOG_DETAILS << "\n" << _time.datestr() << "_" << _time.timestr(3)
           << " OFFGAL  " << setw(10) << setprecision(3) << par->xx
           << " +- " << setw(6) << setprecision(3)
           << sqrt(_QQ(par->index,par->index));
     }
     else if (par->type == t_pppParam::BDS_OFFSET) {
-      LOG << "\n" << _time.datestr() << "_" << _time.timestr(3)
+      LOG_DETAILS << "\n" << _time.datestr() << "_" << _time.timestr(3)
           << " OFFBDS  " << setw(10) << setprecision(3) << par->xx
           << " +- " << setw(6) << setprecision(3)
           << sqrt(_QQ(par->index,par->index));
     }
   }
 
-  LOG << endl << endl;
+  LOG_DETAILS << endl << endl;
 
   // Compute dilution of precision
   // -----------------------------
@@ -690,7 +713,7 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
 
   // Final Message (both log file and screen)
   // ----------------------------------------
-  LOG << epoData->tt.datestr() << "_" << epoData->tt.timestr(3)
+  LOG_DETAILS << epoData->tt.datestr() << "_" << epoData->tt.timestr(3)
       << " " << OPT->_roverName
       << " X = "
       << setprecision(4) << x() << " +- "
@@ -721,7 +744,7 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
     SymmetricMatrix QQneu(3);
     covariXYZ_NEU(QQxyz, ellRef.data(), QQneu);
 
-    LOG << " dN = "
+    LOG_DETAILS << " dN = "
         << setprecision(4) << _neu[0] << " +- "
         << setprecision(4) << sqrt(QQneu[0][0])
 
@@ -734,7 +757,7 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
         << setprecision(4) << sqrt(QQneu[2][2])           << endl << endl;
   }
   else {
-    LOG << endl << endl;
+    LOG_DETAILS << endl << endl;
   }
 
   _lastTimeOK = _time; // remember time of last successful update
@@ -744,7 +767,7 @@ t_irc t_pppFilter::update(t_epoData* epoData) {
 // Outlier Detection
 ////////////////////////////////////////////////////////////////////////////
 QString t_pppFilter::outlierDetection(int iPhase, const ColumnVector& vv,
-                                   QMap<QString, t_satData*>& satData) {
+                                   const t_epoData* epoData) {
 
   Tracer tracer("t_pppFilter::outlierDetection");
 
@@ -752,20 +775,20 @@ QString t_pppFilter::outlierDetection(int iPhase, const ColumnVector& vv,
   QString prnGlo;
   double  maxResGPS = 0.0; // GPS + Galileo
   double  maxResGlo = 0.0; // GLONASS + BDS
-  findMaxRes(vv, satData, prnGPS, prnGlo, maxResGPS, maxResGlo);
+  findMaxRes(vv, epoData, prnGPS, prnGlo, maxResGPS, maxResGlo);
 
   if      (iPhase == 1) {
     if      (maxResGlo > 2.98 * OPT->_maxResL1) {
-      LOG << "Outlier Phase " << prnGlo.mid(0,3).toLatin1().data() << ' ' << maxResGlo << endl;
+      LOG_DETAILS << "Outlier Phase " << prnGlo.mid(0,3).toLatin1().data() << ' ' << maxResGlo << endl;
       return prnGlo;
     }
     else if (maxResGPS > MAXRES_PHASE_GPS) {
-      LOG << "Outlier Phase " << prnGPS.mid(0,3).toLatin1().data() << ' ' << maxResGPS << endl;
+      LOG_DETAILS << "Outlier Phase " << prnGPS.mid(0,3).toLatin1().data() << ' ' << maxResGPS << endl;
       return prnGPS;
     }
   }
   else if (iPhase == 0 && maxResGPS > 2.98 * OPT->_maxResC1) {
-    LOG << "Outlier Code  " << prnGPS.mid(0,3).toLatin1().data() << ' ' << maxResGPS << endl;
+    LOG_DETAILS << "Outlier Code  " << prnGPS.mid(0,3).toLatin1().data() << ' ' << maxResGPS << endl;
     return prnGPS;
   }
 
@@ -774,7 +797,7 @@ QString t_pppFilter::outlierDetection(int iPhase, const ColumnVector& vv,
 
 // Phase Wind-Up Correction
 ///////////////////////////////////////////////////////////////////////////
-double t_pppFilter::windUp(const QString& prn, const ColumnVector& rSat,
+double t_pppFilter::windUp(const QString& prn, const double* xSat,
                         const ColumnVector& rRec) {
 
   Tracer tracer("t_pppFilter::windUp");
@@ -792,6 +815,9 @@ double t_pppFilter::windUp(const QString& prn, const ColumnVector& rSat,
   if (!_windUpTime.contains(prn) || _windUpTime[prn] != Mjd) {
     _windUpTime[prn] = Mjd;
 
+    ColumnVector rSat(3);
+    rSat << xSat;
+
     // Unit Vector GPS Satellite --> Receiver
     // --------------------------------------
     ColumnVector rho = rRec - rSat;
@@ -859,11 +885,14 @@ double t_pppFilter::windUp(const QString& prn, const ColumnVector& rSat,
 ///////////////////////////////////////////////////////////////////////////
 void t_pppFilter::cmpEle(t_satData* satData) {
   Tracer tracer("t_pppFilter::cmpEle");
-  ColumnVector rr = satData->xx - _xcBanc.Rows(1,3);
-  double       rho = rr.norm_Frobenius();
+  double rr[3];
+  rr[0] = satData->xx[0] - _xcBanc(1);
+  rr[1] = satData->xx[1] - _xcBanc(2);
+  rr[2] = satData->xx[2] - _xcBanc(3);
+  double rho = sqrt(rr[0]*rr[0] + rr[1]*rr[1] + rr[2]*rr[2]);
 
   double neu[3];
-  xyz2neu(_ellBanc.data(), rr.data(), neu);
+  xyz2neu(_ellBanc.data(), rr, neu);
 
   satData->eleSat = acos( sqrt(neu[0]*neu[0] + neu[1]*neu[1]) / rho );
   if (neu[2] < 0) {
@@ -898,7 +927,8 @@ void t_pppFilter::addAmb(t_satData* satData) {
 //
 ///////////////////////////////////////////////////////////////////////////
 void t_pppFilter::addObs(int iPhase, unsigned& iObs, t_satData* satData,
-                      Matrix& AA, ColumnVector& ll, DiagonalMatrix& PP) {
+                      Matrix& AA, ColumnVector& ll, DiagonalMatrix& PP,
+                      QVector<int>& idx) {
 
   Tracer tracer("t_pppFilter::addObs");
 
@@ -913,6 +943,7 @@ void t_pppFilter::addObs(int iPhase, unsigned& iObs, t_satData* satData,
   // --------------------------
   ++iObs;
   satData->obsIndex = iObs;
+  idx.clear();
 
   // Phase Observations
   // ------------------
@@ -933,6 +964,9 @@ void t_pppFilter::addObs(int iPhase, unsigned& iObs, t_satData* satData,
         ll(iObs) -= _params[iPar-1]->xx;
       }
       AA(iObs, iPar) = _params[iPar-1]->partial(satData, true);
+      if (AA(iObs, iPar) != 0.0) {
+        idx << iPar;
+      }
     }
   }
 
@@ -944,6 +978,9 @@ void t_pppFilter::addObs(int iPhase, unsigned& iObs, t_satData* satData,
     PP(iObs,iObs) = 1.0 / (sigP3 * sigP3) / (ellWgtCoef * ellWgtCoef);
     for (int iPar = 1; iPar <= _params.size(); iPar++) {
       AA(iObs, iPar) = _params[iPar-1]->partial(satData, false);
+      if (AA(iObs, iPar) != 0.0) {
+        idx << iPar;
+      }
     }
   }
 }
@@ -951,17 +988,16 @@ void t_pppFilter::addObs(int iPhase, unsigned& iObs, t_satData* satData,
 //
 ///////////////////////////////////////////////////////////////////////////
 QByteArray t_pppFilter::printRes(int iPhase, const ColumnVector& vv,
-                              const QMap<QString, t_satData*>& satDataMap) {
+                              const t_epoData* epoData) {
 
   Tracer tracer("t_pppFilter::printRes");
 
   ostringstream str;
   str.setf(ios::fixed);
   bool useObs;
-  QMapIterator<QString, t_satData*> it(satDataMap);
+  t_epoData::t_iterator it(epoData);
   while (it.hasNext()) {
-    it.next();
-    t_satData* satData = it.value();
+    t_satData* satData = it.next();
     (iPhase == 0) ? useObs = OPT->codeLCs(satData->system()).size() :
                     useObs = OPT->ambLCs(satData->system()).size();
     if (satData->obsIndex != 0 && useObs) {
@@ -978,7 +1014,7 @@ QByteArray t_pppFilter::printRes(int iPhase, const ColumnVector& vv,
 //
 ///////////////////////////////////////////////////////////////////////////
 void t_pppFilter::findMaxRes(const ColumnVector& vv,
-                          const QMap<QString, t_satData*>& satData,
+                          const t_epoData* epoData,
                           QString& prnGPS, QString& prnGlo,
                           double& maxResGPS, double& maxResGlo) {
 
@@ -987,10 +1023,9 @@ void t_pppFilter::findMaxRes(const ColumnVector& vv,
   maxResGPS  = 0.0;
   maxResGlo  = 0.0;
 
-  QMapIterator<QString, t_satData*> it(satData);
+  t_epoData::t_iterator it(epoData);
   while (it.hasNext()) {
-    it.next();
-    t_satData* satData = it.value();
+    t_satData* satData = it.next();
     if (satData->obsIndex != 0) {
       QString prn = satData->prn;
       if (prn[0] == 'R' || prn[0] == 'C') {
@@ -1009,156 +1044,378 @@ void t_pppFilter::findMaxRes(const ColumnVector& vv,
   }
 }
 
+// Filter Update - the observations are uncorrelated and processed one by
+// one; a row of the design matrix touches the coordinates, clock,
+// troposphere and offsets, and at most one ambiguity
+////////////////////////////////////////////////////////////////////////////
+void t_pppFilter::kalmanUpdate(const Matrix& AA, const ColumnVector& ll,
+                               const DiagonalMatrix& PP,
+                               const QVector< QVector<int> >& AI,
+                               SymmetricMatrix& QQ, ColumnVector& dx) {
+
+  Tracer tracer("t_pppFilter::kalmanUpdate");
+
+  int     nPar = AA.Ncols();
+  int     nObs = AA.Nrows();
+  double* QS   = QQ.Store();    // lower triangle, stored row by row
+
+  vector<int>    idx(nPar);
+  vector<double> aa(nPar);
+  vector<double> hh(nPar);
+
+  for (int iObs = 1; iObs <= nObs; iObs++) {
+
+    // Non-zero partials of the observation (indices collected by addObs)
+    // ------------------------------------------------------------------
+    const QVector<int>& AIRow = AI[iObs];
+    int nn = AIRow.size();
+    for (int kk = 0; kk < nn; kk++) {
+      idx[kk] = AIRow[kk] - 1;
+      aa[kk]  = AA(iObs, AIRow[kk]);
+    }
+
+    // hh = QQ * a, innovation and its variance
+    // ----------------------------------------
+    double vv = ll(iObs);
+    double ss = 1.0 / PP(iObs,iObs);
+    for (int kk = 0; kk < nn; kk++) {
+      vv -= aa[kk] * dx[idx[kk]];
+    }
+    for (int iPar = 0; iPar < nPar; iPar++) {
+      double hPar = 0.0;
+      for (int kk = 0; kk < nn; kk++) {
+        int jPar = idx[kk];
+        hPar += aa[kk] * (iPar >= jPar ? QS[iPar*(iPar+1)/2 + jPar]
+                                       : QS[jPar*(jPar+1)/2 + iPar]);
+      }
+      hh[iPar] = hPar;
+    }
+    for (int kk = 0; kk < nn; kk++) {
+      ss += aa[kk] * hh[idx[kk]];
+    }
+
+    // Update of the parameters and of the covariance matrix
+    // -----------------------------------------------------
+    double fac = vv / ss;
+    for (int iPar = 0; iPar < nPar; iPar++) {
+      dx[iPar] += hh[iPar] * fac;
+      double  hs   = hh[iPar] / ss;
+      double* QRow = QS + iPar*(iPar+1)/2;
+      for (int jPar = 0; jPar <= iPar; jPar++) {
+        QRow[jPar] -= hs * hh[jPar];
+      }
+    }
+  }
+}
+
+// Add (sign > 0) or remove (sign < 0) an observation in the normal equations
+// given by their square root (update or downdate of the Cholesky factor)
+////////////////////////////////////////////////////////////////////////////
+void t_pppFilter::addNormal(const Matrix& AA, const ColumnVector& ll,
+                            const DiagonalMatrix& PP,
+                            const QVector<int>& idx, int iObs, double sign,
+                            UpperTriangularMatrix& RR, ColumnVector& bb) {
+
+  double    sp = sqrt(PP(iObs,iObs));
+  RowVector aa(AA.Ncols()); aa = 0.0;
+
+  for (int ii = 0; ii < idx.size(); ii++) {
+    int iPar = idx[ii];
+    aa(iPar)  = sp * AA(iObs, iPar);
+    bb(iPar) += sign * sp * aa(iPar) * ll(iObs);
+  }
+
+  if (sign > 0.0) {
+    UpdateCholesky(RR, aa);
+  }
+  else {
+    DowndateCholesky(RR, aa);
+  }
+}
+
 // Update Step (private - loop over outliers)
 ////////////////////////////////////////////////////////////////////////////
 t_irc t_pppFilter::update_p(t_epoData* epoData) {
 
   Tracer tracer("t_pppFilter::update_p");
 
+  QElapsedTimer timer;
+  timer.start();
+
   // Save Variance-Covariance Matrix, and Status Vector
   // --------------------------------------------------
   rememberState(epoData);
 
-  QString lastOutlierPrn;
+  _outlierGPS.clear();
+  _outlierGlo.clear();
+
+  QByteArray  strResCode;
+  QByteArray  strResPhase;
+  int         numIter = 0;
+  QStringList triedGPS;    // GPS outliers of the epoch, a repeated one fails
+  t_irc       irc     = success;
+
+  // Bancroft Solution
+  // -----------------
+  if (cmpBancroft(epoData) != success) {
+    irc = failure;
+  }
+
+  // First update using code observations, then phase observations
+  // -------------------------------------------------------------
+  bool usePhase = OPT->ambLCs('G').size() || OPT->ambLCs('R').size() ||
+                  OPT->ambLCs('E').size() || OPT->ambLCs('C').size() ;
+
+  char sys[] ={'G', 'R', 'E', 'C'};
 
-  // Try with all satellites, then with all minus one, etc.
-  // ------------------------------------------------------
-  while (selectSatellites(lastOutlierPrn, epoData->satData) == success) {
+  bool satnumPrinted[] = {false, false, false, false};
 
-    QByteArray strResCode;
-    QByteArray strResPhase;
+  for (int iPhase = 0; irc == success && iPhase <= (usePhase ? 1 : 0); iPhase++) {
 
-    // Bancroft Solution
+    // Status Prediction
     // -----------------
-    if (cmpBancroft(epoData) != success) {
+    predict(iPhase, epoData);
+
+    // Create First-Design Matrix
+    // --------------------------
+    unsigned nPar = _params.size();
+    unsigned nObs = 0;
+    nObs = epoData->sizeAll();
+    bool useObs = false;
+    for (unsigned ii = 0; ii < sizeof(sys); ii++) {
+      const char s = sys[ii];
+      (iPhase == 0) ? useObs = OPT->codeLCs(s).size() : useObs = OPT->ambLCs(s).size();
+      if (!useObs) {
+        nObs -= epoData->sizeSys(s);
+      }
+      else {
+        if (!satnumPrinted[ii]) {
+          satnumPrinted[ii] = true;
+          LOG_DETAILS << _time.datestr() << "_" << _time.timestr(3)
+              << " SATNUM " << s << ' ' << right << setw(2)
+              << epoData->sizeSys(s) << endl;
+        }
+      }
+    }
+
+    if (int(nObs) < OPT->_minObs) {
+      irc = failure;
       break;
     }
 
-    // First update using code observations, then phase observations
-    // -------------------------------------------------------------
-    bool usePhase = OPT->ambLCs('G').size() || OPT->ambLCs('R').size() ||
-                    OPT->ambLCs('E').size() || OPT->ambLCs('C').size() ;
+    // Prepare first-design Matrix, vector observed-computed
+    // -----------------------------------------------------
+    Matrix          AA(nObs, nPar);  // first design matrix
+    ColumnVector    ll(nObs);        // terms observed-computed
+    DiagonalMatrix  PP(nObs); PP = 0.0;
 
-    char sys[] ={'G', 'R', 'E', 'C'};
+    QVector< QVector<int> > AI(nObs+1); // non-zero columns of AA, by row
 
-    bool satnumPrinted[] = {false, false, false, false};
+    QMap<QString, unsigned> obsIndex;
 
-    for (int iPhase = 0; iPhase <= (usePhase ? 1 : 0); iPhase++) {
+    unsigned iObs = 0;
+    t_epoData::t_iterator it(epoData);
 
-      // Status Prediction
-      // -----------------
-      predict(iPhase, epoData);
+    while (it.hasNext()) {
+      t_satData* satData = it.next();
+      const QString& prn = satData->prn;
+      (iPhase == 0) ? useObs = OPT->codeLCs(satData->system()).size() :
+                      useObs = OPT->ambLCs(satData->system()).size();
+      if (useObs) {
+        addObs(iPhase, iObs, satData, AA, ll, PP, AI[iObs+1]);
+        obsIndex[prn] = satData->obsIndex;
+      } else {
+        satData->obsIndex = 0;
+      }
+    }
 
-      // Create First-Design Matrix
-      // --------------------------
-      unsigned nPar = _params.size();
-      unsigned nObs = 0;
-      nObs = epoData->sizeAll();
-      bool useObs = false;
-      for (unsigned ii = 0; ii < sizeof(sys); ii++) {
-        const char s = sys[ii];
-        (iPhase == 0) ? useObs = OPT->codeLCs(s).size() : useObs = OPT->ambLCs(s).size();
-        if (!useObs) {
-          nObs -= epoData->sizeSys(s);
-        }
-        else {
-          if (!satnumPrinted[ii]) {
-            satnumPrinted[ii] = true;
-            LOG << _time.datestr() << "_" << _time.timestr(3)
-                << " SATNUM " << s << ' ' << right << setw(2)
-                << epoData->sizeSys(s) << endl;
-          }
+    // Compute Filter Update
+    // ---------------------
+    SymmetricMatrix QQ_apr = _QQ;
+    ColumnVector dx(nPar); dx = 0.0;
+    kalmanUpdate(AA, ll, PP, AI, _QQ, dx);
+    ColumnVector vv = ll - AA * dx;
+
+    // Outlier Loop - a rejected observation is removed from the normal
+    // equations and the solution is recomputed without a new filter run
+    // -----------------------------------------------------------------
+    UpperTriangularMatrix RR;  // RR.t() * RR = normal equation matrix
+    ColumnVector          bb;
+    QString               prnGPS;  // GPS outlier of this step
+    QStringList           outlierGlo;
+    int                   nObsUsed = nObs;
+    QString               prnOut;
+    while ( !(prnOut = outlierDetection(iPhase, vv, epoData)).isEmpty() ) {
+
+      ++numIter;
+
+      // Square root of the normal equations at the first outlier - the
+      // inverse Cholesky factor of QQ_apr is triangularized and updated
+      // ----------------------------------------------------------------
+      if (RR.Nrows() == 0) {
+        Matrix SS = Cholesky(QQ_apr).i();
+        QRZ(SS, RR);
+        bb.ReSize(nPar); bb = 0.0;
+        for (unsigned kObs = 1; kObs <= nObs; kObs++) {
+          addNormal(AA, ll, PP, AI[kObs], kObs, 1.0, RR, bb);
         }
       }
 
-      if (int(nObs) < OPT->_minObs) {
-        restoreState(epoData);
-        return failure;
+      // Glonass and BDS Outliers are removed, the GPS satellite is used again
+      // ----------------------------------------------------------------------
+      QString prnIn;
+      if (prnOut[0] == 'R' || prnOut[0] == 'C') {
+        outlierGlo << prnOut;
+        prnIn = prnGPS;
+        prnGPS.clear();
+        triedGPS.clear();
       }
 
-      // Prepare first-design Matrix, vector observed-computed
-      // -----------------------------------------------------
-      Matrix          AA(nObs, nPar);  // first design matrix
-      ColumnVector    ll(nObs);        // terms observed-computed
-      DiagonalMatrix  PP(nObs); PP = 0.0;
-
-      unsigned iObs = 0;
-      QMapIterator<QString, t_satData*> it(epoData->satData);
-
-      while (it.hasNext()) {
-        it.next();
-        t_satData* satData = it.value();
-        QString prn = satData->prn;
-        (iPhase == 0) ? useObs = OPT->codeLCs(satData->system()).size() :
-                        useObs = OPT->ambLCs(satData->system()).size();
-        if (useObs) {
-          addObs(iPhase, iObs, satData, AA, ll, PP);
-        } else {
-          satData->obsIndex = 0;
-        }
+      // GPS Outlier appeared for the first time - it replaces the previous one
+      // ------------------------------------------------------------------------
+      else if (triedGPS.indexOf(prnOut) == -1) {
+        triedGPS << prnOut;
+        prnIn  = prnGPS;
+        prnGPS = prnOut;
+      }
+      else {
+        irc = failure;
+        break;
       }
 
-      // Compute Filter Update
-      // ---------------------
-      ColumnVector dx(nPar); dx = 0.0;
-      kalman(AA, ll, PP, _QQ, dx);
-      ColumnVector vv = ll - AA * dx;
+      t_satData* satOut = epoData->find(prnOut);
+      addNormal(AA, ll, PP, AI[satOut->obsIndex], satOut->obsIndex,
+                -1.0, RR, bb);
+      satOut->obsIndex = 0;
+      --nObsUsed;
+
+      if (!prnIn.isEmpty()) {
+        t_satData* satIn = epoData->find(prnIn);
+        satIn->obsIndex = obsIndex[prnIn];
+        addNormal(AA, ll, PP, AI[satIn->obsIndex], satIn->obsIndex,
+                  1.0, RR, bb);
+        ++nObsUsed;
+      }
 
-      // Print Residuals
-      // ---------------
+      if (nObsUsed < OPT->_minObs) {
+        irc = failure;
+        break;
+      }
+
+      dx = RR.i() * (RR.t().i() * bb);
+      vv = ll - AA * dx;
+    }
+
+    if (irc != success) {
+      break;
+    }
+
+    if (RR.Nrows() > 0) {
+      UpperTriangularMatrix RRi = RR.i();
+      _QQ << RRi * RRi.t();
+    }
+
+    QVectorIterator<t_pppParam*> itPar(_params);
+    while (itPar.hasNext()) {
+      t_pppParam* par = itPar.next();
+      par->xx += dx(par->index);
+    }
+
+    // Print Residuals
+    // ---------------
+    if (_pppClient->logDetails()) {
       if (iPhase == 0) {
-        strResCode  = printRes(iPhase, vv, epoData->satData);
+        strResCode  = printRes(iPhase, vv, epoData);
       }
       else {
-        strResPhase = printRes(iPhase, vv, epoData->satData);
+        strResPhase = printRes(iPhase, vv, epoData);
       }
+    }
 
-      // Check the residuals
-      // -------------------
-      lastOutlierPrn = outlierDetection(iPhase, vv, epoData->satData);
-
-      // No Outlier Detected
-      // -------------------
-      if (lastOutlierPrn.isEmpty()) {
+    // Remove the rejected satellites - after the phase step together with
+    // their ambiguities (re-initialized at the next epoch)
+    // --------------------------------------------------------------------
+    if (!prnGPS.isEmpty()) {
+      _outlierGPS << prnGPS;
+      epoData->remove(prnGPS);
+    }
+    QStringListIterator itGlo(outlierGlo);
+    while (itGlo.hasNext()) {
+      QString prn = itGlo.next();
+      _outlierGlo << prn;
+      epoData->remove(prn);
+    }
+    if (iPhase == 1 && (!prnGPS.isEmpty() || !outlierGlo.isEmpty())) {
+      removeAmb(epoData);
+    }
 
-        QVectorIterator<t_pppParam*> itPar(_params);
-        while (itPar.hasNext()) {
-          t_pppParam* par = itPar.next();
-          par->xx += dx(par->index);
-        }
+  } // for iPhase
 
-        if (!usePhase || iPhase == 1) {
-          if (_outlierGPS.size() > 0 || _outlierGlo.size() > 0) {
-            LOG << "Neglected PRNs: ";
-            if (!_outlierGPS.isEmpty()) {
-              LOG << _outlierGPS.last().mid(0,3).toLatin1().data() << ' ';
-            }
-            QStringListIterator itGlo(_outlierGlo);
-            while (itGlo.hasNext()) {
-              QString prn = itGlo.next();
-              LOG << prn.mid(0,3).toLatin1().data() << ' ';
-            }
-            LOG << endl;
-          }
-          LOG << strResCode.data() << strResPhase.data();
+  if (irc != success) {
+    restoreState(epoData);
+  }
 
-          return success;
-        }
+  // Filter Report
+  // -------------
+  if (irc == success && _pppClient->logDetails()) {
+    if (_outlierGPS.size() > 0 || _outlierGlo.size() > 0) {
+      LOG << "Neglected PRNs: ";
+      QStringListIterator itGPS(_outlierGPS);
+      while (itGPS.hasNext()) {
+        QString prn = itGPS.next();
+        LOG << prn.mid(0,3).toLatin1().data() << ' ';
       }
-
-      // Outlier Found
-      // -------------
-      else {
-        restoreState(epoData);
-        break;
+      QStringListIterator itGlo(_outlierGlo);
+      while (itGlo.hasNext()) {
+        QString prn = itGlo.next();
+        LOG << prn.mid(0,3).toLatin1().data() << ' ';
       }
+      LOG << endl;
+    }
+    LOG << strResCode.data() << strResPhase.data();
+  }
 
-    } // for iPhase
+  LOG_DETAILS << _time.datestr() << "_" << _time.timestr(3)
+      << " OUTLIERS " << right << setw(2) << _outlierGPS.size() + _outlierGlo.size()
+      << " ITER " << setw(2) << numIter
+      << " TIME " << fixed << setprecision(3) << timer.nsecsElapsed() * 1.e-6 << " ms"
+      << (irc == success ? "" : " FAILED") << endl;
 
-  } // while selectSatellites
+  return irc;
+}
 
-  restoreState(epoData);
-  return failure;
+// Remove Ambiguity Parameters of satellites without observations
+////////////////////////////////////////////////////////////////////////////
+void t_pppFilter::removeAmb(t_epoData* epoData) {
+
+  SymmetricMatrix QQ_old = _QQ;
+
+  int iPar = 0;
+  QMutableVectorIterator<t_pppParam*> im(_params);
+  while (im.hasNext()) {
+    t_pppParam* par = im.next();
+    if (par->type == t_pppParam::AMB_L3 && !epoData->find(par->prn)) {
+      delete par;
+      im.remove();
+    }
+    else {
+      ++iPar;
+      par->index_old = par->index;
+      par->index     = iPar;
+    }
+  }
+
+  _QQ.ReSize(iPar);
+  for (int i1 = 1; i1 <= iPar; i1++) {
+    t_pppParam* p1 = _params[i1-1];
+    for (int i2 = 1; i2 <= i1; i2++) {
+      t_pppParam* p2 = _params[i2-1];
+      _QQ(i1, i2) = QQ_old(p1->index_old, p2->index_old);
+    }
+  }
+  for (int ii = 1; ii <= iPar; ii++) {
+    _params[ii-1]->index_old = ii;
+  }
 }
 
 // Remeber Original State Vector and Variance-Covariance Matrix
@@ -1205,57 +1462,6 @@ void t_pppFilter::restoreState(t_epoData* epoData) {
   epoData->deepCopy(_epoData_sav);
 }
 
-//
-////////////////////////////////////////////////////////////////////////////
-t_irc t_pppFilter::selectSatellites(const QString& lastOutlierPrn,
-                                 QMap<QString, t_satData*>& satData) {
-
-  // First Call
-  // ----------
-  if (lastOutlierPrn.isEmpty()) {
-    _outlierGPS.clear();
-    _outlierGlo.clear();
-    return success;
-  }
-
-  // Second and next trials
-  // ----------------------
-  else {
-
-    if (lastOutlierPrn[0] == 'R' || lastOutlierPrn[0] == 'C') {
-      _outlierGlo << lastOutlierPrn;
-    }
-
-    // Remove all Glonass Outliers
-    // ---------------------------
-    QStringListIterator it(_outlierGlo);
-    while (it.hasNext()) {
-      QString prn = it.next();
-      if (satData.contains(prn)) {
-        delete satData.take(prn);
-      }
-    }
-
-    if (lastOutlierPrn[0] == 'R' || lastOutlierPrn[0] == 'C') {
-      _outlierGPS.clear();
-      return success;
-    }
-
-    // GPS Outlier appeared for the first time - try to delete it
-    // ----------------------------------------------------------
-    if (_outlierGPS.indexOf(lastOutlierPrn) == -1) {
-      _outlierGPS << lastOutlierPrn;
-      if (satData.contains(lastOutlierPrn)) {
-        delete satData.take(lastOutlierPrn);
-      }
-      return success;
-    }
-
-  }
-
-  return failure;
-}
-
 //
 ////////////////////////////////////////////////////////////////////////////
 double lorentz(const ColumnVector& aa, const ColumnVector& bb) {
@@ -1349,10 +1555,9 @@ void t_pppFilter::cmpDOP(t_epoData* epoData) {
 
   const unsigned numPar = 4;
   Matrix AA(epoData->sizeAll(), numPar);
-  QMapIterator<QString, t_satData*> it(epoData->satData);
+  t_epoData::t_iterator it(epoData);
   while (it.hasNext()) {
-    it.next();
-    t_satData* satData = it.value();
+    t_satData* satData = it.next();
     _numSat += 1;
     for (unsigned iPar = 0; iPar < numPar; iPar++) {
       AA[_numSat-1][iPar] = _params[iPar]->partial(satData, false);
@@ -33,8 +33,8 @@
 
 #include "bncconst.h"
 #include "bnctime.h"
-
-class bncAntex;
+#include "t_prn.h"
+#include "bncantex.h"
 
 namespace BNC_PPP {
 
@@ -66,8 +66,26 @@ class t_satData {
     rho      = 0.0;
     slipFlag = false;
     lambda3  = 0.0;
+    for (int ii = 0; ii < 3; ii++) {
+      xx[ii] = 0.0;
+      vv[ii] = 0.0;
+    }
   }
   ~t_satData() {}
+  void reset() {
+    obsIndex = 0;
+    P1       = 0.0;
+    P2       = 0.0;
+    P5       = 0.0;
+    P7       = 0.0;
+    P3       = 0.0;
+    L1       = 0.0;
+    L2       = 0.0;
+    L5       = 0.0;
+    L7       = 0.0;
+    L3       = 0.0;
+    slipFlag = false;
+  }
   bncTime      tt;
   QString      prn;
   double       P1;
@@ -80,8 +98,8 @@ class t_satData {
   double       L5;
   double       L7;
   double       L3;
-  ColumnVector xx;
-  ColumnVector vv;
+  double       xx[3];
+  double       vv[3];
   double       clk;
   double       eleSat;
   double       azSat;
@@ -91,52 +109,153 @@ class t_satData {
   double       lkA;
   double       lkB;
   unsigned     obsIndex;
-  char system() const {return prn.toLatin1()[0];}
+  char system() const {return prn.isEmpty() ? '\x0' : prn[0].toLatin1();}
 };
 
+// Satellites of an epoch in fixed slots indexed by system and PRN number.
+// The slots (ordered C, E, G, R as the internal PRN strings) are allocated
+// once and re-used from epoch to epoch.
+////////////////////////////////////////////////////////////////////////////
 class t_epoData {
  public:
-  t_epoData() {}
+  static const int numSys = 4;
+  static const int maxSat = t_prn::MAXPRN_BDS + t_prn::MAXPRN_GALILEO +
+                            t_prn::MAXPRN_GPS + t_prn::MAXPRN_GLONASS;
 
-  ~t_epoData() {
+  // Iterator over the satellites of the epoch (or of one system only);
+  // a satellite may be removed while iterating
+  class t_iterator {
+   public:
+    t_iterator(const t_epoData* epoData, char system = '\x0') : _epoData(epoData) {
+      int iSys = sysIndex(system);
+      _iSat   = (iSys < 0) ? 0       : _first[iSys];
+      _endSat = (iSys < 0) ? maxSat  : _first[iSys] + _maxPrn[iSys];
+    }
+    bool hasNext() {
+      while (_iSat < _endSat && !_epoData->_used[_iSat]) {
+        ++_iSat;
+      }
+      return _iSat < _endSat;
+    }
+    t_satData* next() {return &_epoData->_satData[_iSat++];}
+   private:
+    const t_epoData* _epoData;
+    int              _iSat;
+    int              _endSat;
+  };
+
+  t_epoData() {
+    _satData = new t_satData[maxSat];
     clear();
   }
 
+  ~t_epoData() {
+    delete [] _satData;
+  }
+
   void clear() {
-    QMapIterator<QString, t_satData*> it(satData);
-    while (it.hasNext()) {
-      it.next();
-      delete it.value();
+    for (int iSat = 0; iSat < maxSat; iSat++) {
+      _used[iSat] = false;
+    }
+    for (int iSys = 0; iSys < numSys; iSys++) {
+      _numSat[iSys] = 0;
     }
-    satData.clear();
     tt.reset();
   }
 
   void deepCopy(const t_epoData* from) {
-    clear();
     tt = from->tt;
-    QMapIterator<QString, t_satData*> it(from->satData);
-    while (it.hasNext()) {
-      it.next();
-      satData[it.key()] = new t_satData(*it.value());
+    for (int iSat = 0; iSat < maxSat; iSat++) {
+      _used[iSat] = from->_used[iSat];
+      if (_used[iSat]) {
+        _satData[iSat] = from->_satData[iSat];
+      }
     }
+    for (int iSys = 0; iSys < numSys; iSys++) {
+      _numSat[iSys] = from->_numSat[iSys];
+    }
+  }
+
+  // Slot of a new satellite (0 if the satellite is not supported)
+  t_satData* insert(const t_prn& prn) {
+    int iSat = satIndex(prn.system(), prn.number());
+    if (iSat < 0) {
+      return 0;
+    }
+    t_satData* satData = &_satData[iSat];
+    if (!_used[iSat]) {
+      _used[iSat] = true;
+      ++_numSat[sysIndex(prn.system())];
+    }
+    // the internal string (e.g. G05_0) is kept as long as the flags agree
+    if (satData->prn.isEmpty() || satData->prn[4].digitValue() != int(prn.flags())) {
+      satData->prn = QString(prn.toInternalString().c_str());
+    }
+    satData->reset();
+    return satData;
+  }
+
+  void remove(const t_satData* satData) {
+    int iSat = satData - _satData;
+    if (_used[iSat]) {
+      _used[iSat] = false;
+      --_numSat[sysIndex(satData->system())];
+    }
+  }
+
+  void remove(const QString& prn) {
+    t_satData* satData = find(prn);
+    if (satData) {
+      remove(satData);
+    }
+  }
+
+  // Satellite given by the internal PRN string (0 if not in the epoch)
+  t_satData* find(const QString& prn) const {
+    if (prn.length() < 3) {
+      return 0;
+    }
+    int iSat = satIndex(prn[0].toLatin1(), prn[1].digitValue() * 10 + prn[2].digitValue());
+    return (iSat >= 0 && _used[iSat]) ? &_satData[iSat] : 0;
   }
 
   unsigned sizeSys(char system) const {
-    unsigned ans = 0;
-    QMapIterator<QString, t_satData*> it(satData);
-    while (it.hasNext()) {
-      it.next();
-      if (it.value()->system() == system) {
-        ++ans;
-      }
+    int iSys = sysIndex(system);
+    return (iSys < 0) ? 0 : _numSat[iSys];
+  }
+  unsigned sizeAll() const {
+    return _numSat[0] + _numSat[1] + _numSat[2] + _numSat[3];
+  }
+
+  bncTime tt;
+
+ private:
+  static int sysIndex(char system) {
+    switch (system) {
+      case 'C': return 0;
+      case 'E': return 1;
+      case 'G': return 2;
+      case 'R': return 3;
+    }
+    return -1;
+  }
+  static int satIndex(char system, int number) {
+    int iSys = sysIndex(system);
+    if (iSys < 0 || number < 1 || number > _maxPrn[iSys]) {
+      return -1;
     }
-    return ans;
+    return _first[iSys] + number - 1;
   }
-  unsigned sizeAll() const {return satData.size();}
 
-  bncTime                   tt;
-  QMap<QString, t_satData*> satData;
+  static const int _maxPrn[numSys];
+  static const int _first[numSys];
+
+  t_epoData(const t_epoData&);
+  t_epoData& operator=(const t_epoData&);
+
+  t_satData* _satData;
+  bool       _used[maxSat];
+  unsigned   _numSat[numSys];
 };
 
 class t_pppParam {
@@ -223,21 +342,31 @@ class t_pppFilter {
   void   cmpEle(t_satData* satData);
   void   addAmb(t_satData* satData);
   void   addObs(int iPhase, unsigned& iObs, t_satData* satData,
-                Matrix& AA, ColumnVector& ll, DiagonalMatrix& PP);
+                Matrix& AA, ColumnVector& ll, DiagonalMatrix& PP,
+                QVector<int>& idx);
   QByteArray printRes(int iPhase, const ColumnVector& vv,
-                      const QMap<QString, t_satData*>& satDataMap);
+                      const t_epoData* epoData);
   void   findMaxRes(const ColumnVector& vv,
-                    const QMap<QString, t_satData*>& satData,
+                    const t_epoData* epoData,
                     QString& prnGPS, QString& prnGlo,
                     double& maxResGPS, double& maxResGlo);
   double cmpValue(t_satData* satData, bool phase);
   double delay_saast(double Ele);
   void   predict(int iPhase, t_epoData* epoData);
   t_irc  update_p(t_epoData* epoData);
+  void   removeAmb(t_epoData* epoData);
+  void   kalmanUpdate(const Matrix& AA, const ColumnVector& ll,
+                      const DiagonalMatrix& PP,
+                      const QVector< QVector<int> >& AI,
+                      SymmetricMatrix& QQ, ColumnVector& dx);
+  void   addNormal(const Matrix& AA, const ColumnVector& ll,
+                   const DiagonalMatrix& PP,
+                   const QVector<int>& idx, int iObs, double sign,
+                   UpperTriangularMatrix& RR, ColumnVector& bb);
   QString outlierDetection(int iPhase, const ColumnVector& vv,
-                           QMap<QString, t_satData*>& satData);
+                           const t_epoData* epoData);
 
-  double windUp(const QString& prn, const ColumnVector& rSat,
+  double windUp(const QString& prn, const double* xSat,
                 const ColumnVector& rRec);
 
   bncTime  _startTime;
@@ -245,9 +374,6 @@ class t_pppFilter {
   void rememberState(t_epoData* epoData);
   void restoreState(t_epoData* epoData);
 
-  t_irc selectSatellites(const QString& lastOutlierPrn,
-                         QMap<QString, t_satData*>& satData);
-
   void bancroft(const Matrix& BBpass, ColumnVector& pos);
 
   void cmpDOP(t_epoData* epoData);
@@ -267,6 +393,7 @@ class t_pppFilter {
   QStringList           _outlierGPS;
   QStringList           _outlierGlo;
   bncAntex*             _antex;
+  const bncAntex::t_frqMap* _rcvFrqMap[t_frequency::max];  // receiver antenna
   t_tides*              _tides;
   ColumnVector          _neu;
   int                   _numSat;
@@ -354,12 +354,12 @@ void RTCM2Decoder::translateCorr2Obs(vector<string>& errmsg) {
       }
 
       // Select corresponding ephemerides
-      const t_eph* ephLast = _ephUser.ephLast(prn);
-      const t_eph* ephPrev = _ephUser.ephPrev(prn);
+      QSharedPointer<const t_eph> ephLast = _ephUser.ephLast(prn);
+      QSharedPointer<const t_eph> ephPrev = _ephUser.ephPrev(prn);
       if (ephLast && ephLast->IOD() == IODcorr) {
-        eph = ephLast;
+        eph = ephLast.data();
       } else if (ephPrev && ephPrev->IOD() == IODcorr) {
-        eph = ephPrev;
+        eph = ephPrev.data();
       }
 
       if (eph) {
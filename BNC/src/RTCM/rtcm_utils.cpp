@@ -36,7 +36,7 @@ int cmpRho(const t_eph* eph,
   rho = 0.0;
   ColumnVector xc(4);
   ColumnVector vv(3);
-  eph->getCrd(bncTime(GPSWeek, GPSWeeks), xc, vv, false);
+  eph->getCrd(bncTime(GPSWeek, GPSWeeks), xc, vv);
   xSat   = xc(1);
   ySat   = xc(2);
   zSat   = xc(3);
@@ -81,7 +81,7 @@ int cmpRho(const t_eph* eph,
       GPSWeek_tot  += 1;
     }
       
-    eph->getCrd(bncTime(GPSWeek_tot, GPSWeeks_tot), xc, vv, false);
+    eph->getCrd(bncTime(GPSWeek_tot, GPSWeeks_tot), xc, vv);
     xSat   = xc(1);
     ySat   = xc(2);
     zSat   = xc(3);
@@ -42,6 +42,7 @@
 #include <newmatio.h>
 
 #include "bncantex.h"
+#include "bncbincache.h"
 #include "pppModel.h"
 
 using namespace std;
@@ -49,11 +50,13 @@ using namespace std;
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 bncAntex::bncAntex() {
+  resolveSatMaps();
 }
 
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 bncAntex::bncAntex(const char* fileName) {
+  resolveSatMaps();
   readFile(QString(fileName));
 }
 
@@ -121,6 +124,17 @@ QString bncAntex::pcoSinexString(const std::string& antName, t_frequency::type f
 ////////////////////////////////////////////////////////////////////////////
 t_irc bncAntex::readFile(const QString& fileName) {
 
+  // Binary cache of the parsed file
+  // -------------------------------
+  bncBinCache  cache(fileName, "antex", 1);
+  QDataStream* cacheIn = cache.in();
+  if (cacheIn && readCache(*cacheIn) == success) {
+    resolveSatMaps();
+    return success;
+  }
+
+  QStringList antNames;
+
   QFile inFile(fileName);
   inFile.open(QIODevice::ReadOnly | QIODevice::Text);
 
@@ -128,6 +142,7 @@ t_irc bncAntex::readFile(const QString& fileName) {
 
   t_antMap* newAntMap = 0;
   t_frqMap* newFrqMap = 0;
+  int       nAziRows  = 0;
 
   while ( !in.atEnd() ) {
     QString line = in.readLine();
@@ -153,6 +168,7 @@ t_irc bncAntex::readFile(const QString& fileName) {
           delete _maps[newAntMap->antName];
         }
         _maps[newAntMap->antName] = newAntMap;
+        antNames << newAntMap->antName;
         newAntMap = 0;
       }
       else {
@@ -181,6 +197,10 @@ t_irc bncAntex::readFile(const QString& fileName) {
         QTextStream inLine(&line, QIODevice::ReadOnly);
         inLine >> newAntMap->zen1 >> newAntMap->zen2 >> newAntMap->dZen;
       }
+      else if (line.indexOf("DAZI") == 60) {
+        QTextStream inLine(&line, QIODevice::ReadOnly);
+        inLine >> newAntMap->dAzi;
+      }
 
       // Start of Frequency
       // ------------------
@@ -192,6 +212,7 @@ t_irc bncAntex::readFile(const QString& fileName) {
         }
         else {
           newFrqMap = new t_frqMap();
+          nAziRows  = 0;
         }
       }
 
@@ -248,6 +269,10 @@ t_irc bncAntex::readFile(const QString& fileName) {
           else if (line.indexOf("C07") == 3) {
             frqType = t_frequency::C7;
           }
+          if (newFrqMap->nAzi > 0 && nAziRows != newFrqMap->nAzi) {
+            newFrqMap->nAzi = 0;   // incomplete azimuth table
+            newFrqMap->aziPattern.clear();
+          }
           if (frqType != t_frequency::dummy) {
             if (newAntMap->frqMap.find(frqType) != newAntMap->frqMap.end()) {
               delete newAntMap->frqMap[frqType];
@@ -285,6 +310,33 @@ t_irc bncAntex::readFile(const QString& fileName) {
             inLine >> newFrqMap->pattern[ii];
           }
           newFrqMap->pattern *= 1e-3;
+          newFrqMap->zen1 = newAntMap->zen1;
+          newFrqMap->dZen = newAntMap->dZen;
+          newFrqMap->nZen = nPat;
+          if (newAntMap->dAzi > 0.0) {
+            newFrqMap->dAzi = newAntMap->dAzi;
+            newFrqMap->nAzi = qRound(360.0 / newAntMap->dAzi) + 1;
+            newFrqMap->aziPattern.assign(newFrqMap->nAzi * nPat, 0.0);
+          }
+        }
+
+        // Azimuth-dependent pattern (one row per azimuth, no label)
+        // ---------------------------------------------------------
+        else if (newFrqMap->nAzi > 0) {
+          QTextStream inLine(&line, QIODevice::ReadOnly);
+          QString aziStr;
+          inLine >> aziStr;
+          bool   ok;
+          double azi  = aziStr.toDouble(&ok);
+          int    iAzi = ok ? qRound(azi / newFrqMap->dAzi) : -1;
+          if (iAzi >= 0 && iAzi < newFrqMap->nAzi) {
+            double* row = &newFrqMap->aziPattern[iAzi * newFrqMap->nZen];
+            for (int ii = 0; ii < newFrqMap->nZen; ii++) {
+              inLine >> row[ii];
+              row[ii] *= 1e-3;
+            }
+            ++nAziRows;
+          }
         }
       }
     }
@@ -293,97 +345,259 @@ t_irc bncAntex::readFile(const QString& fileName) {
   delete newFrqMap;
   delete newAntMap;
 
+  resolveSatMaps();
+
+  QByteArray payload;
+  QDataStream out(&payload, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_0);
+  antNames.removeDuplicates();
+  writeCache(out, antNames);
+  cache.save(payload);
+
   return success;
 }
 
+// Write the antennas read from one file into the binary cache
+////////////////////////////////////////////////////////////////////////////
+void bncAntex::writeCache(QDataStream& out, const QStringList& antNames) const {
+
+  out << quint32(antNames.size());
+  for (int iAnt = 0; iAnt < antNames.size(); iAnt++) {
+    const t_antMap* map = _maps[antNames[iAnt]];
+    out << map->antName << map->zen1 << map->zen2 << map->dZen << map->dAzi
+        << quint32(map->frqMap.size());
+    QMapIterator<t_frequency::type, t_frqMap*> itFrq(map->frqMap);
+    while (itFrq.hasNext()) {
+      itFrq.next();
+      const t_frqMap* frqMap = itFrq.value();
+      out << qint32(itFrq.key())
+          << frqMap->neu[0] << frqMap->neu[1] << frqMap->neu[2]
+          << frqMap->zen1 << frqMap->dZen << qint32(frqMap->nZen)
+          << frqMap->dAzi << qint32(frqMap->nAzi);
+      out << quint32(frqMap->pattern.Nrows());
+      for (int ii = 0; ii < frqMap->pattern.Nrows(); ii++) {
+        out << frqMap->pattern[ii];
+      }
+      out << quint32(frqMap->aziPattern.size());
+      for (unsigned ii = 0; ii < frqMap->aziPattern.size(); ii++) {
+        out << frqMap->aziPattern[ii];
+      }
+    }
+  }
+}
+
+// Read the antennas from the binary cache
+////////////////////////////////////////////////////////////////////////////
+t_irc bncAntex::readCache(QDataStream& in) {
+
+  const quint32 maxSize = 100000;   // protection against corrupted files
+
+  QList<t_antMap*> newMaps;
+  quint32 nAnt = 0;
+  in >> nAnt;
+  for (quint32 iAnt = 0; iAnt < nAnt && in.status() == QDataStream::Ok; iAnt++) {
+    t_antMap* map = new t_antMap();
+    newMaps << map;
+    quint32 nFrq = 0;
+    in >> map->antName >> map->zen1 >> map->zen2 >> map->dZen >> map->dAzi >> nFrq;
+    for (quint32 iFrq = 0; iFrq < nFrq && in.status() == QDataStream::Ok; iFrq++) {
+      qint32  frqType = 0, nZen = 0, nAzi = 0;
+      quint32 nPat = 0;
+      t_frqMap* frqMap = new t_frqMap();
+      in >> frqType
+         >> frqMap->neu[0] >> frqMap->neu[1] >> frqMap->neu[2]
+         >> frqMap->zen1 >> frqMap->dZen >> nZen
+         >> frqMap->dAzi >> nAzi >> nPat;
+      frqMap->nZen = nZen;
+      frqMap->nAzi = nAzi;
+      if (map->frqMap.contains(t_frequency::type(frqType))) {
+        delete map->frqMap[t_frequency::type(frqType)];
+      }
+      map->frqMap[t_frequency::type(frqType)] = frqMap;
+      if (nPat > maxSize) {
+        qDeleteAll(newMaps);
+        return failure;
+      }
+      if (nPat > 0) {
+        frqMap->pattern.ReSize(nPat);
+        for (quint32 ii = 0; ii < nPat; ii++) {
+          in >> frqMap->pattern[ii];
+        }
+      }
+      in >> nPat;
+      if (nPat > maxSize) {
+        qDeleteAll(newMaps);
+        return failure;
+      }
+      frqMap->aziPattern.resize(nPat);
+      for (quint32 ii = 0; ii < nPat; ii++) {
+        in >> frqMap->aziPattern[ii];
+      }
+    }
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    qDeleteAll(newMaps);
+    return failure;
+  }
+
+  for (int ii = 0; ii < newMaps.size(); ii++) {
+    t_antMap* map = newMaps[ii];
+    if (_maps.contains(map->antName)) {
+      delete _maps[map->antName];
+    }
+    _maps[map->antName] = map;
+  }
+
+  return success;
+}
+
+// Satellite antenna offsets indexed by PRN (G: L1, R: L1)
+////////////////////////////////////////////////////////////////////////////
+void bncAntex::resolveSatMaps() {
+
+  for (unsigned ii = 0; ii <= t_prn::MAXPRN; ii++) {
+    _satMaps[ii] = 0;
+  }
+
+  QMapIterator<QString, t_antMap*> it(_maps);
+  while (it.hasNext()) {
+    it.next();
+    const QString& antName = it.key();
+    if (antName.length() != 3) {
+      continue;
+    }
+    t_frequency::type frqType = t_frequency::dummy;
+    if      (antName[0] == 'G') {
+      frqType = t_frequency::G1;
+    }
+    else if (antName[0] == 'R') {
+      frqType = t_frequency::R1;
+    }
+    QMap<t_frequency::type, t_frqMap*>::const_iterator itFrq = it.value()->frqMap.constFind(frqType);
+    if (itFrq == it.value()->frqMap.constEnd()) {
+      continue;
+    }
+    int number = antName.mid(1,2).toInt();
+    if (number > 0) {
+      unsigned iPrn = t_prn(antName[0].toLatin1(), number).toInt();
+      if (iPrn > 0 && iPrn <= t_prn::MAXPRN) {
+        _satMaps[iPrn] = itFrq.value();
+      }
+    }
+  }
+}
+
 // Satellite Antenna Offset
 ////////////////////////////////////////////////////////////////////////////
 t_irc bncAntex::satCoMcorrection(const QString& prn, double Mjd,
                                  const ColumnVector& xSat, ColumnVector& dx) {
 
-  t_frequency::type frqType = t_frequency::dummy;
-
-  if      (prn[0] == 'G') {
-    frqType = t_frequency::G1;
+  int number = prn.mid(1,2).toInt();
+  if (number <= 0) {
+    return failure;
   }
-  else if (prn[0] == 'R') {
-    frqType = t_frequency::R1;
+  unsigned iPrn = t_prn(prn[0].toLatin1(), number).toInt();
+  if (iPrn == 0 || iPrn > t_prn::MAXPRN || _satMaps[iPrn] == 0) {
+    return failure;
   }
 
-  QMap<QString, t_antMap*>::const_iterator it = _maps.find(prn.mid(0,3));
-  if (it != _maps.end()) {
-    t_antMap* map = it.value();
-    if (map->frqMap.find(frqType) != map->frqMap.end()) {
+  const double* neu = _satMaps[iPrn]->neu;
+
+  // Unit Vectors sz, sy, sx
+  // -----------------------
+  double rSat = sqrt(xSat[0]*xSat[0] + xSat[1]*xSat[1] + xSat[2]*xSat[2]);
+  double sz[3] = {-xSat[0] / rSat, -xSat[1] / rSat, -xSat[2] / rSat};
 
-      double* neu = map->frqMap[frqType]->neu;
+  BNC_PPP::t_astroState astro;
+  BNC_PPP::t_astro::state(Mjd, astro);
+  const double* xSun = astro._xSun;
 
-      // Unit Vectors sz, sy, sx
-      // -----------------------
-      ColumnVector sz = -xSat;
-      sz /= sqrt(DotProduct(sz,sz));
+  double sy[3] = {sz[1] * xSun[2] - sz[2] * xSun[1],
+                  sz[2] * xSun[0] - sz[0] * xSun[2],
+                  sz[0] * xSun[1] - sz[1] * xSun[0]};
+  double rSy = sqrt(sy[0]*sy[0] + sy[1]*sy[1] + sy[2]*sy[2]);
+  sy[0] /= rSy;  sy[1] /= rSy;  sy[2] /= rSy;
 
-      ColumnVector xSun = BNC_PPP::t_astro::Sun(Mjd);
-      xSun /= sqrt(DotProduct(xSun,xSun));
+  double sx[3] = {sy[1] * sz[2] - sy[2] * sz[1],
+                  sy[2] * sz[0] - sy[0] * sz[2],
+                  sy[0] * sz[1] - sy[1] * sz[0]};
 
-      ColumnVector sy = crossproduct(sz, xSun);
-      sy /= sqrt(DotProduct(sy,sy));
+  dx[0] = sx[0] * neu[0] + sy[0] * neu[1] + sz[0] * neu[2];
+  dx[1] = sx[1] * neu[0] + sy[1] * neu[1] + sz[1] * neu[2];
+  dx[2] = sx[2] * neu[0] + sy[2] * neu[1] + sz[2] * neu[2];
 
-      ColumnVector sx = crossproduct(sy, sz);
+  return success;
+}
 
-      dx[0] = sx[0] * neu[0] + sy[0] * neu[1] + sz[0] * neu[2];
-      dx[1] = sx[1] * neu[0] + sy[1] * neu[1] + sz[1] * neu[2];
-      dx[2] = sx[2] * neu[0] + sy[2] * neu[1] + sz[2] * neu[2];
+// Phase center variation, linear in zenith and azimuth (angles in degrees)
+////////////////////////////////////////////////////////////////////////////
+double bncAntex::t_frqMap::pcv(double zenSat, double aziSat) const {
 
-      return success;
-    }
+  if (nZen == 0) {
+    return 0.0;
+  }
+  if (nZen == 1 || dZen <= 0.0) {
+    return pattern[0];
   }
 
-  return failure;
+  double xZen = (zenSat - zen1) / dZen;
+  if      (xZen < 0.0) {
+    xZen = 0.0;
+  }
+  else if (xZen > nZen - 1) {
+    xZen = nZen - 1;
+  }
+  int iZen = qMin(int(xZen), nZen - 2);
+  double fZen = xZen - iZen;
+
+  if (nAzi < 2) {
+    return (1.0 - fZen) * pattern[iZen] + fZen * pattern[iZen+1];
+  }
+
+  double xAzi = fmod(aziSat, 360.0);
+  if (xAzi < 0.0) {
+    xAzi += 360.0;
+  }
+  xAzi /= dAzi;
+  int iAzi = qMin(int(xAzi), nAzi - 2);
+  double fAzi = xAzi - iAzi;
+
+  const double* row1 = &aziPattern[iAzi * nZen];
+  const double* row2 = row1 + nZen;
+  return (1.0 - fAzi) * ((1.0 - fZen) * row1[iZen] + fZen * row1[iZen+1]) +
+                fAzi  * ((1.0 - fZen) * row2[iZen] + fZen * row2[iZen+1]);
 }
 
-//
+// Antenna and frequency resolved once by the caller; 0 if not found
 ////////////////////////////////////////////////////////////////////////////
-double bncAntex::rcvCorr(const string& antName, t_frequency::type frqType,
-                         double eleSat, double azSat, bool& found) const {
+const bncAntex::t_frqMap* bncAntex::rcvFrqMap(const string& antName,
+                                              t_frequency::type frqType) const {
 
   if (antName.find("NULLANTENNA") != string::npos) {
-    found = true;
-    return 0.0;
+    return &_nullFrqMap;
   }
 
-  QString antNameQ = antName.c_str();
-
-  if (_maps.find(antNameQ) == _maps.end()) {
-    found = false;
-    return 0.0;
+  QMap<QString, t_antMap*>::const_iterator it = _maps.constFind(QString(antName.c_str()));
+  if (it == _maps.constEnd()) {
+    return 0;
   }
 
-  t_antMap* map = _maps[antNameQ];
-  if (map->frqMap.find(frqType) == map->frqMap.end()) {
-    found = false;
-    return 0.0;
+  QMap<t_frequency::type, t_frqMap*>::const_iterator itFrq = it.value()->frqMap.constFind(frqType);
+  if (itFrq == it.value()->frqMap.constEnd()) {
+    return 0;
   }
 
-  t_frqMap* frqMap = map->frqMap[frqType];
+  return itFrq.value();
+}
 
-  double var = 0.0;
-  if (frqMap->pattern.ncols() > 0) {
-    double zenDiff = 999.999;
-    double zenSat  = 90.0 - eleSat * 180.0 / M_PI;
-    unsigned iZen = 0;
-    for (double zen = map->zen1; zen <= map->zen2; zen += map->dZen) {
-      iZen += 1;
-      double newZenDiff = fabs(zen - zenSat);
-      if (newZenDiff < zenDiff) {
-        zenDiff = newZenDiff;
-        var = frqMap->pattern(iZen);
-      }
-    }
-  }
+//
+////////////////////////////////////////////////////////////////////////////
+double bncAntex::rcvCorr(const t_frqMap* frqMap, double eleSat, double azSat) const {
+
+  double var = frqMap->pcv(90.0 - eleSat * 180.0 / M_PI, azSat * 180.0 / M_PI);
 
-  found = true;
   return var - frqMap->neu[0] * cos(azSat)*cos(eleSat)
              - frqMap->neu[1] * sin(azSat)*cos(eleSat)
              - frqMap->neu[2] * sin(eleSat);
-
 }
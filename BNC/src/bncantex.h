@@ -27,41 +27,58 @@
 
 #include <QtCore>
 #include <string>
+#include <vector>
 #include <newmat.h>
 #include "bncconst.h"
 #include "bnctime.h"
+#include "t_prn.h"
 
 class bncAntex {
  public:
+  // Phase center offset and variations of one antenna and frequency; the
+  // zenith (and azimuth) grid is stored row-wise for direct indexing
+  class t_frqMap {
+   public:
+    t_frqMap() {
+      for (unsigned ii = 0; ii < 3; ii++) {
+        neu[ii] = 0.0;
+      }
+      zen1 = 0.0;
+      dZen = 0.0;
+      nZen = 0;
+      dAzi = 0.0;
+      nAzi = 0;
+    }
+    double pcv(double zenSat, double aziSat) const;
+    double              neu[3];
+    ColumnVector        pattern;     // azimuth-independent (NOAZI)
+    double              zen1;
+    double              dZen;
+    int                 nZen;
+    double              dAzi;
+    int                 nAzi;        // azimuth rows 0 .. 360 deg, 0: no table
+    std::vector<double> aziPattern;  // nAzi * nZen
+  };
+
   bncAntex(const char* fileName);
   bncAntex();
   ~bncAntex();
   t_irc   readFile(const QString& fileName);
   void    print() const;
   QString pcoSinexString(const std::string& antName, t_frequency::type frqType);
-  double  rcvCorr(const std::string& antName, t_frequency::type frqType,
-                  double eleSat, double azSat, bool& found) const;
+  const t_frqMap* rcvFrqMap(const std::string& antName, t_frequency::type frqType) const;
+  double  rcvCorr(const t_frqMap* frqMap, double eleSat, double azSat) const;
   t_irc   satCoMcorrection(const QString& prn, double Mjd,
                            const ColumnVector& xSat, ColumnVector& dx);
 
  private:
-  class t_frqMap {
-   public:
-    t_frqMap() {
-      for (unsigned ii = 0; ii < 3; ii++) {
-        neu[ii] = 0.0;
-      }
-    }
-    double       neu[3];
-    ColumnVector pattern;
-  };
-
   class t_antMap {
    public:
     t_antMap() {
       zen1 = 0.0;
       zen2 = 0.0;
       dZen = 0.0;
+      dAzi = 0.0;
     }
     ~t_antMap() {
       QMapIterator<t_frequency::type, t_frqMap*> it(frqMap);
@@ -74,12 +91,19 @@ class bncAntex {
     double                             zen1;
     double                             zen2;
     double                             dZen;
+    double                             dAzi;
     QMap<t_frequency::type, t_frqMap*> frqMap;
     bncTime                            validFrom;
     bncTime                            validTo;
   };
 
+  void  resolveSatMaps();
+  void  writeCache(QDataStream& out, const QStringList& antNames) const;
+  t_irc readCache(QDataStream& in);
+
   QMap<QString, t_antMap*> _maps;
+  t_frqMap                 _nullFrqMap;                 // NULLANTENNA
+  const t_frqMap*          _satMaps[t_prn::MAXPRN+1];   // satellite PCOs by PRN
 };
 
 #endif
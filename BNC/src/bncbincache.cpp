@@ -0,0 +1,162 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+/* -------------------------------------------------------------------------
+ * BKG NTRIP Client
+ * -------------------------------------------------------------------------
+ *
+ * Class:      bncBinCache
+ *
+ * Purpose:    Memory-Mapped Binary Cache of Parsed Model Files
+ *
+ * Created:    18-Oct-2026
+ *
+ * Changes:
+ *
+ * -----------------------------------------------------------------------*/
+
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "bncbincache.h"
+
+// Constructor - the cache is used only if it matches the source file
+////////////////////////////////////////////////////////////////////////////
+bncBinCache::bncBinCache(const QString& srcFileName, const QByteArray& type,
+                         quint32 version) {
+
+  _srcFileName = srcFileName;
+  _type        = type;
+  _version     = version;
+  _in          = 0;
+  _srcSize     = 0;
+  _srcTime     = 0;
+
+  QFileInfo srcInfo(srcFileName);
+  if (!srcInfo.isReadable()) {
+    return;
+  }
+  _srcSize = srcInfo.size();
+  _srcTime = srcInfo.lastModified().toMSecsSinceEpoch();
+
+  QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+  if (cacheDir.isEmpty() || !QDir().mkpath(cacheDir + "/bnc")) {
+    return;
+  }
+  QByteArray srcPath = srcInfo.absoluteFilePath().toUtf8();
+  _cacheFileName = cacheDir + "/bnc/" + QString(_type) + "_" +
+                   QCryptographicHash::hash(srcPath, QCryptographicHash::Md5).toHex() + ".bin";
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+bncBinCache::~bncBinCache() {
+  delete _in;
+}
+
+// MD5 hash of the source contents (computed on first use)
+////////////////////////////////////////////////////////////////////////////
+const QByteArray& bncBinCache::srcHash() {
+
+  if (_hash.isEmpty()) {
+    QFile srcFile(_srcFileName);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    if (srcFile.open(QIODevice::ReadOnly) && hash.addData(&srcFile)) {
+      _hash = hash.result();
+    }
+  }
+  return _hash;
+}
+
+// Payload of a valid cache (0 if there is none)
+////////////////////////////////////////////////////////////////////////////
+QDataStream* bncBinCache::in() {
+
+  if (_in || _cacheFileName.isEmpty()) {
+    return _in;
+  }
+
+  _file.setFileName(_cacheFileName);
+  if (!_file.open(QIODevice::ReadOnly)) {
+    return 0;
+  }
+  uchar* mem = _file.map(0, _file.size());
+  if (!mem) {
+    return 0;
+  }
+  _data = QByteArray::fromRawData(reinterpret_cast<const char*>(mem), int(_file.size()));
+
+  _in = new QDataStream(_data);
+  _in->setVersion(QDataStream::Qt_5_0);
+
+  quint32    magic;
+  QByteArray type;
+  quint32    version;
+  qint64     size;
+  qint64     time;
+  QByteArray hash;
+  *_in >> magic >> type >> version >> size >> time >> hash;
+
+  // The contents are compared only if the time stamp of the source changed
+  // ----------------------------------------------------------------------
+  if (_in->status() != QDataStream::Ok || magic != _magic ||
+      type != _type || version != _version || size != _srcSize ||
+      (time != _srcTime && hash != srcHash())) {
+    delete _in;
+    _in = 0;
+  }
+
+  // Same contents, new time stamp: stored with the new one, so that the
+  // source is not hashed again next time
+  // -------------------------------------------------------------------
+  else if (time != _srcTime) {
+    save(_data.mid(int(_in->device()->pos())));
+  }
+
+  return _in;
+}
+
+// Write the cache (atomically, readers never see a partial file)
+////////////////////////////////////////////////////////////////////////////
+t_irc bncBinCache::save(const QByteArray& payload) {
+
+  if (_cacheFileName.isEmpty() || srcHash().isEmpty()) {
+    return failure;
+  }
+
+  QSaveFile outFile(_cacheFileName);
+  if (!outFile.open(QIODevice::WriteOnly)) {
+    return failure;
+  }
+  QDataStream out(&outFile);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << _magic << _type << _version << _srcSize << _srcTime << _hash;
+  out.writeRawData(payload.constData(), payload.size());
+
+  if (out.status() != QDataStream::Ok || !outFile.commit()) {
+    return failure;
+  }
+  return success;
+}
@@ -0,0 +1,62 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef BNCBINCACHE_H
+#define BNCBINCACHE_H
+
+#include <QtCore>
+
+#include "bncconst.h"
+
+// Binary cache of a parsed text file (ANTEX, BLQ, ...). The cache file is
+// keyed by the source file path, stamped with a format version, the size
+// and modification time and the MD5 hash of the source contents, written
+// atomically and read memory-mapped, so that several BNC processes on one
+// host can share it. The source is hashed only if its time stamp changed.
+////////////////////////////////////////////////////////////////////////////
+class bncBinCache {
+ public:
+  bncBinCache(const QString& srcFileName, const QByteArray& type, quint32 version);
+  ~bncBinCache();
+  QDataStream* in();
+  t_irc        save(const QByteArray& payload);
+
+ private:
+  static const quint32 _magic = 0x424e4343;   // "BNCC"
+
+  const QByteArray& srcHash();
+
+  QString      _srcFileName;
+  qint64       _srcSize;
+  qint64       _srcTime;
+  QString      _cacheFileName;
+  QByteArray   _type;
+  quint32      _version;
+  QByteArray   _hash;
+  QFile        _file;
+  QByteArray   _data;
+  QDataStream* _in;
+};
+
+#endif
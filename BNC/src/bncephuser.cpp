@@ -37,6 +37,7 @@
  *
  * -----------------------------------------------------------------------*/
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -69,14 +70,6 @@ bncEphUser::bncEphUser(bool connectSlots) {
 // Destructor
 ////////////////////////////////////////////////////////////////////////////
 bncEphUser::~bncEphUser() {
-  QMapIterator<QString, deque<t_eph*> > it(_eph);
-  while (it.hasNext()) {
-    it.next();
-    const deque<t_eph*>& qq = it.value();
-    for (unsigned ii = 0; ii < qq.size(); ii++) {
-      delete qq[ii];
-    }
-  }
 }
 
 // New GPS Ephemeris
@@ -109,60 +102,157 @@ void bncEphUser::slotNewBDSEph(t_ephBDS eph) {
   putNewEph(&eph, false);
 }
 
-//
+// Satellite from internal string (e.g. E11_1)
 ////////////////////////////////////////////////////////////////////////////
-t_irc bncEphUser::putNewEph(t_eph* eph, bool check) {
-
-  QMutexLocker locker(&_mutex);
-
-  if (eph == 0) {
-    return failure;
+t_prn bncEphUser::toPrn(const QString& prn) {
+  int nn = prn.size();
+  if (nn < 2) {
+    return t_prn('\0', 0);
+  }
+  int number = 0;
+  int ii     = 1;
+  while (ii < nn && prn[ii].isDigit()) {
+    number = 10 * number + prn[ii].digitValue();
+    ++ii;
+  }
+  int flags = 0;
+  if (ii < nn && prn[ii] == '_') {
+    while (++ii < nn && prn[ii].isDigit()) {
+      flags = 10 * flags + prn[ii].digitValue();
+    }
   }
+  return t_prn(prn[0].toLatin1(), number, flags);
+}
 
-  if (check) {
-    checkEphemeris(eph);
+// Satellites with stored Ephemerides (internal strings, sorted)
+////////////////////////////////////////////////////////////////////////////
+const QList<QString> bncEphUser::prnList() const {
+  QList<QString> prns;
+  for (int index = 0; index < _numSlots; index++) {
+    std::shared_ptr<const t_slot> slot = std::atomic_load(&_slots[index]);
+    if (slot && slot->_size > 0) {
+      prns << QString(slot->_eph[slot->_size-1]->prn().toInternalString().c_str());
+    }
   }
+  std::sort(prns.begin(), prns.end());
+  return prns;
+}
+
+// One shared instance of identical ephemerides (takes ownership of eph)
+////////////////////////////////////////////////////////////////////////////
+QSharedPointer<const t_eph> bncEphUser::share(t_eph* eph) {
+
+  static QMutex                                         mutex;
+  static QHash<QByteArray, QWeakPointer<const t_eph> > ephs;
+  static int                                            maxSize = 1000;
 
-  const t_ephGPS*     ephGPS     = dynamic_cast<const t_ephGPS*>(eph);
-  const t_ephGlo*     ephGlo     = dynamic_cast<const t_ephGlo*>(eph);
-  const t_ephGal*     ephGal     = dynamic_cast<const t_ephGal*>(eph);
-  const t_ephSBAS*    ephSBAS    = dynamic_cast<const t_ephSBAS*>(eph);
-  const t_ephBDS*     ephBDS     = dynamic_cast<const t_ephBDS*>(eph);
+  QByteArray key = QByteArray(eph->prn().toInternalString().c_str())
+                 + ' ' + QByteArray::number(eph->fingerprint())
+                 + ' ' + QByteArray::number(int(eph->checkState()))
+                 + ' ' + QByteArray::number(eph->receptDateTime().toMSecsSinceEpoch());
 
-  t_eph* newEph = 0;
+  QMutexLocker locker(&mutex);
 
-  if      (ephGPS) {
-    newEph = new t_ephGPS(*ephGPS);
+  QSharedPointer<const t_eph> shared = ephs.value(key).toStrongRef();
+  if (shared) {
+    delete eph;
+    return shared;
+  }
+  shared = QSharedPointer<const t_eph>(eph);
+  ephs[key] = shared;
+
+  // Forget ephemerides no longer used by anybody
+  // --------------------------------------------
+  if (ephs.size() > maxSize) {
+    QMutableHashIterator<QByteArray, QWeakPointer<const t_eph> > it(ephs);
+    while (it.hasNext()) {
+      if (it.next().value().isNull()) {
+        it.remove();
+      }
+    }
+    maxSize = qMax(1000, 2 * ephs.size());
   }
-  else if (ephGlo) {
-    newEph = new t_ephGlo(*ephGlo);
+
+  return shared;
+}
+
+// Store a copy of the ephemeris
+////////////////////////////////////////////////////////////////////////////
+t_irc bncEphUser::putNewEph(const t_eph* eph, bool check) {
+  t_eph::e_checkState checkState;
+  return putEph(eph, check, checkState);
+}
+
+// Store a copy of the ephemeris, set its check state
+////////////////////////////////////////////////////////////////////////////
+t_irc bncEphUser::putNewEph(t_eph* eph, bool check) {
+  t_eph::e_checkState checkState;
+  t_irc irc = putEph(eph, check, checkState);
+  if (eph) {
+    eph->setCheckState(checkState);
   }
-  else if (ephGal) {
-    newEph = new t_ephGal(*ephGal);
+  return irc;
+}
+
+// Check and store a copy of the ephemeris (stored ephemerides are replaced,
+// not changed)
+////////////////////////////////////////////////////////////////////////////
+t_irc bncEphUser::putEph(const t_eph* eph, bool check, t_eph::e_checkState& checkState) {
+
+  if (eph == 0) {
+    return failure;
   }
-  else if (ephSBAS) {
-    newEph = new t_ephSBAS(*ephSBAS);
+  checkState = eph->checkState();
+
+  QMutexLocker locker(&_mutex);
+
+  int index = slotIndex(eph->prn());
+  std::shared_ptr<const t_slot> slotOld;
+  if (index >= 0) {
+    slotOld = std::atomic_load(&_slots[index]);
   }
-  else if (ephBDS) {
-    newEph = new t_ephBDS(*ephBDS);
+  QSharedPointer<const t_eph> ephOld;
+  if (slotOld && slotOld->_size > 0) {
+    ephOld = slotOld->_eph[slotOld->_size-1];
   }
-  else {
-    return failure;
+
+  t_eph* newEph = eph->clone();
+
+  if (check) {
+    t_eph::e_checkState stateOld = ephOld ? ephOld->checkState() : t_eph::unchecked;
+    checkEphemeris(newEph, ephOld.data(), stateOld);
+    checkState = newEph->checkState();
+
+    // New check state of the last stored ephemeris: store a changed copy
+    // -------------------------------------------------------------------
+    if (ephOld && stateOld != ephOld->checkState()) {
+      t_eph* ephHlp = ephOld->clone();
+      ephHlp->setCheckState(stateOld);
+      ephOld = share(ephHlp);
+      t_slot* slot = new t_slot(*slotOld);
+      slot->_eph[slot->_size-1] = ephOld;
+      slotOld.reset(slot);
+      std::atomic_store(&_slots[index], slotOld);
+    }
   }
 
-  QString prn(newEph->prn().toInternalString().c_str());
+  if (index >= 0 &&
+      (ephOld.isNull() || newEph->isNewerThan(ephOld.data())) &&
+      (newEph->checkState() != t_eph::bad &&
+       newEph->checkState() != t_eph::outdated)) {
 
-  const t_eph* ephOld = ephLast(prn);
+    QSharedPointer<const t_eph> ephNew = share(newEph);
 
-  if ((ephOld == 0 || newEph->isNewerThan(ephOld)) &&
-      (eph->checkState() != t_eph::bad &&
-       eph->checkState() != t_eph::outdated)) {
-    deque<t_eph*>& qq = _eph[prn];
-    qq.push_back(newEph);
-    if (qq.size() > _maxQueueSize) {
-      delete qq.front();
-      qq.pop_front();
+    t_slot* slot = slotOld ? new t_slot(*slotOld) : new t_slot();
+    if (slot->_size == _maxQueueSize) {
+      for (unsigned ii = 1; ii < slot->_size; ii++) {
+        slot->_eph[ii-1] = slot->_eph[ii];
+      }
+      --slot->_size;
     }
+    slot->_eph[slot->_size++] = ephNew;
+    std::atomic_store(&_slots[index], std::shared_ptr<const t_slot>(slot));
+
     ephBufferChanged();
     return success;
   }
@@ -174,7 +264,7 @@ t_irc bncEphUser::putNewEph(t_eph* eph, bool check) {
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void bncEphUser::checkEphemeris(t_eph* eph) {
+void bncEphUser::checkEphemeris(t_eph* eph, const t_eph* ephL, t_eph::e_checkState& stateL) {
 
   if (!eph || eph->checkState() == t_eph::ok || eph->checkState() == t_eph::bad) {
     return;
@@ -190,7 +280,7 @@ void bncEphUser::checkEphemeris(t_eph* eph) {
   // ----------------------------------------------
   ColumnVector xc(4);
   ColumnVector vv(3);
-  if (eph->getCrd(eph->TOC(), xc, vv, false) != success) {
+  if (eph->getCrd(eph->TOC(), xc, vv) != success) {
     eph->setCheckState(t_eph::bad);
     return;
   }
@@ -245,13 +335,11 @@ void bncEphUser::checkEphemeris(t_eph* eph) {
   // Check consistency with older ephemerides
   // ----------------------------------------
   const double MAXDIFF = 1000.0;
-  QString      prn     = QString(eph->prn().toInternalString().c_str());
-  t_eph*       ephL    = ephLast(prn);
 
   if (ephL) {
     ColumnVector xcL(4);
     ColumnVector vvL(3);
-    ephL->getCrd(eph->TOC(), xcL, vvL, false);
+    ephL->getCrd(eph->TOC(), xcL, vvL);
 
     double dt    = fabs(eph->TOC() - ephL->TOC());
     double diff  = (xc.Rows(1,3) - xcL.Rows(1,3)).norm_Frobenius();
@@ -259,42 +347,42 @@ void bncEphUser::checkEphemeris(t_eph* eph) {
 
     // some lines to allow update of ephemeris data sets after outage
     if      (eph->type() == t_eph::GPS     && dt > 4*3600) {
-      ephL->setCheckState(t_eph::outdated);
+      stateL = t_eph::outdated;
       return;
     }
     else if (eph->type() == t_eph::Galileo && dt > 4*3600) {
-      ephL->setCheckState(t_eph::outdated);
+      stateL = t_eph::outdated;
       return;
     }
     else if (eph->type() == t_eph::GLONASS && dt > 1*3600) {
-      ephL->setCheckState(t_eph::outdated);
+      stateL = t_eph::outdated;
       return;
     }
     else if (eph->type() == t_eph::QZSS    && dt > 4*3600) {
-      ephL->setCheckState(t_eph::outdated);
+      stateL = t_eph::outdated;
       return;
     }
     else if  (eph->type() == t_eph::SBAS   && dt > 600)    {
-      ephL->setCheckState(t_eph::outdated);
+      stateL = t_eph::outdated;
       return;
     }
     else if  (eph->type() == t_eph::BDS    && dt > 6*3600) {
-      ephL->setCheckState(t_eph::outdated);
+      stateL = t_eph::outdated;
       return;
     }
     else if  (eph->type() == t_eph::IRNSS  && dt > 24*3600) {
-      ephL->setCheckState(t_eph::outdated);
+      stateL = t_eph::outdated;
       return;
     }
 
     if (diff < MAXDIFF && diffC < MAXDIFF) {
       if (dt != 0.0) {
         eph->setCheckState(t_eph::ok);
-        ephL->setCheckState(t_eph::ok);
+        stateL = t_eph::ok;
       }
     }
     else {
-      if (ephL->checkState() == t_eph::ok) {
+      if (stateL == t_eph::ok) {
         eph->setCheckState(t_eph::bad);
       }
     }
@@ -25,7 +25,8 @@
 #ifndef BNCEPHUSER_H
 #define BNCEPHUSER_H
 
-#include <deque>
+#include <cstring>
+#include <memory>
 #include <QtCore>
 #include <newmat.h>
 
@@ -34,6 +35,13 @@
 #include "bncutils.h"
 #include "ephemeris.h"
 
+// Ephemerides (last five per satellite) of one user. Stored ephemerides
+// are shared (also between users) and never changed; a reader keeps its
+// copy alive as long as it holds the pointer. The list of a satellite is
+// never changed either: writers (serialized by a mutex) publish a new list
+// with std::atomic_store, readers take the current one with
+// std::atomic_load and never wait for a writer.
+////////////////////////////////////////////////////////////////////////////
 class bncEphUser : public QObject {
  Q_OBJECT
 
@@ -48,35 +56,64 @@ class bncEphUser : public QObject {
   bncEphUser(bool connectSlots);
   virtual ~bncEphUser();
 
-  t_irc putNewEph(t_eph* newEph, bool check);
+  t_irc putNewEph(const t_eph* eph, bool check);
+  t_irc putNewEph(t_eph* eph, bool check); // sets the check state of eph
 
-  t_eph* ephLast(const QString& prn) {
-    if (_eph.contains(prn)) {
-      return _eph[prn].back();
+  QSharedPointer<const t_eph> ephLast(const t_prn& prn) const {
+    int index = slotIndex(prn);
+    if (index < 0) {
+      return QSharedPointer<const t_eph>();
     }
-    return 0;
+    std::shared_ptr<const t_slot> slot = std::atomic_load(&_slots[index]);
+    return (slot && slot->_size > 0) ? slot->_eph[slot->_size-1] : QSharedPointer<const t_eph>();
   }
 
-  t_eph* ephPrev(const QString& prn) {
-    if (_eph.contains(prn)) {
-      unsigned nn = _eph[prn].size();
-      if (nn > 1) {
-        return _eph[prn].at(nn-2);
-      }
+  QSharedPointer<const t_eph> ephPrev(const t_prn& prn) const {
+    int index = slotIndex(prn);
+    if (index < 0) {
+      return QSharedPointer<const t_eph>();
     }
-    return 0;
+    std::shared_ptr<const t_slot> slot = std::atomic_load(&_slots[index]);
+    return (slot && slot->_size > 1) ? slot->_eph[slot->_size-2] : QSharedPointer<const t_eph>();
   }
 
-  const QList<QString> prnList() {return _eph.keys();}
+  QSharedPointer<const t_eph> ephLast(const QString& prn) const {return ephLast(toPrn(prn));}
+  QSharedPointer<const t_eph> ephPrev(const QString& prn) const {return ephPrev(toPrn(prn));}
+
+  const QList<QString> prnList() const;
 
  protected:
   virtual void ephBufferChanged() {}
 
  private:
-  void checkEphemeris(t_eph* eph);
-  QMutex                             _mutex;
-  static const unsigned              _maxQueueSize = 5;
-  QMap<QString, std::deque<t_eph*> > _eph;
+  static const unsigned _maxQueueSize = 5;
+  static const int      _maxNumber    = 100;
+  static const int      _numSlots     = 2 * 7 * _maxNumber;
+
+  class t_slot {
+   public:
+    t_slot() : _size(0) {}
+    unsigned                    _size;
+    QSharedPointer<const t_eph> _eph[_maxQueueSize];
+  };
+
+  static int slotIndex(const t_prn& prn) {
+    static const char systems[] = "GREJSCI";
+    const char* sys = (prn.system() != '\0') ? strchr(systems, prn.system()) : 0;
+    if (sys == 0 || prn.number() < 0 || prn.number() >= _maxNumber ||
+        prn.flags() < 0 || prn.flags() > 1) {
+      return -1;
+    }
+    return (prn.flags() * 7 + int(sys - systems)) * _maxNumber + prn.number();
+  }
+
+  static t_prn toPrn(const QString& prn);
+  static QSharedPointer<const t_eph> share(t_eph* eph);
+  t_irc putEph(const t_eph* eph, bool check, t_eph::e_checkState& checkState);
+  void  checkEphemeris(t_eph* eph, const t_eph* ephL, t_eph::e_checkState& stateL);
+
+  QMutex                        _mutex;  // writers
+  std::shared_ptr<const t_slot> _slots[_numSlots];  // atomic access only
 };
 
 #endif
@@ -0,0 +1,510 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+/* -------------------------------------------------------------------------
+ * BKG NTRIP Client
+ * -------------------------------------------------------------------------
+ *
+ * Class:      bncGzipDevice, bncGzipInflater, bncDeviceBuf
+ *
+ * Purpose:    Transparent gzip compression/decompression of input and
+ *             output files, selected by the file name extension
+ *
+ * Created:    18-Oct-2026
+ *
+ * Changes:
+ *
+ * -----------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "bncgzip.h"
+
+using namespace std;
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+bncGzipInflater::bncGzipInflater(const QString& fileName) {
+  _fileName = fileName;
+  _full[0]  = false;
+  _full[1]  = false;
+  _iPut     = 0;
+  _iGet     = 0;
+  _finished = false;
+  _stop     = false;
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+bncGzipInflater::~bncGzipInflater() {
+  stop();
+  wait();
+}
+
+// Stop the inflating thread
+////////////////////////////////////////////////////////////////////////////
+void bncGzipInflater::stop() {
+  QMutexLocker locker(&_mutex);
+  _stop = true;
+  _notFull.wakeAll();
+  _notEmpty.wakeAll();
+}
+
+// Error message (empty if no error occurred)
+////////////////////////////////////////////////////////////////////////////
+QString bncGzipInflater::errorString() const {
+  QMutexLocker locker(&_mutex);
+  return _errorString;
+}
+
+// Mark the end of data
+////////////////////////////////////////////////////////////////////////////
+void bncGzipInflater::finish(const QString& errorString) {
+  QMutexLocker locker(&_mutex);
+  _errorString = errorString;
+  _finished    = true;
+  _notEmpty.wakeAll();
+}
+
+// Hand over a filled block (waits while both buffers are in use)
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipInflater::putBlock(QByteArray& block) {
+  QMutexLocker locker(&_mutex);
+  while (_full[_iPut] && !_stop) {
+    _notFull.wait(&_mutex);
+  }
+  if (_stop) {
+    return false;
+  }
+  _blocks[_iPut].swap(block);
+  _full[_iPut] = true;
+  _iPut = 1 - _iPut;
+  _notEmpty.wakeOne();
+  return true;
+}
+
+// Take over the next decompressed block, the old one is recycled
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipInflater::nextBlock(QByteArray& block) {
+  QMutexLocker locker(&_mutex);
+  while (!_full[_iGet] && !_finished && !_stop) {
+    _notEmpty.wait(&_mutex);
+  }
+  if (!_full[_iGet]) {
+    return false;
+  }
+  block.swap(_blocks[_iGet]);
+  _full[_iGet] = false;
+  _iGet = 1 - _iGet;
+  _notFull.wakeOne();
+  return true;
+}
+
+// Inflating thread
+////////////////////////////////////////////////////////////////////////////
+void bncGzipInflater::run() {
+
+  QFile file(_fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    finish("bncGzipInflater: cannot open file " + _fileName);
+    return;
+  }
+
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, 15 + 32) != Z_OK) { // gzip or zlib header
+    finish("bncGzipInflater: cannot initialize zlib");
+    return;
+  }
+
+  QByteArray inBuf(64 * 1024, '\0');
+  QByteArray block(blockSize, '\0');
+  int        outPos    = 0;
+  bool       memberEnd = false;
+  QString    errorString;
+
+  while (true) {
+    if (zs.avail_in == 0) {
+      qint64 nRead = file.read(inBuf.data(), inBuf.size());
+      if (nRead < 0) {
+        errorString = "bncGzipInflater: cannot read file " + _fileName;
+        break;
+      }
+      if (nRead == 0) {
+        if (!memberEnd) {
+          errorString = "bncGzipInflater: truncated file " + _fileName;
+        }
+        break;
+      }
+      zs.next_in  = (Bytef*) inBuf.data();
+      zs.avail_in = nRead;
+    }
+
+    zs.next_out  = (Bytef*) block.data() + outPos;
+    zs.avail_out = blockSize - outPos;
+
+    int irc = inflate(&zs, Z_NO_FLUSH);
+    outPos = blockSize - zs.avail_out;
+
+    // Concatenated gzip members (e.g. files written in append mode); the
+    // file is complete only if the last member was read up to its end
+    // ------------------------------------------------------------------
+    if      (irc == Z_STREAM_END) {
+      memberEnd = true;
+      inflateReset(&zs);
+    }
+    else if (irc == Z_DATA_ERROR && memberEnd) {
+      break; // trailing garbage after the last member
+    }
+    else if (irc != Z_OK && irc != Z_BUF_ERROR) {
+      errorString = "bncGzipInflater: corrupted file " + _fileName;
+      break;
+    }
+    else if (zs.total_in > 0) {
+      memberEnd = false; // next member started
+    }
+
+    if (outPos == blockSize) {
+      if (!putBlock(block)) {
+        inflateEnd(&zs);
+        return;
+      }
+      block.resize(blockSize);
+      outPos = 0;
+    }
+  }
+
+  inflateEnd(&zs);
+
+  if (outPos > 0) {
+    block.resize(outPos);
+    if (!putBlock(block)) {
+      return;
+    }
+  }
+  finish(errorString);
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+bncGzipDevice::bncGzipDevice(const QString& fileName, QObject* parent)
+  : QIODevice(parent) {
+  _fileName = fileName;
+  _inflater = 0;
+  _blockPos = 0;
+  _rawPos   = 0;
+  _outFile  = 0;
+  memset(&_zOut, 0, sizeof(_zOut));
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+bncGzipDevice::~bncGzipDevice() {
+  if (isOpen()) {
+    close();
+  }
+}
+
+// Open the device (reading is handled by a separate inflating thread)
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipDevice::open(OpenMode mode) {
+
+  if (isOpen()) {
+    return false;
+  }
+  if (mode & QIODevice::Append) {
+    mode |= QIODevice::WriteOnly;
+  }
+
+  if (mode & QIODevice::ReadOnly) {
+    if (mode & QIODevice::WriteOnly) {
+      setErrorString("bncGzipDevice: read/write mode not supported");
+      return false;
+    }
+    if (!QFile::exists(_fileName)) {
+      setErrorString("bncGzipDevice: cannot open file " + _fileName);
+      return false;
+    }
+    startInflater();
+  }
+  else if (mode & QIODevice::WriteOnly) {
+    _outFile = new QFile(_fileName);
+    OpenMode fileMode = QIODevice::WriteOnly;
+    if (mode & QIODevice::Append) {
+      fileMode |= QIODevice::Append; // gzip allows concatenated members
+    }
+    if (!_outFile->open(fileMode)) {
+      setErrorString(_outFile->errorString());
+      delete _outFile; _outFile = 0;
+      return false;
+    }
+    if (deflateInit2(&_zOut, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      setErrorString("bncGzipDevice: cannot initialize zlib");
+      delete _outFile; _outFile = 0;
+      return false;
+    }
+    _zOutBuffer.resize(64 * 1024);
+    _flushTimer.start();
+  }
+
+  // Block buffering is done here, not in QIODevice
+  // ----------------------------------------------
+  return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+// Close the device
+////////////////////////////////////////////////////////////////////////////
+void bncGzipDevice::close() {
+  if (_outFile) {
+    _zOut.next_in  = 0;
+    _zOut.avail_in = 0;
+    deflateBuffer(Z_FINISH);
+    deflateEnd(&_zOut);
+    _outFile->close();
+    delete _outFile; _outFile = 0;
+  }
+  delete _inflater; _inflater = 0;
+  _block.clear();
+  _blockPos = 0;
+  _rawPos   = 0;
+  QIODevice::close();
+}
+
+// (Re-)Start decompression from the beginning of the file
+////////////////////////////////////////////////////////////////////////////
+void bncGzipDevice::startInflater() {
+  delete _inflater;
+  _inflater = new bncGzipInflater(_fileName);
+  _inflater->start();
+  _block.clear();
+  _blockPos = 0;
+  _rawPos   = 0;
+}
+
+// Switch to the next decompressed block
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipDevice::fetchBlock() {
+  if (!_inflater) {
+    return false;
+  }
+  _blockPos = 0;
+  if (!_inflater->nextBlock(_block)) {
+    _block.clear();
+    if (!_inflater->errorString().isEmpty()) {
+      setErrorString(_inflater->errorString());
+    }
+    return false;
+  }
+  return true;
+}
+
+// Read decompressed data
+////////////////////////////////////////////////////////////////////////////
+qint64 bncGzipDevice::readData(char* data, qint64 maxSize) {
+  qint64 nRead = 0;
+  while (nRead < maxSize) {
+    if (_blockPos >= _block.size() && !fetchBlock()) {
+      break;
+    }
+    int nn = qMin(maxSize - nRead, qint64(_block.size() - _blockPos));
+    memcpy(data + nRead, _block.constData() + _blockPos, nn);
+    _blockPos += nn;
+    nRead     += nn;
+  }
+  _rawPos += nRead;
+  if (nRead == 0 && _inflater && !_inflater->errorString().isEmpty()) {
+    return -1;
+  }
+  return nRead;
+}
+
+// Seek in the decompressed data (backward seek restarts decompression)
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipDevice::seek(qint64 pos) {
+  if (_outFile || !_inflater || pos < 0) {
+    return false;
+  }
+  if (pos < _rawPos) {
+    startInflater();
+  }
+  while (_rawPos < pos) {
+    if (_blockPos >= _block.size() && !fetchBlock()) {
+      return false;
+    }
+    int nn = qMin(pos - _rawPos, qint64(_block.size() - _blockPos));
+    _blockPos += nn;
+    _rawPos   += nn;
+  }
+  return true;
+}
+
+// End of decompressed data reached
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipDevice::atEnd() const {
+  if (!isOpen()) {
+    return true;
+  }
+  if (_outFile) {
+    return false;
+  }
+  if (_blockPos < _block.size()) {
+    return false;
+  }
+  return !const_cast<bncGzipDevice*>(this)->fetchBlock();
+}
+
+// Number of bytes available without waiting for the inflating thread
+////////////////////////////////////////////////////////////////////////////
+qint64 bncGzipDevice::bytesAvailable() const {
+  return _block.size() - _blockPos;
+}
+
+// Compress and write data (flushed to the file every flushInterval only,
+// a sync flush on every write would spoil the compression)
+////////////////////////////////////////////////////////////////////////////
+qint64 bncGzipDevice::writeData(const char* data, qint64 maxSize) {
+  if (!_outFile) {
+    return -1;
+  }
+  _zOut.next_in  = (Bytef*) data;
+  _zOut.avail_in = maxSize;
+  if (!deflateBuffer(Z_NO_FLUSH)) {
+    return -1;
+  }
+  if (_flushTimer.hasExpired(flushInterval) && !syncFlush()) {
+    return -1;
+  }
+  return maxSize;
+}
+
+// Make all data written so far readable by other processes
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipDevice::syncFlush() {
+  if (!_outFile) {
+    return false;
+  }
+  _zOut.next_in  = 0;
+  _zOut.avail_in = 0;
+  bool ok = deflateBuffer(Z_SYNC_FLUSH);
+  _outFile->flush();
+  _flushTimer.restart();
+  return ok;
+}
+
+// Run deflate and write the compressed output to file
+////////////////////////////////////////////////////////////////////////////
+bool bncGzipDevice::deflateBuffer(int flush) {
+  do {
+    _zOut.next_out  = (Bytef*) _zOutBuffer.data();
+    _zOut.avail_out = _zOutBuffer.size();
+    if (deflate(&_zOut, flush) == Z_STREAM_ERROR) {
+      setErrorString("bncGzipDevice: compression error");
+      return false;
+    }
+    qint64 nOut = _zOutBuffer.size() - _zOut.avail_out;
+    if (nOut > 0 && _outFile->write(_zOutBuffer.constData(), nOut) != nOut) {
+      setErrorString(_outFile->errorString());
+      return false;
+    }
+  } while (_zOut.avail_out == 0);
+  return true;
+}
+
+// Constructor (the device must outlive the buffer)
+////////////////////////////////////////////////////////////////////////////
+bncDeviceBuf::bncDeviceBuf(QIODevice* device) {
+  _device = device;
+  _inBuf  = new char[bufSize];
+  _outBuf = new char[bufSize];
+  setg(_inBuf, _inBuf, _inBuf);
+  setp(_outBuf, _outBuf + bufSize);
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+bncDeviceBuf::~bncDeviceBuf() {
+  delete [] _inBuf;
+  delete [] _outBuf;
+}
+
+// Refill the input buffer
+////////////////////////////////////////////////////////////////////////////
+bncDeviceBuf::int_type bncDeviceBuf::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  qint64 nRead = _device->read(_inBuf, bufSize);
+  if (nRead <= 0) {
+    return traits_type::eof();
+  }
+  setg(_inBuf, _inBuf, _inBuf + nRead);
+  return traits_type::to_int_type(*gptr());
+}
+
+// Flush the output buffer and store one character
+////////////////////////////////////////////////////////////////////////////
+bncDeviceBuf::int_type bncDeviceBuf::overflow(int_type cc) {
+  if (sync() != 0) {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(cc, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(cc);
+    pbump(1);
+  }
+  return traits_type::not_eof(cc);
+}
+
+// Pass buffered output to the device, a plain file passes it on to the
+// operating system (gzip files are flushed by the device itself)
+////////////////////////////////////////////////////////////////////////////
+int bncDeviceBuf::sync() {
+  qint64 nOut = pptr() - pbase();
+  if (nOut > 0 && _device->write(pbase(), nOut) != nOut) {
+    return -1;
+  }
+  setp(_outBuf, _outBuf + bufSize);
+  QFileDevice* file = qobject_cast<QFileDevice*>(_device);
+  if (nOut > 0 && file && !file->flush()) {
+    return -1;
+  }
+  return 0;
+}
+
+// Check the file name extension for gzip compression
+////////////////////////////////////////////////////////////////////////////
+bool isGzipFile(const QString& fileName) {
+  return fileName.endsWith(".gz", Qt::CaseInsensitive);
+}
+
+// Plain or gzip-compressed file device according to the file name
+////////////////////////////////////////////////////////////////////////////
+QIODevice* createFileDevice(const QString& fileName) {
+  if (isGzipFile(fileName)) {
+    return new bncGzipDevice(fileName);
+  }
+  else {
+    return new QFile(fileName);
+  }
+}
@@ -0,0 +1,124 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef BNCGZIP_H
+#define BNCGZIP_H
+
+#include <streambuf>
+#include <QtCore>
+#include <zlib.h>
+
+// Inflates a gzip file block by block in a separate thread
+////////////////////////////////////////////////////////////////////////////
+class bncGzipInflater : public QThread {
+ public:
+  bncGzipInflater(const QString& fileName);
+  ~bncGzipInflater();
+  bool    nextBlock(QByteArray& block);
+  void    stop();
+  QString errorString() const;
+
+ protected:
+  virtual void run();
+
+ private:
+  bool putBlock(QByteArray& block);
+  void finish(const QString& errorString);
+
+  static const int blockSize = 256 * 1024;
+
+  QString        _fileName;
+  QString        _errorString;
+  mutable QMutex _mutex;
+  QWaitCondition _notEmpty;
+  QWaitCondition _notFull;
+  QByteArray     _blocks[2];
+  bool           _full[2];
+  int            _iPut;
+  int            _iGet;
+  bool           _finished;
+  bool           _stop;
+};
+
+// Transparent gzip device (reading via bncGzipInflater, writing via deflate)
+////////////////////////////////////////////////////////////////////////////
+class bncGzipDevice : public QIODevice {
+ Q_OBJECT
+
+ public:
+  bncGzipDevice(const QString& fileName, QObject* parent = 0);
+  virtual ~bncGzipDevice();
+  virtual bool   open(OpenMode mode);
+  virtual void   close();
+  virtual bool   isSequential() const {return true;}
+  virtual bool   seek(qint64 pos);
+  virtual bool   atEnd() const;
+  virtual qint64 bytesAvailable() const;
+  bool           syncFlush();
+
+ protected:
+  virtual qint64 readData(char* data, qint64 maxSize);
+  virtual qint64 writeData(const char* data, qint64 maxSize);
+
+ private:
+  void startInflater();
+  bool fetchBlock();
+  bool deflateBuffer(int flush);
+
+  static const int flushInterval = 10000; // max. delay of written data [ms]
+
+  QString          _fileName;
+  bncGzipInflater* _inflater;
+  QByteArray       _block;
+  int              _blockPos;
+  qint64           _rawPos;
+  QFile*           _outFile;
+  z_stream         _zOut;
+  QByteArray       _zOutBuffer;
+  QElapsedTimer    _flushTimer;
+};
+
+// std::streambuf on top of a QIODevice (for std::istream/std::ostream users)
+////////////////////////////////////////////////////////////////////////////
+class bncDeviceBuf : public std::streambuf {
+ public:
+  bncDeviceBuf(QIODevice* device);
+  virtual ~bncDeviceBuf();
+
+ protected:
+  virtual int_type underflow();
+  virtual int_type overflow(int_type cc);
+  virtual int      sync();
+
+ private:
+  static const int bufSize = 64 * 1024;
+  QIODevice* _device;
+  char*      _inBuf;
+  char*      _outBuf;
+};
+
+bool       isGzipFile(const QString& fileName);
+QIODevice* createFileDevice(const QString& fileName);
+
+#endif
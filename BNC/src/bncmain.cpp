@@ -50,6 +50,7 @@
 #include "bncwindow.h"
 #include "bncsettings.h"
 #include "bncversion.h"
+#include "bncsatcache.h"
 #include "upload/bncephuploadcaster.h"
 #include "rinex/reqcedit.h"
 #include "rinex/reqcanalyze.h"
@@ -196,7 +197,7 @@ int main(int argc, char* argv[]) {
       "\n"
       "PPP Client Panel 1 keys:\n"
       "   PPP/dataSource  {Data source [character string: Blank|Real-Time Streams|RINEX Files]}\n"
-      "   PPP/rinexObs    {RINEX observation file, full path [character string]}\n"
+      "   PPP/rinexObs    {RINEX observation file(s), full path, comma separated for batch jobs [character string]}\n"
       "   PPP/rinexNav    {RINEX navigation file, full path [character string]}\n"
       "   PPP/corrMount   {Corrections mountpoint [character string]}\n"
       "   PPP/corrFile    {Corrections file, full path [character string]}\n"
@@ -473,6 +474,7 @@ int main(int argc, char* argv[]) {
     // --------------------------------
     if ( rawFileName.isEmpty() ) {
       BNC_CORE->setMode(t_bncCore::nonInteractive);
+      bncSatCache::instance()->setRealTime(true);
       BNC_CORE->startPPP();
 
       caster->readMountPoints();
@@ -20,12 +20,14 @@
 
 #include "bncoutf.h"
 #include "bncsettings.h"
+#include "bncgzip.h"
 
 using namespace std;
 
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
-bncoutf::bncoutf(const QString& sklFileName, const QString& intr, int sampl) {
+bncoutf::bncoutf(const QString& sklFileName, const QString& intr, int sampl)
+  : _out(0) {
 
   bncSettings settings;
 
@@ -33,6 +35,9 @@ bncoutf::bncoutf(const QString& sklFileName, const QString& intr, int sampl) {
   _sampl         = sampl;
   _intr          = intr;
   _numSec        = 0;
+  _gzip          = false;
+  _device        = 0;
+  _outBuf        = 0;
 
   if (! sklFileName.isEmpty()) {
     QFileInfo fileInfo(sklFileName);
@@ -41,6 +46,18 @@ bncoutf::bncoutf(const QString& sklFileName, const QString& intr, int sampl) {
     _extension   = fileInfo.completeSuffix();
 
     expandEnvVar(_path);
+
+    // Compressed output (the extension is re-appended to the file name)
+    // -----------------------------------------------------------------
+    if (_extension.compare("gz", Qt::CaseInsensitive) == 0) {
+      _extension.clear();
+      _gzip = true;
+    }
+    else if (_extension.endsWith(".gz", Qt::CaseInsensitive)) {
+      _extension.chop(3);
+      _gzip = true;
+    }
+
     if (!_extension.isEmpty()) {
       _extension = "." + _extension;
     }
@@ -59,7 +76,10 @@ bncoutf::~bncoutf() {
 // Close the Old RINEX File
 ////////////////////////////////////////////////////////////////////////////
 void bncoutf::closeFile() {
-  _out.close();
+  _out.flush();
+  _out.rdbuf(0);
+  delete _outBuf; _outBuf = 0;
+  delete _device; _device = 0;
 }
 
 // Epoch String
@@ -153,7 +173,7 @@ QString bncoutf::resolveFileName(int GPSweek, const QDateTime& datTim) {
   baseName.replace("${V3}" , QString("_U_%1%2").arg(yyyy).arg(doy));
   if (_extension.count(".") == 2) {_extension.replace(0,1,"_"); }
   
-  return _path + baseName + epoStr + _extension;
+  return _path + baseName + epoStr + _extension + (_gzip ? ".gz" : "");
 }
 
 // Re-Open Output File
@@ -180,15 +200,19 @@ t_irc bncoutf::reopen(int GPSweek, double GPSweeks) {
   // --------------------------
   if (!_headerWritten) {
     _out.setf(ios::showpoint | ios::fixed);
-    if (_append && QFile::exists(_fName)) {
-      _out.open(_fName.toLatin1().data(), ios::out | ios::app);
+    bool append = _append && QFile::exists(_fName);
+    _device = createFileDevice(_fName);
+    if (_device->open(append ? QIODevice::Append | QIODevice::Text
+                             : QIODevice::WriteOnly | QIODevice::Text)) {
+      _outBuf = new bncDeviceBuf(_device);
+      _out.rdbuf(_outBuf);
+      if (!append) {
+        writeHeader(datTim);
+      }
+      _headerWritten = true;
     }
     else {
-      _out.open(_fName.toLatin1().data());
-      writeHeader(datTim);
-    }
-    if (_out.is_open()) {
-      _headerWritten = true;
+      delete _device; _device = 0;
     }
   }
 
@@ -7,6 +7,8 @@
 
 #include "bncutils.h"
 
+class bncDeviceBuf;
+
 class bncoutf {
  public:
   bncoutf(const QString& sklFileName, const QString& intr, int sampl);
@@ -17,7 +19,7 @@ class bncoutf {
   virtual t_irc reopen(int GPSweek, double GPSweeks);
   virtual void  writeHeader(const QDateTime& /* datTim */) {}
   virtual void  closeFile();
-  std::ofstream _out;
+  std::ostream  _out;
   int           _sampl;
   int           _numSec;
 
@@ -34,6 +36,9 @@ class bncoutf {
   QString _fName;
   bool    _append;
   bool    _v3filenames;
+  bool    _gzip;
+  QIODevice*    _device;
+  bncDeviceBuf* _outBuf;
 };
 
 #endif
@@ -0,0 +1,215 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+/* -------------------------------------------------------------------------
+ * BKG NTRIP Client
+ * -------------------------------------------------------------------------
+ *
+ * Class:      bncSatCache
+ *
+ * Purpose:    Shared Cache of Broadcast Satellite Positions and Clocks
+ *
+ * Created:    18-Oct-2026
+ *
+ * Changes:
+ *
+ * -----------------------------------------------------------------------*/
+
+#include <cmath>
+
+#include "bncsatcache.h"
+#include "ephemeris.h"
+#include "satObs.h"
+
+using namespace std;
+
+// Singleton
+////////////////////////////////////////////////////////////////////////////
+bncSatCache* bncSatCache::instance() {
+  static bncSatCache _satCache;
+  return &_satCache;
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+bncSatCache::bncSatCache() : _realTime(0), _numHits(0), _numMisses(0) {
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+bncSatCache::~bncSatCache() {
+  clear();
+}
+
+// Remove all States
+////////////////////////////////////////////////////////////////////////////
+void bncSatCache::clear() {
+  QWriteLocker locker(&_lock);
+  qDeleteAll(_epochs);
+  _epochs.clear();
+}
+
+// Cache used (real-time processing) or not
+////////////////////////////////////////////////////////////////////////////
+void bncSatCache::setRealTime(bool realTime) {
+  _realTime.store(realTime ? 1 : 0);
+  if (!realTime) {
+    clear();
+  }
+}
+
+// Number of States found in the Cache
+////////////////////////////////////////////////////////////////////////////
+quint64 bncSatCache::numHits() const {
+  return _numHits.load();
+}
+
+// Number of States computed from the Ephemeris
+////////////////////////////////////////////////////////////////////////////
+quint64 bncSatCache::numMisses() const {
+  return _numMisses.load();
+}
+
+// Satellite Position, Velocity and Clock
+////////////////////////////////////////////////////////////////////////////
+t_irc bncSatCache::position(const t_eph* eph, const bncTime& tt,
+                            const t_orbCorr* orbCorr, const t_clkCorr* clkCorr,
+                            double* xc, double* vv) {
+
+  double daySec = tt.daysec();
+  double intSec = floor(daySec);
+
+  // Epoch between full seconds (e.g. time of transmission) or not real-time
+  // processing (epochs are not shared): computed exactly
+  // ------------------------------------------------------------------------
+  if (daySec - intSec > 1.e-9 || _realTime.load() == 0) {
+    if (eph->position(tt.gpsw(), tt.gpssec(), xc, vv) != success) {
+      return failure;
+    }
+    if (orbCorr) {
+      t_eph::applyCorr(tt, orbCorr, clkCorr, xc, vv);
+    }
+    return success;
+  }
+
+  qint64 sec = qint64(tt.mjd()) * 86400 + qint64(intSec);
+
+  t_satKey key;
+  key._prn         = eph->prn().toInt() + 1000 * eph->prn().flags();
+  key._iod         = eph->IOD();
+  key._fingerprint = eph->fingerprint();
+  for (int ii = 0; ii < nCorr; ii++) {
+    key._corr[ii] = 0.0;
+  }
+
+  // Broadcast state
+  // ---------------
+  t_satState satState;
+  if (!find(key, sec, satState)) {
+    if (eph->position(tt.gpsw(), tt.gpssec(), satState._xc, satState._vv) != success) {
+      return failure;
+    }
+    insert(key, sec, satState);
+  }
+
+  // Corrected state (cached with the values of the corrections)
+  // -----------------------------------------------------------
+  if (orbCorr) {
+    double* corr = key._corr;
+    corr[ 0] = orbCorr->_time.mjd();
+    corr[ 1] = orbCorr->_time.daysec();
+    corr[ 2] = orbCorr->_updateInt;
+    corr[ 3] = orbCorr->_xr[0];
+    corr[ 4] = orbCorr->_xr[1];
+    corr[ 5] = orbCorr->_xr[2];
+    corr[ 6] = orbCorr->_dotXr[0];
+    corr[ 7] = orbCorr->_dotXr[1];
+    corr[ 8] = orbCorr->_dotXr[2];
+    corr[ 9] = clkCorr->_time.mjd();
+    corr[10] = clkCorr->_time.daysec();
+    corr[11] = clkCorr->_updateInt;
+    corr[12] = clkCorr->_dClk;
+    corr[13] = clkCorr->_dotDClk;
+    corr[14] = clkCorr->_dotDotDClk;
+    if (!find(key, sec, satState)) {
+      t_eph::applyCorr(tt, orbCorr, clkCorr, satState._xc, satState._vv);
+      insert(key, sec, satState);
+    }
+  }
+
+  for (int ii = 0; ii < 4; ii++) xc[ii] = satState._xc[ii];
+  for (int ii = 0; ii < 3; ii++) vv[ii] = satState._vv[ii];
+
+  return success;
+}
+
+// State at full second from the cache
+////////////////////////////////////////////////////////////////////////////
+bool bncSatCache::find(const t_satKey& key, qint64 sec, t_satState& satState) {
+
+  QReadLocker locker(&_lock);
+  QMap<qint64, t_epoch*>::const_iterator it = _epochs.constFind(sec);
+  if (it != _epochs.constEnd()) {
+    const t_epoch* epoch = it.value();
+    QReadLocker lockerEpoch(&epoch->_lock);
+    QHash<t_satKey, t_satState>::const_iterator itS = epoch->_states.constFind(key);
+    if (itS != epoch->_states.constEnd()) {
+      satState = itS.value();
+      _numHits.fetchAndAddRelaxed(1);
+      return true;
+    }
+  }
+  _numMisses.fetchAndAddRelaxed(1);
+  return false;
+}
+
+// Insert a computed state - the list of epochs is locked only if a new
+// epoch is added
+////////////////////////////////////////////////////////////////////////////
+void bncSatCache::insert(const t_satKey& key, qint64 sec, const t_satState& satState) {
+
+  QReadLocker locker(&_lock);
+  QMap<qint64, t_epoch*>::const_iterator it = _epochs.constFind(sec);
+  if (it != _epochs.constEnd()) {
+    t_epoch* epoch = it.value();
+    QWriteLocker lockerEpoch(&epoch->_lock);
+    epoch->_states.insert(key, satState);
+    return;
+  }
+  locker.unlock();
+
+  QWriteLocker lockerAll(&_lock);
+  t_epoch*& epoch = _epochs[sec];
+  if (epoch == 0) {
+    epoch = new t_epoch;
+  }
+  epoch->_states.insert(key, satState);
+
+  // Remove the oldest epoch (the new one if it is older than all others)
+  // --------------------------------------------------------------------
+  if (_epochs.size() > _maxEpochs) {
+    delete _epochs.begin().value();
+    _epochs.erase(_epochs.begin());
+  }
+}
@@ -0,0 +1,104 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef BNCSATCACHE_H
+#define BNCSATCACHE_H
+
+#include <QtCore>
+
+#include "bncconst.h"
+#include "bnctime.h"
+
+class t_eph;
+class t_orbCorr;
+class t_clkCorr;
+
+// Process-wide cache of satellite positions and clocks at full seconds,
+// shared by all ephemeris users holding a copy of the same ephemeris. SSR
+// corrected states are cached together with the corrections they used.
+// Other epochs, and all epochs outside of real-time processing, are
+// computed exactly and not cached. The oldest epoch is removed first.
+////////////////////////////////////////////////////////////////////////////
+class bncSatCache {
+ public:
+  static bncSatCache* instance();
+
+  t_irc position(const t_eph* eph, const bncTime& tt, const t_orbCorr* orbCorr,
+                 const t_clkCorr* clkCorr, double* xc, double* vv);
+  quint64 numHits() const;
+  quint64 numMisses() const;
+  void    clear();
+  void    setRealTime(bool realTime);
+
+ private:
+  static const int nCorr = 15;
+
+  class t_satKey {
+   public:
+    bool operator==(const t_satKey& key2) const {
+      if (_prn != key2._prn || _iod != key2._iod || _fingerprint != key2._fingerprint) {
+        return false;
+      }
+      for (int ii = 0; ii < nCorr; ii++) {
+        if (_corr[ii] != key2._corr[ii]) {
+          return false;
+        }
+      }
+      return true;
+    }
+    friend uint qHash(const t_satKey& key) {
+      return key._fingerprint ^ (uint(key._prn) << 24) ^ key._iod;
+    }
+    int      _prn;
+    unsigned _iod;
+    unsigned _fingerprint;
+    double   _corr[nCorr]; // orbit and clock corrections (zero if not applied)
+  };
+
+  class t_satState {
+   public:
+    double _xc[4];
+    double _vv[3];
+  };
+
+  class t_epoch {
+   public:
+    mutable QReadWriteLock       _lock;  // states of the epoch
+    QHash<t_satKey, t_satState>  _states;
+  };
+
+  bncSatCache();
+  ~bncSatCache();
+  bool  find(const t_satKey& key, qint64 sec, t_satState& satState);
+  void  insert(const t_satKey& key, qint64 sec, const t_satState& satState);
+
+  static const int         _maxEpochs = 300;
+  mutable QReadWriteLock   _lock;    // list of epochs
+  QMap<qint64, t_epoch*>   _epochs;  // ordered by time
+  QAtomicInt               _realTime;
+  QAtomicInteger<quint64>  _numHits;
+  QAtomicInteger<quint64>  _numMisses;
+};
+
+#endif
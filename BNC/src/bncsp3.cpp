@@ -21,20 +21,25 @@
 
 #include "bncsp3.h"
 #include "bncutils.h"
+#include "bncgzip.h"
 
 using namespace std;
 
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
-bncSP3::bncSP3(const QString& fileName) : bncoutf(QString(), QString(), 0) {
+bncSP3::bncSP3(const QString& fileName)
+  : bncoutf(QString(), QString(), 0), _stream(0) {
   _inpOut    = input;
   _currEpoch = 0;
   _prevEpoch = 0;
 
-  _stream.open(fileName.toLatin1().data());
-  if (!_stream.good()) {
+  _inFile = createFileDevice(fileName);
+  if (!_inFile->open(QIODevice::ReadOnly)) {
+    delete _inFile;
     throw "t_sp3File: cannot open file " + fileName;
   }
+  _inBuf = new bncDeviceBuf(_inFile);
+  _stream.rdbuf(_inBuf);
 
   while (_stream.good()) {
     getline(_stream, _lastLine);
@@ -47,10 +52,12 @@ bncSP3::bncSP3(const QString& fileName) : bncoutf(QString(), QString(), 0) {
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 bncSP3::bncSP3(const QString& sklFileName, const QString& intr, int sampl)
-  : bncoutf(sklFileName, intr, sampl) {
+  : bncoutf(sklFileName, intr, sampl), _stream(0) {
   _inpOut    = output;
   _currEpoch = 0;
   _prevEpoch = 0;
+  _inFile    = 0;
+  _inBuf     = 0;
 }
 
 // Destructor
@@ -58,6 +65,9 @@ bncSP3::bncSP3(const QString& sklFileName, const QString& intr, int sampl)
 bncSP3::~bncSP3() {
   delete _currEpoch;
   delete _prevEpoch;
+  _stream.rdbuf(0);
+  delete _inBuf;
+  delete _inFile;
 }
 
 // Write One Epoch
@@ -176,7 +186,7 @@ const bncSP3::t_sp3Epoch* bncSP3::nextEpoch() {
   while (_stream.good()) {
     getline(_stream, _lastLine);
     if (_stream.eof() || _lastLine.find("EOF") == 0) {
-      _stream.close();
+      _stream.setstate(ios::eofbit);
       break;
     }
     if (_lastLine[0] == '*') {
@@ -56,7 +56,9 @@ class bncSP3 : public bncoutf {
 
   e_inpOut      _inpOut;
   bncTime       _lastEpoTime;
-  std::ifstream _stream;
+  QIODevice*    _inFile;
+  bncDeviceBuf* _inBuf;
+  std::istream  _stream;
   std::string   _lastLine;
   t_sp3Epoch*   _currEpoch;
   t_sp3Epoch*   _prevEpoch;
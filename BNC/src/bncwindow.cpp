@@ -79,6 +79,7 @@
 #include "bncversion.h"
 #include "bncbytescounter.h"
 #include "bncsslconfig.h"
+#include "bncsatcache.h"
 #include "upload/bnccustomtrafo.h"
 #include "upload/bncephuploadcaster.h"
 #include "qtfilechooser.h"
@@ -2096,6 +2097,7 @@ void bncWindow::slotGetThreadsFinished() {
   delete _caster;    _caster    = 0; BNC_CORE->setCaster(0);
   delete _casterEph; _casterEph = 0;
   _runningRealTime = false;
+  bncSatCache::instance()->setRealTime(false);
 }
 
 // Start It!
@@ -2143,6 +2145,7 @@ void bncWindow::slotStart() {
 void bncWindow::startRealTime() {
 
   _runningRealTime = true;
+  bncSatCache::instance()->setRealTime(true);
 
   _bncFigurePPP->reset();
 
@@ -2231,6 +2234,7 @@ void bncWindow::slotStop() {
     delete _casterEph; _casterEph = 0;
     _runningRealTime = false;
     _runningPPP      = false;
+    bncSatCache::instance()->setRealTime(false);
     enableStartStop();
   }
 }
@@ -38,15 +38,22 @@ using namespace std;
 
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
-bncComb::cmbParam::cmbParam(parType type_, int index_, const QString& ac_, const QString& prn_) {
+bncComb::cmbParam::cmbParam(parType type_, int index_, const QString& ac_, int iAC_,
+                            const QString& prn_) {
 
   type   = type_;
   index  = index_;
   AC     = ac_;
   prn    = prn_;
+  iAC    = iAC_;
+  iPrn   = 0;
   xx     = 0.0;
   eph    = 0;
 
+  if (!prn.isEmpty()) {
+    iPrn = t_prn(prn[0].toLatin1(), prn.mid(1,2).toInt()).toInt();
+  }
+
   if      (type == offACgps) {
     epoSpec = true;
     sig0    = sig0_offAC;
@@ -74,34 +81,6 @@ bncComb::cmbParam::cmbParam(parType type_, int index_, const QString& ac_, const
 bncComb::cmbParam::~cmbParam() {
 }
 
-// Partial
-////////////////////////////////////////////////////////////////////////////
-double bncComb::cmbParam::partial(const QString& AC_, const QString& prn_) {
-
-  if      (type == offACgps) {
-    if (AC == AC_ && prn_[0] == 'G') {
-      return 1.0;
-    }
-  }
-  else if (type == offACglo) {
-    if (AC == AC_ && prn_[0] == 'R') {
-      return 1.0;
-    }
-  }
-  else if (type == offACSat) {
-    if (AC == AC_ && prn == prn_) {
-      return 1.0;
-    }
-  }
-  else if (type == clkSat) {
-    if (prn == prn_) {
-      return 1.0;
-    }
-  }
-
-  return 0.0;
-}
-
 //
 ////////////////////////////////////////////////////////////////////////////
 QString bncComb::cmbParam::toString() const {
@@ -145,6 +124,9 @@ bncComb::bncComb() : _ephUser(true) {
   }
 
   _masterMissingEpochs = 0;
+  _epoch               = 0;
+  _latencySum          = 0.0;
+  _numEpochs           = 0;
 
   if (cmbStreams.size() >= 1 && !cmbStreams[0].isEmpty()) {
     QListIterator<QString> it(cmbStreams);
@@ -175,6 +157,13 @@ bncComb::bncComb() : _ephUser(true) {
   connect(BNC_CORE, SIGNAL(newClkCorrections(QList<t_clkCorr>)),
           this,     SLOT(slotNewClkCorrections(QList<t_clkCorr>)));
 
+  // An epoch waiting for missing ACs is combined even if no further
+  // corrections arrive (the timer fires in the thread of this object)
+  // -----------------------------------------------------------------
+  _epoTimer = new QTimer(this);
+  connect(_epoTimer, SIGNAL(timeout()), this, SLOT(slotEpoTimer()));
+  _epoTimer->start(_epoTimerInt);
+
   // Combination Method
   // ------------------
   if (settings.value("cmbMethod").toString() == "Single-Epoch") {
@@ -197,32 +186,31 @@ bncComb::bncComb() : _ephUser(true) {
   // ----------------------------------------------------------------------
   if (_method == filter) {
     int nextPar = 0;
-    QListIterator<cmbAC*> it(_ACs);
-    while (it.hasNext()) {
-      cmbAC* AC = it.next();
-      _params.push_back(new cmbParam(cmbParam::offACgps, ++nextPar, AC->name, ""));
+    for (int iAC = 0; iAC < _ACs.size(); iAC++) {
+      cmbAC* AC = _ACs[iAC];
+      _params.push_back(new cmbParam(cmbParam::offACgps, ++nextPar, AC->name, iAC, ""));
       for (unsigned iGps = 1; iGps <= t_prn::MAXPRN_GPS; iGps++) {
         QString prn = QString("G%1_0").arg(iGps, 2, 10, QChar('0'));
         _params.push_back(new cmbParam(cmbParam::offACSat, ++nextPar,
-                                       AC->name, prn));
+                                       AC->name, iAC, prn));
       }
       if (_useGlonass) {
-        _params.push_back(new cmbParam(cmbParam::offACglo, ++nextPar, AC->name, ""));
+        _params.push_back(new cmbParam(cmbParam::offACglo, ++nextPar, AC->name, iAC, ""));
         for (unsigned iGlo = 1; iGlo <= t_prn::MAXPRN_GLONASS; iGlo++) {
           QString prn = QString("R%1_0").arg(iGlo, 2, 10, QChar('0'));
           _params.push_back(new cmbParam(cmbParam::offACSat, ++nextPar,
-                                         AC->name, prn));
+                                         AC->name, iAC, prn));
         }
       }
     }
     for (unsigned iGps = 1; iGps <= t_prn::MAXPRN_GPS; iGps++) {
       QString prn = QString("G%1_0").arg(iGps, 2, 10, QChar('0'));
-      _params.push_back(new cmbParam(cmbParam::clkSat, ++nextPar, "", prn));
+      _params.push_back(new cmbParam(cmbParam::clkSat, ++nextPar, "", -1, prn));
     }
     if (_useGlonass) {
       for (unsigned iGlo = 1; iGlo <= t_prn::MAXPRN_GLONASS; iGlo++) {
         QString prn = QString("R%1_0").arg(iGlo, 2, 10, QChar('0'));
-        _params.push_back(new cmbParam(cmbParam::clkSat, ++nextPar, "", prn));
+        _params.push_back(new cmbParam(cmbParam::clkSat, ++nextPar, "", -1, prn));
       }
     }
 
@@ -269,11 +257,10 @@ bncComb::~bncComb() {
   for (int iPar = 1; iPar <= _params.size(); iPar++) {
     delete _params[iPar-1];
   }
-  QListIterator<bncTime> itTime(_buffer.keys());
-  while (itTime.hasNext()) {
-    bncTime epoTime = itTime.next();
-    _buffer.remove(epoTime);
+  for (int iSlot = 0; iSlot < _numSlots; iSlot++) {
+    qDeleteAll(_ring[iSlot].corrs);
   }
+  qDeleteAll(_corrPool);
 }
 
 // Remember orbit corrections
@@ -325,15 +312,18 @@ void bncComb::slotNewClkCorrections(QList<t_clkCorr> clkCorrections) {
     if (lastTime.undef() || clkCorr._time > lastTime) {
       lastTime = clkCorr._time;
     }
+    if (_lastTime.undef() || clkCorr._time > _lastTime) {
+      _lastTime = clkCorr._time;
+    }
 
     // Find/Check the AC Name
     // ----------------------
     QString acName;
-    QListIterator<cmbAC*> icAC(_ACs);
-    while (icAC.hasNext()) {
-      cmbAC* AC = icAC.next();
-      if (AC->mountPoint == staID) {
-        acName = AC->name;
+    int     iAC = -1;
+    for (int ii = 0; ii < _ACs.size(); ii++) {
+      if (_ACs[ii]->mountPoint == staID) {
+        acName = _ACs[ii]->name;
+        iAC    = ii;
         break;
       }
     }
@@ -362,32 +352,38 @@ void bncComb::slotNewClkCorrections(QList<t_clkCorr> clkCorrections) {
       continue;
     }
 
-    // Check Correction Age
-    // --------------------
+    // Check Correction Age (AC delivered after the epoch was released)
+    // ----------------------------------------------------------------
     if (_resTime.valid() && clkCorr._time <= _resTime) {
+      cmbEpoch& epoch = _ring[epoKey(clkCorr._time) % _numSlots];
+      if (epoch._key == epoKey(clkCorr._time)) {
+        deliver(&epoch, iAC);
+      }
       emit newMessage("bncComb: old correction: " + acName.toLatin1() + " " + prn.mid(0,3).toLatin1(), true);
       continue;
     }
 
     // Create new correction
     // ---------------------
-    cmbCorr* newCorr  = new cmbCorr();
+    cmbCorr* newCorr  = acquireCorr();
     newCorr->_prn     = prn;
     newCorr->_time    = clkCorr._time;
     newCorr->_iod     = clkCorr._iod;
     newCorr->_acName  = acName;
+    newCorr->_iAC     = iAC;
+    newCorr->_iPrn    = clkCorr._prn.toInt();
     newCorr->_clkCorr = clkCorr;
 
     // Check orbit correction
     // ----------------------
     if (!_orbCorrections.contains(acName)) {
-      delete newCorr;
+      releaseCorr(newCorr);
       continue;
     }
     else {
       QMap<t_prn, t_orbCorr>& storage = _orbCorrections[acName];
       if (!storage.contains(clkCorr._prn)  || storage[clkCorr._prn]._iod != newCorr->_iod) {
-        delete newCorr;
+        releaseCorr(newCorr);
         continue;
       }
       else {
@@ -397,11 +393,11 @@ void bncComb::slotNewClkCorrections(QList<t_clkCorr> clkCorrections) {
 
     // Check the Ephemeris
     //--------------------
-    t_eph* ephLast = _ephUser.ephLast(prn);
-    t_eph* ephPrev = _ephUser.ephPrev(prn);
-    if (ephLast == 0) {
+    QSharedPointer<const t_eph> ephLast = _ephUser.ephLast(prn);
+    QSharedPointer<const t_eph> ephPrev = _ephUser.ephPrev(prn);
+    if (ephLast.isNull()) {
       emit newMessage("bncComb: eph not found "  + prn.mid(0,3).toLatin1(), true);
-      delete newCorr;
+      releaseCorr(newCorr);
       continue;
     }
     else {
@@ -410,50 +406,227 @@ void bncComb::slotNewClkCorrections(QList<t_clkCorr> clkCorrections) {
       }
       else if (ephPrev && ephPrev->IOD() == newCorr->_iod) {
         newCorr->_eph = ephPrev;
-        switchToLastEph(ephLast, newCorr);
+        emit newMessage(switchToLastEph(ephLast, newCorr), false);
       }
       else {
         emit newMessage("bncComb: eph not found "  + prn.mid(0,3).toLatin1() +
                         QString(" %1").arg(newCorr->_iod).toLatin1(), true);
-        delete newCorr;
+        releaseCorr(newCorr);
         continue;
       }
     }
 
-    // Store correction into the buffer
-    // --------------------------------
-    QVector<cmbCorr*>& corrs = _buffer[newCorr->_time].corrs;
-    corrs.push_back(newCorr);
+    // Store correction into the epoch ring
+    // ------------------------------------
+    cmbEpoch* epoch = findEpoch(newCorr->_time);
+    if (epoch == 0) {
+      emit newMessage("bncComb: old correction: " + acName.toLatin1() + " " + prn.mid(0,3).toLatin1(), true);
+      releaseCorr(newCorr);
+      continue;
+    }
+    epoch->corrs.push_back(newCorr);
+    deliver(epoch, iAC);
+  }
+
+  // Process complete (or timed-out) Epoch(s)
+  // ----------------------------------------
+  processEpochs(lastTime);
+}
+
+// Combine waiting epochs whose time for the missing ACs is up; the current
+// time is that of the newest corrections (their latency may exceed the
+// sampling interval)
+////////////////////////////////////////////////////////////////////////////
+void bncComb::slotEpoTimer() {
+  QMutexLocker locker(&_mutex);
+  processEpochs(_lastTime);
+}
+
+// Epoch number (time in units of the combination sampling interval)
+////////////////////////////////////////////////////////////////////////////
+qint64 bncComb::epoKey(const bncTime& tt) const {
+  qint64 sec = qint64(tt.mjd()) * 86400 + qint64(floor(tt.daysec() + 0.5));
+  return sec / _cmbSampl;
+}
+
+// (Re-)initialize an epoch slot
+////////////////////////////////////////////////////////////////////////////
+void bncComb::cmbEpoch::reset(qint64 key, const bncTime& time, int numACs) {
+  _key      = key;
+  _time     = time;
+  _released = false;
+  _numACs   = 0;
+  _delivered.fill(false, numACs);
+  _age.start();
+}
+
+// Find the slot of an epoch, open a new one if necessary (0: too old)
+////////////////////////////////////////////////////////////////////////////
+bncComb::cmbEpoch* bncComb::findEpoch(const bncTime& tt) {
+
+  qint64    key   = epoKey(tt);
+  cmbEpoch* epoch = &_ring[key % _numSlots];
+
+  if (epoch->_key == key) {
+    return epoch->_released ? 0 : epoch;
+  }
+  if (epoch->_key > key) {
+    return 0;
+  }
+
+  // Ring full: combine the older epochs first
+  // -----------------------------------------
+  while (!epoch->_released) {
+    processEpoch(oldestEpoch());
+  }
+
+  epoch->reset(key, tt, _ACs.size());
+  return epoch;
+}
+
+// Oldest epoch not yet released (0: none)
+////////////////////////////////////////////////////////////////////////////
+bncComb::cmbEpoch* bncComb::oldestEpoch() {
+  cmbEpoch* oldest = 0;
+  for (int iSlot = 0; iSlot < _numSlots; iSlot++) {
+    cmbEpoch* epoch = &_ring[iSlot];
+    if (!epoch->_released && (oldest == 0 || epoch->_key < oldest->_key)) {
+      oldest = epoch;
+    }
+  }
+  return oldest;
+}
+
+// Register the (first) correction of an AC in an epoch, update its latency
+////////////////////////////////////////////////////////////////////////////
+void bncComb::deliver(cmbEpoch* epoch, int iAC) {
+
+  if (epoch->_delivered[iAC]) {
+    return;
+  }
+  epoch->_delivered[iAC] = true;
+  epoch->_numACs += 1;
+
+  cmbAC* AC = _ACs[iAC];
+  AC->numMissing = 0;
+  if (epoch->_released) {
+    AC->numLate += 1;
+  }
+
+  // Exponentially weighted mean and variance of the delay
+  // -----------------------------------------------------
+  const double alpha = 0.1;
+  double delay = epoch->_age.elapsed();
+  if (AC->latency < 0.0) {
+    AC->latency    = delay;
+    AC->latencyVar = 0.0;
+  }
+  else {
+    double diff = delay - AC->latency;
+    AC->latency   += alpha * diff;
+    AC->latencyVar = (1.0 - alpha) * (AC->latencyVar + alpha * diff * diff);
+  }
+}
+
+// Time to wait for an AC after the first correction of an epoch [ms]
+////////////////////////////////////////////////////////////////////////////
+double bncComb::waitTime(const cmbAC* AC) const {
+  const double maxWait = 1000.0 * _cmbSampl;
+  if (AC->latency < 0.0) {
+    return maxWait;
+  }
+  double wait = AC->latency + 3.0 * sqrt(AC->latencyVar) + _minWait;
+  return (wait < maxWait) ? wait : maxWait;
+}
+
+// Epoch can be combined (all ACs delivered or waiting time expired)
+////////////////////////////////////////////////////////////////////////////
+bool bncComb::epochReady(const cmbEpoch* epoch, const bncTime& lastTime) const {
+
+  if (epoch->_numACs == _ACs.size()) {
+    return true;
   }
 
-  // Process previous Epoch(s)
-  // -------------------------
   const double outWait = 1.0 * _cmbSampl;
-  QListIterator<bncTime> itTime(_buffer.keys());
-  while (itTime.hasNext()) {
-    bncTime epoTime = itTime.next();
-    if (epoTime < lastTime - outWait) {
-      _resTime = epoTime;
-      processEpoch();
+  if (lastTime.valid() && epoch->_time < lastTime - outWait) {
+    return true;
+  }
+
+  double wait = 0.0;
+  for (int iAC = 0; iAC < _ACs.size(); iAC++) {
+    const cmbAC* AC = _ACs[iAC];
+    if (!epoch->_delivered[iAC] && AC->numMissing < _maxMissing) {
+      double waitAC = waitTime(AC);
+      if (waitAC > wait) {
+        wait = waitAC;
+      }
+    }
+  }
+  return epoch->_age.elapsed() >= wait;
+}
+
+// Release the corrections of an epoch, the slot keeps key and age
+////////////////////////////////////////////////////////////////////////////
+void bncComb::releaseEpoch(cmbEpoch* epoch) {
+  for (int iAC = 0; iAC < _ACs.size(); iAC++) {
+    if (!epoch->_delivered[iAC]) {
+      _ACs[iAC]->numMissing += 1;
+    }
+  }
+  for (int ii = 0; ii < epoch->corrs.size(); ii++) {
+    releaseCorr(epoch->corrs[ii]);
+  }
+  epoch->corrs.clear();
+  epoch->_released = true;
+}
+
+// Combine the buffered epochs in time order as long as they are ready
+////////////////////////////////////////////////////////////////////////////
+void bncComb::processEpochs(const bncTime& lastTime) {
+  while (true) {
+    cmbEpoch* epoch = oldestEpoch();
+    if (epoch == 0 || !epochReady(epoch, lastTime)) {
+      break;
     }
+    processEpoch(epoch);
+  }
+}
+
+// Correction object from the pool
+////////////////////////////////////////////////////////////////////////////
+bncComb::cmbCorr* bncComb::acquireCorr() {
+  if (_corrPool.isEmpty()) {
+    return new cmbCorr();
   }
+  cmbCorr* corr = _corrPool.back();
+  _corrPool.pop_back();
+  corr->_dClkResult = 0.0;
+  return corr;
+}
+
+// Return a correction object to the pool
+////////////////////////////////////////////////////////////////////////////
+void bncComb::releaseCorr(cmbCorr* corr) {
+  corr->_eph.clear();
+  _corrPool.push_back(corr);
 }
 
-// Change the correction so that it refers to last received ephemeris
+// Change the correction so that it refers to last received ephemeris,
+// returns the message to be emitted
 ////////////////////////////////////////////////////////////////////////////
-void bncComb::switchToLastEph(t_eph* lastEph, cmbCorr* corr) {
+QByteArray bncComb::switchToLastEph(const QSharedPointer<const t_eph>& lastEph, cmbCorr* corr) {
 
   if (corr->_eph == lastEph) {
-    return;
+    return QByteArray();
   }
 
   ColumnVector oldXC(4);
   ColumnVector oldVV(3);
-  corr->_eph->getCrd(corr->_time, oldXC, oldVV, false);
+  corr->_eph->getCrd(corr->_time, oldXC, oldVV);
 
   ColumnVector newXC(4);
   ColumnVector newVV(3);
-  lastEph->getCrd(corr->_time, newXC, newVV, false);
+  lastEph->getCrd(corr->_time, newXC, newVV);
 
   ColumnVector dX = newXC.Rows(1,3) - oldXC.Rows(1,3);
   ColumnVector dV = newVV           - oldVV;
@@ -468,19 +641,22 @@ void bncComb::switchToLastEph(t_eph* lastEph, cmbCorr* corr) {
   QString msg = "switch corr " + corr->_prn.mid(0,3)
     + QString(" %1 -> %2 %3").arg(corr->_iod,3).arg(lastEph->IOD(),3).arg(dC*t_CST::c, 8, 'f', 4);
 
-  emit newMessage(msg.toLatin1(), false);
-
   corr->_iod = lastEph->IOD();
   corr->_eph = lastEph;
 
   corr->_orbCorr._xr    += dRAO;
   corr->_orbCorr._dotXr += dDotRAO;
   corr->_clkCorr._dClk  -= dC;
+
+  return msg.toLatin1();
 }
 
 // Process Epoch
 ////////////////////////////////////////////////////////////////////////////
-void bncComb::processEpoch() {
+void bncComb::processEpoch(cmbEpoch* epoch) {
+
+  _epoch   = epoch;
+  _resTime = epoch->_time;
 
   _log.clear();
 
@@ -492,23 +668,33 @@ void bncComb::processEpoch() {
   // Observation Statistics
   // ----------------------
   bool masterPresent = false;
-  QListIterator<cmbAC*> icAC(_ACs);
-  while (icAC.hasNext()) {
-    cmbAC* AC = icAC.next();
-    AC->numObs = 0;
-    QVectorIterator<cmbCorr*> itCorr(corrs());
-    while (itCorr.hasNext()) {
-      cmbCorr* corr = itCorr.next();
-      if (corr->_acName == AC->name) {
-        AC->numObs += 1;
-        if (AC->name == _masterOrbitAC) {
-          masterPresent = true;
-        }
-      }
+  for (int iAC = 0; iAC < _ACs.size(); iAC++) {
+    _ACs[iAC]->numObs = 0;
+  }
+  QVectorIterator<cmbCorr*> itCorr(corrs());
+  while (itCorr.hasNext()) {
+    _ACs[itCorr.next()->_iAC]->numObs += 1;
+  }
+  for (int iAC = 0; iAC < _ACs.size(); iAC++) {
+    cmbAC* AC = _ACs[iAC];
+    if (AC->numObs > 0 && AC->name == _masterOrbitAC) {
+      masterPresent = true;
+    }
+    out << AC->name.toLatin1().data() << ": " << AC->numObs;
+    if (AC->numLate > 0) {
+      out << "  late: " << AC->numLate;
     }
-    out << AC->name.toLatin1().data() << ": " << AC->numObs << endl;
+    out << endl;
   }
 
+  // Latency (first correction to combination)
+  // -----------------------------------------
+  qint64 latency = epoch->_age.elapsed();
+  _latencySum += latency;
+  _numEpochs  += 1;
+  out << "Latency: " << latency << " ms, mean " << qint64(_latencySum / _numEpochs)
+      << " ms, ACs " << epoch->_numACs << "/" << _ACs.size() << endl;
+
   // If Master not present, switch to another one
   // --------------------------------------------
   const unsigned switchMasterAfterGap = 1;
@@ -519,7 +705,7 @@ void bncComb::processEpoch() {
     ++_masterMissingEpochs;
     if (_masterMissingEpochs < switchMasterAfterGap) {
       out << "Missing Master, Epoch skipped" << endl;
-      _buffer.remove(_resTime);
+      releaseEpoch(epoch);
       emit newMessage(_log, false);
       return;
     }
@@ -578,9 +764,13 @@ void bncComb::processEpoch() {
     dumpResults(resCorr);
   }
 
-  // Delete Data, emit Message
-  // -------------------------
-  _buffer.remove(_resTime);
+  // Release Data, emit Message
+  // --------------------------
+  QMapIterator<QString, cmbCorr*> itRes(resCorr);
+  while (itRes.hasNext()) {
+    releaseCorr(itRes.next().value());
+  }
+  releaseEpoch(epoch);
   emit newMessage(_log, false);
 }
 
@@ -619,18 +809,16 @@ t_irc bncComb::processEpoch_filter(QTextStream& out,
   SymmetricMatrix QQ_sav = _QQ;
   while (true) {
 
-    Matrix         AA;
-    ColumnVector   ll;
-    DiagonalMatrix PP;
-
-    if (createAmat(AA, ll, PP, x0, resCorr) != success) {
+    QVector<cmbRow> rows;
+    if (createAmat(rows, x0, resCorr) != success) {
       return failure;
     }
 
     dx.ReSize(nPar); dx = 0.0;
-    kalman(AA, ll, PP, _QQ, dx);
+    kalmanUpdate(rows, _QQ, dx);
 
-    ColumnVector vv = ll - AA * dx;
+    ColumnVector vv;
+    residuals(rows, dx, vv);
 
     int     maxResIndex;
     double  maxRes = vv.maximum_absolute_value1(maxResIndex);
@@ -640,11 +828,12 @@ t_irc bncComb::processEpoch_filter(QTextStream& out,
         << " Maximum Residuum " << maxRes << ' '
         << corrs()[maxResIndex-1]->_acName << ' ' << corrs()[maxResIndex-1]->_prn.mid(0,3);
     if (maxRes > _MAXRES) {
+      const cmbCorr* corrMax = corrs()[maxResIndex-1];
       for (int iPar = 1; iPar <= _params.size(); iPar++) {
         cmbParam* pp = _params[iPar-1];
-        if (pp->type == cmbParam::offACSat            &&
-            pp->AC   == corrs()[maxResIndex-1]->_acName &&
-            pp->prn  == corrs()[maxResIndex-1]->_prn.mid(0,3)) {
+        if (pp->type == cmbParam::offACSat &&
+            pp->iAC  == corrMax->_iAC      &&
+            pp->iPrn == corrMax->_iPrn) {
           QQ_sav.Row(iPar)    = 0.0;
           QQ_sav.Column(iPar) = 0.0;
           QQ_sav(iPar,iPar)   = pp->sig0 * pp->sig0;
@@ -653,6 +842,7 @@ t_irc bncComb::processEpoch_filter(QTextStream& out,
 
       out << "  Outlier" << endl;
       _QQ = QQ_sav;
+      releaseCorr(corrs()[maxResIndex-1]);
       corrs().remove(maxResIndex-1);
     }
     else {
@@ -684,11 +874,11 @@ void bncComb::printResults(QTextStream& out,
   while (it.hasNext()) {
     it.next();
     cmbCorr* corr = it.value();
-    const t_eph* eph = corr->_eph;
+    const t_eph* eph = corr->_eph.data();
     if (eph) {
       ColumnVector xc(4);
       ColumnVector vv(3);
-      eph->getCrd(_resTime, xc, vv, false);
+      eph->getCrd(_resTime, xc, vv);
 
       out << _resTime.datestr().c_str() << " "
           << _resTime.timestr().c_str() << " ";
@@ -740,9 +930,7 @@ void bncComb::dumpResults(const QMap<QString, cmbCorr*>& resCorr) {
 
     ColumnVector xc(4);
     ColumnVector vv(3);
-    corr->_eph->setClkCorr(dynamic_cast<const t_clkCorr*>(&clkCorr));
-    corr->_eph->setOrbCorr(dynamic_cast<const t_orbCorr*>(&orbCorr));
-    corr->_eph->getCrd(_resTime, xc, vv, true);
+    corr->_eph->getCrd(_resTime, xc, vv, &orbCorr, &clkCorr);
 
     // Correction Phase Center --> CoM
     // -------------------------------
@@ -788,8 +976,6 @@ void bncComb::dumpResults(const QMap<QString, cmbCorr*>& resCorr) {
                  corr->_orbCorr._dotXr[2],
                  0.0);
     corrLines << line;
-
-    delete corr;
   }
 
   outLines += "EOE\n"; // End Of Epoch flag
@@ -811,96 +997,179 @@ void bncComb::dumpResults(const QMap<QString, cmbCorr*>& resCorr) {
 
 // Create First Design Matrix and Vector of Measurements
 ////////////////////////////////////////////////////////////////////////////
-t_irc bncComb::createAmat(Matrix& AA, ColumnVector& ll, DiagonalMatrix& PP,
-                          const ColumnVector& x0,
+t_irc bncComb::createAmat(QVector<cmbRow>& rows, const ColumnVector& x0,
                           QMap<QString, cmbCorr*>& resCorr) {
 
-  unsigned nPar = _params.size();
-  unsigned nObs = corrs().size();
+  int nPar = _params.size();
+  int nObs = corrs().size();
 
   if (nObs == 0) {
     return failure;
   }
 
-  int maxSat = t_prn::MAXPRN_GPS;
-//  if (_useGlonass) {
-//    maxSat = t_prn::MAXPRN_GPS + t_prn::MAXPRN_GLONASS;
-//  }
-
-  const int nCon = (_method == filter) ? 1 + maxSat : 0;
-
-  AA.ReSize(nObs+nCon, nPar);  AA = 0.0;
-  ll.ReSize(nObs+nCon);        ll = 0.0;
-  PP.ReSize(nObs+nCon);        PP = 1.0 / (sigObs * sigObs);
+  // Parameter indices by (AC, PRN)
+  // ------------------------------
+  const int nPrn = t_prn::MAXPRN + 1;
+  const int nAC  = _ACs.size();
+  QVector<int> idxOffGps(nAC, -1);
+  QVector<int> idxOffGlo(nAC, -1);
+  QVector<int> idxOffSat(nAC * nPrn, -1);
+  QVector<int> idxClkSat(nPrn, -1);
+  for (int iPar = 0; iPar < nPar; iPar++) {
+    const cmbParam* pp = _params[iPar];
+    if      (pp->type == cmbParam::offACgps) {
+      idxOffGps[pp->iAC] = iPar;
+    }
+    else if (pp->type == cmbParam::offACglo) {
+      idxOffGlo[pp->iAC] = iPar;
+    }
+    else if (pp->type == cmbParam::offACSat) {
+      idxOffSat[pp->iAC * nPrn + pp->iPrn] = iPar;
+    }
+    else if (pp->type == cmbParam::clkSat) {
+      idxClkSat[pp->iPrn] = iPar;
+    }
+  }
 
-  int iObs = 0;
-  QVectorIterator<cmbCorr*> itCorr(corrs());
-  while (itCorr.hasNext()) {
-    cmbCorr* corr = itCorr.next();
+  // Observations
+  // ------------
+  QVector<bool> used(nPar, false);
+  rows.resize(nObs);
+  for (int iObs = 0; iObs < nObs; iObs++) {
+    cmbCorr* corr = corrs()[iObs];
     QString  prn  = corr->_prn;
 
-    ++iObs;
-
     if (corr->_acName == _masterOrbitAC && resCorr.find(prn) == resCorr.end()) {
-      resCorr[prn] = new cmbCorr(*corr);
+      cmbCorr* res = acquireCorr();
+      *res         = *corr;
+      resCorr[prn] = res;
     }
 
-    for (int iPar = 1; iPar <= _params.size(); iPar++) {
-      cmbParam* pp = _params[iPar-1];
-      AA(iObs, iPar) = pp->partial(corr->_acName, prn);
+    cmbRow& row = rows[iObs];
+    row.iPar.clear();
+    if      (prn[0] == 'G' && idxOffGps[corr->_iAC] >= 0) {
+      row.iPar << idxOffGps[corr->_iAC];
+    }
+    else if (prn[0] == 'R' && idxOffGlo[corr->_iAC] >= 0) {
+      row.iPar << idxOffGlo[corr->_iAC];
+    }
+    if (idxOffSat[corr->_iAC * nPrn + corr->_iPrn] >= 0) {
+      row.iPar << idxOffSat[corr->_iAC * nPrn + corr->_iPrn];
+    }
+    if (idxClkSat[corr->_iPrn] >= 0) {
+      row.iPar << idxClkSat[corr->_iPrn];
     }
 
-    ll(iObs) = corr->_clkCorr._dClk * t_CST::c - DotProduct(AA.Row(iObs), x0);
+    row.ll = corr->_clkCorr._dClk * t_CST::c;
+    row.pp = 1.0 / (sigObs * sigObs);
+    for (int ii = 0; ii < row.iPar.size(); ii++) {
+      row.ll -= x0[row.iPar[ii]];
+      used[row.iPar[ii]] = true;
+    }
   }
 
   // Regularization
   // --------------
   if (_method == filter) {
     const double Ph = 1.e6;
-    PP(nObs+1) = Ph;
-    for (int iPar = 1; iPar <= _params.size(); iPar++) {
-      cmbParam* pp = _params[iPar-1];
-      if ( AA.Column(iPar).maximum_absolute_value() > 0.0 &&
-           pp->type == cmbParam::clkSat ) {
-        AA(nObs+1, iPar) = 1.0;
+    cmbRow rowClk;
+    rowClk.ll = 0.0;
+    rowClk.pp = Ph;
+    for (int iPar = 0; iPar < nPar; iPar++) {
+      if (used[iPar] && _params[iPar]->type == cmbParam::clkSat) {
+        rowClk.iPar << iPar;
       }
     }
-    int iCond = 1;
+    rows << rowClk;
     for (unsigned iGps = 1; iGps <= t_prn::MAXPRN_GPS; iGps++) {
-      QString prn = QString("G%1_0").arg(iGps, 2, 10, QChar('0'));
-      ++iCond;
-      PP(nObs+iCond) = Ph;
-      for (int iPar = 1; iPar <= _params.size(); iPar++) {
-        cmbParam* pp = _params[iPar-1];
-        if ( pp &&
-             AA.Column(iPar).maximum_absolute_value() > 0.0 &&
-             pp->type == cmbParam::offACSat                 &&
-             pp->prn == prn) {
-          AA(nObs+iCond, iPar) = 1.0;
+      int    iPrn = t_prn('G', iGps).toInt();
+      cmbRow rowSat;
+      rowSat.ll = 0.0;
+      rowSat.pp = Ph;
+      for (int iAC = 0; iAC < nAC; iAC++) {
+        int iPar = idxOffSat[iAC * nPrn + iPrn];
+        if (iPar >= 0 && used[iPar]) {
+          rowSat.iPar << iPar;
         }
       }
+      if (!rowSat.iPar.isEmpty()) {
+        rows << rowSat;
+      }
     }
-//    if (_useGlonass) {
-//      for (int iGlo = 1; iGlo <= t_prn::MAXPRN_GLONASS; iGlo++) {
-//        QString prn = QString("R%1_0").arg(iGlo, 2, 10, QChar('0'));
-//        ++iCond;
-//        PP(nObs+iCond) = Ph;
-//        for (int iPar = 1; iPar <= _params.size(); iPar++) {
-//          cmbParam* pp = _params[iPar-1];
-//          if ( pp &&
-//               AA.Column(iPar).maximum_absolute_value() > 0.0 &&
-//               pp->type == cmbParam::offACSat                 &&
-//               pp->prn == prn) {
-//            AA(nObs+iCond, iPar) = 1.0;
-//          }
-//        }
-//      }
-//    }
   }
 
   return success;
 }
 
+// Sequential Kalman update with the sparse rows (partials equal to one)
+////////////////////////////////////////////////////////////////////////////
+void bncComb::kalmanUpdate(const QVector<cmbRow>& rows, SymmetricMatrix& QQ,
+                           ColumnVector& dx) {
+
+  int     nPar = QQ.Nrows();
+  double* QS   = QQ.Store();    // lower triangle, stored row by row
+
+  vector<double> hh(nPar);
+
+  for (int iRow = 0; iRow < rows.size(); iRow++) {
+    const cmbRow& row = rows[iRow];
+    int nn = row.iPar.size();
+    if (nn == 0) {
+      continue;
+    }
+
+    // hh = QQ * a, innovation and its variance
+    // ----------------------------------------
+    double vv = row.ll;
+    double ss = 1.0 / row.pp;
+    for (int kk = 0; kk < nn; kk++) {
+      vv -= dx[row.iPar[kk]];
+    }
+    for (int iPar = 0; iPar < nPar; iPar++) {
+      double hPar = 0.0;
+      for (int kk = 0; kk < nn; kk++) {
+        int jPar = row.iPar[kk];
+        hPar += (iPar >= jPar ? QS[iPar*(iPar+1)/2 + jPar]
+                              : QS[jPar*(jPar+1)/2 + iPar]);
+      }
+      hh[iPar] = hPar;
+    }
+    for (int kk = 0; kk < nn; kk++) {
+      ss += hh[row.iPar[kk]];
+    }
+
+    // Update of the parameters and of the covariance matrix
+    // -----------------------------------------------------
+    double fac = vv / ss;
+    for (int iPar = 0; iPar < nPar; iPar++) {
+      if (hh[iPar] == 0.0) {
+        continue;
+      }
+      dx[iPar] += hh[iPar] * fac;
+      double  hs   = hh[iPar] / ss;
+      double* QRow = QS + iPar*(iPar+1)/2;
+      for (int jPar = 0; jPar <= iPar; jPar++) {
+        QRow[jPar] -= hs * hh[jPar];
+      }
+    }
+  }
+}
+
+// Residuals of the observations (regularization rows excluded)
+////////////////////////////////////////////////////////////////////////////
+void bncComb::residuals(const QVector<cmbRow>& rows, const ColumnVector& dx,
+                        ColumnVector& vv) {
+  int nObs = corrs().size();
+  vv.ReSize(nObs);
+  for (int iObs = 0; iObs < nObs; iObs++) {
+    const cmbRow& row = rows[iObs];
+    vv[iObs] = row.ll;
+    for (int kk = 0; kk < row.iPar.size(); kk++) {
+      vv[iObs] -= dx[row.iPar[kk]];
+    }
+  }
+}
+
 // Process Epoch - Single-Epoch Method
 ////////////////////////////////////////////////////////////////////////////
 t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
@@ -919,23 +1188,19 @@ t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
 
     // Remove Satellites that are not in Master
     // ----------------------------------------
+    QSet<int> masterPrns;
+    QVectorIterator<cmbCorr*> itMaster(corrs());
+    while (itMaster.hasNext()) {
+      cmbCorr* corr = itMaster.next();
+      if (corr->_acName == _masterOrbitAC) {
+        masterPrns.insert(corr->_iPrn);
+      }
+    }
     QMutableVectorIterator<cmbCorr*> it(corrs());
     while (it.hasNext()) {
       cmbCorr* corr = it.next();
-      QString  prn  = corr->_prn;
-      bool foundMaster = false;
-      QVectorIterator<cmbCorr*> itHlp(corrs());
-      while (itHlp.hasNext()) {
-        cmbCorr* corrHlp = itHlp.next();
-        QString  prnHlp  = corrHlp->_prn;
-        QString  ACHlp   = corrHlp->_acName;
-        if (ACHlp == _masterOrbitAC && prn == prnHlp) {
-          foundMaster = true;
-          break;
-        }
-      }
-      if (!foundMaster) {
-        delete corr;
+      if (!masterPrns.contains(corr->_iPrn)) {
+        releaseCorr(corr);
         it.remove();
       }
     }
@@ -944,6 +1209,7 @@ t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
     // -----------------------------------------------------
     QMap<QString, int> numObsPrn;
     QMap<QString, int> numObsAC;
+    QMap<QString, int> iACs;
     QVectorIterator<cmbCorr*> itCorr(corrs());
     while (itCorr.hasNext()) {
       cmbCorr* corr = itCorr.next();
@@ -957,6 +1223,7 @@ t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
       }
       if (numObsAC.find(AC) == numObsAC.end()) {
         numObsAC[AC]  = 1;
+        iACs[AC]      = corr->_iAC;
       }
       else {
         numObsAC[AC] += 1;
@@ -980,9 +1247,9 @@ t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
       const QString& AC     = itAC.key();
       int            numObs = itAC.value();
       if (AC != _masterOrbitAC && numObs > 0) {
-        _params.push_back(new cmbParam(cmbParam::offACgps, ++nextPar, AC, ""));
+        _params.push_back(new cmbParam(cmbParam::offACgps, ++nextPar, AC, iACs[AC], ""));
         if (_useGlonass) {
-          _params.push_back(new cmbParam(cmbParam::offACglo, ++nextPar, AC, ""));
+          _params.push_back(new cmbParam(cmbParam::offACglo, ++nextPar, AC, iACs[AC], ""));
         }
       }
     }
@@ -993,7 +1260,7 @@ t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
       const QString& prn    = itPrn.key();
       int            numObs = itPrn.value();
       if (numObs > 0) {
-        _params.push_back(new cmbParam(cmbParam::clkSat, ++nextPar, "", prn));
+        _params.push_back(new cmbParam(cmbParam::clkSat, ++nextPar, "", -1, prn));
       }
     }
 
@@ -1003,21 +1270,34 @@ t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
 
     // Create First-Design Matrix
     // --------------------------
-    Matrix         AA;
-    ColumnVector   ll;
-    DiagonalMatrix PP;
-    if (createAmat(AA, ll, PP, x0, resCorr) != success) {
+    QVector<cmbRow> rows;
+    if (createAmat(rows, x0, resCorr) != success) {
       return failure;
     }
 
+    // Normal Equations (accumulated directly from the sparse rows)
+    // ------------------------------------------------------------
     ColumnVector vv;
     try {
-      Matrix          ATP = AA.t() * PP;
-      SymmetricMatrix NN; NN << ATP * AA;
-      ColumnVector    bb = ATP * ll;
+      SymmetricMatrix NN(nPar); NN = 0.0;
+      ColumnVector    bb(nPar); bb = 0.0;
+      double* NS = NN.Store();
+      for (int iRow = 0; iRow < rows.size(); iRow++) {
+        const cmbRow& row = rows[iRow];
+        for (int kk = 0; kk < row.iPar.size(); kk++) {
+          int iPar = row.iPar[kk];
+          bb[iPar] += row.pp * row.ll;
+          for (int ll = 0; ll < row.iPar.size(); ll++) {
+            int jPar = row.iPar[ll];
+            if (jPar <= iPar) {
+              NS[iPar*(iPar+1)/2 + jPar] += row.pp;
+            }
+          }
+        }
+      }
       _QQ = NN.i();
       dx  = _QQ * bb;
-      vv  = ll - AA * dx;
+      residuals(rows, dx, vv);
     }
     catch (Exception& exc) {
       out << exc.what() << endl;
@@ -1034,7 +1314,7 @@ t_irc bncComb::processEpoch_singleEpoch(QTextStream& out,
 
     if (maxRes > _MAXRES) {
       out << "  Outlier" << endl;
-      delete corrs()[maxResIndex-1];
+      releaseCorr(corrs()[maxResIndex-1]);
       corrs().remove(maxResIndex-1);
     }
     else {
@@ -1071,26 +1351,28 @@ t_irc bncComb::checkOrbits(QTextStream& out) {
     cmbCorr* corr = im.next();
     QString  prn  = corr->_prn;
 
-    t_eph* ephLast = _ephUser.ephLast(prn);
-    t_eph* ephPrev = _ephUser.ephPrev(prn);
+    QSharedPointer<const t_eph> ephLast = _ephUser.ephLast(prn);
+    QSharedPointer<const t_eph> ephPrev = _ephUser.ephPrev(prn);
 
-    if      (ephLast == 0) {
+    if      (ephLast.isNull()) {
       out << "checkOrbit: missing eph (not found) " << corr->_prn.mid(0,3) << endl;
-      delete corr;
+      releaseCorr(corr);
       im.remove();
     }
-    else if (corr->_eph == 0) {
+    else if (corr->_eph.isNull()) {
       out << "checkOrbit: missing eph (zero) " << corr->_prn.mid(0,3) << endl;
-      delete corr;
+      releaseCorr(corr);
       im.remove();
     }
     else {
       if ( corr->_eph == ephLast || corr->_eph == ephPrev ) {
-        switchToLastEph(ephLast, corr);
+        if (corr->_eph != ephLast) {
+          emit newMessage(switchToLastEph(ephLast, corr), false);
+        }
       }
       else {
         out << "checkOrbit: missing eph (deleted) " << corr->_prn.mid(0,3) << endl;
-        delete corr;
+        releaseCorr(corr);
         im.remove();
       }
     }
@@ -1159,7 +1441,7 @@ t_irc bncComb::checkOrbits(QTextStream& out) {
       cmbCorr* corr = im.next();
       QString  prn  = corr->_prn;
       if      (numCorr[prn] < 2) {
-        delete corr;
+        releaseCorr(corr);
         im.remove();
       }
       else if (corr == maxDiff[prn]) {
@@ -1172,7 +1454,7 @@ t_irc bncComb::checkOrbits(QTextStream& out) {
               << prn.mid(0,3).toLatin1().data()           << " "
               << corr->_iod                     << " "
               << norm                           << endl;
-          delete corr;
+          releaseCorr(corr);
           im.remove();
           removed = true;
         }
@@ -1197,11 +1479,12 @@ void bncComb::slotProviderIDChanged(QString mountPoint) {
   // Find the AC Name
   // ----------------
   QString acName;
-  QListIterator<cmbAC*> icAC(_ACs);
-  while (icAC.hasNext()) {
-    cmbAC* AC = icAC.next();
+  int     iAC = -1;
+  for (int ii = 0; ii < _ACs.size(); ii++) {
+    cmbAC* AC = _ACs[ii];
     if (AC->mountPoint == mountPoint) {
       acName = AC->name;
+      iAC    = ii;
       out << "Provider ID changed: AC " << AC->name.toLatin1().data()   << " "
           << _resTime.datestr().c_str()    << " "
           << _resTime.timestr().c_str()    << endl;
@@ -1212,17 +1495,20 @@ void bncComb::slotProviderIDChanged(QString mountPoint) {
     return;
   }
 
-  // Remove all corrections of the corresponding AC
-  // ----------------------------------------------
-  QListIterator<bncTime> itTime(_buffer.keys());
-  while (itTime.hasNext()) {
-    bncTime epoTime = itTime.next();
-    QVector<cmbCorr*>& corrVec = _buffer[epoTime].corrs;
-    QMutableVectorIterator<cmbCorr*> it(corrVec);
+  // Remove all corrections of the corresponding AC, the AC has not
+  // delivered the buffered epochs any more
+  // --------------------------------------------------------------
+  for (int iSlot = 0; iSlot < _numSlots; iSlot++) {
+    cmbEpoch& epoch = _ring[iSlot];
+    if (iAC < epoch._delivered.size() && epoch._delivered[iAC]) {
+      epoch._delivered[iAC] = false;
+      epoch._numACs -= 1;
+    }
+    QMutableVectorIterator<cmbCorr*> it(epoch.corrs);
     while (it.hasNext()) {
       cmbCorr* corr = it.next();
       if (acName == corr->_acName) {
-        delete corr;
+        releaseCorr(corr);
         it.remove();
       }
     }
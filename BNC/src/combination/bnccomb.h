@@ -24,6 +24,9 @@ class bncComb : public QObject {
   void slotNewOrbCorrections(QList<t_orbCorr> orbCorrections);
   void slotNewClkCorrections(QList<t_clkCorr> clkCorrections);
 
+ private slots:
+  void slotEpoTimer();
+
  signals:
   void newMessage(QByteArray msg, bool showOnScreen);
   void newOrbCorrections(QList<t_orbCorr>);
@@ -35,14 +38,15 @@ class bncComb : public QObject {
   class cmbParam {
    public:
     enum parType {offACgps, offACglo, offACSat, clkSat};
-    cmbParam(parType type_, int index_, const QString& ac_, const QString& prn_);
+    cmbParam(parType type_, int index_, const QString& ac_, int iAC_, const QString& prn_);
     ~cmbParam();
-    double partial(const QString& AC_, const QString& prn_);
     QString toString() const;
     parType type;
     int     index;
     QString AC;
     QString prn;
+    int     iAC;      // index into _ACs, -1 if not AC-specific
+    int     iPrn;     // t_prn::toInt(), 0 if not satellite-specific
     double  xx;
     double  sig0;
     double  sigP;
@@ -53,66 +57,113 @@ class bncComb : public QObject {
   class cmbAC {
    public:
     cmbAC() {
-      weight = 0.0;
-      numObs = 0;
+      weight     = 0.0;
+      numObs     = 0;
+      latency    = -1.0;
+      latencyVar = 0.0;
+      numMissing = 0;
+      numLate    = 0;
     }
     ~cmbAC() {}
     QString  mountPoint;
     QString  name;
     double   weight;
     unsigned numObs;
+    double   latency;     // smoothed delay after the first AC of an epoch [ms]
+    double   latencyVar;  // its variance [ms^2], latency < 0: not yet known
+    unsigned numMissing;  // consecutive epochs released without this AC
+    unsigned numLate;     // epochs delivered after their release
   };
 
   class cmbCorr {
    public:
     cmbCorr() {
-      _eph        = 0;
       _iod        = 0;
       _dClkResult = 0.0;
+      _iAC        = -1;
+      _iPrn       = 0;
     }
     ~cmbCorr() {}
     QString       _prn;
     bncTime       _time;
     unsigned long _iod;
-    t_eph*        _eph;
+    QSharedPointer<const t_eph> _eph;
     t_orbCorr     _orbCorr;
     t_clkCorr     _clkCorr;
     QString       _acName;
+    int           _iAC;         // index into _ACs
+    int           _iPrn;        // t_prn::toInt()
     double        _dClkResult;
     ColumnVector  _diffRao;
     QString ID() {return _acName + "_" + _prn;}
   };
 
+  // Corrections of one epoch in a slot of the epoch ring; key and age are
+  // kept after the release to recognize late ACs
   class cmbEpoch {
    public:
-    cmbEpoch() {}
-    ~cmbEpoch() {
-      QVectorIterator<cmbCorr*> it(corrs);
-      while (it.hasNext()) {
-        delete it.next();
-      }
-    }
+    cmbEpoch() : _key(-1), _released(true), _numACs(0) {}
+    ~cmbEpoch() {}
+    void reset(qint64 key, const bncTime& time, int numACs);
+    qint64            _key;         // epoch time / sampling interval
+    bncTime           _time;
+    bool              _released;    // processed or dropped
+    QElapsedTimer     _age;         // since the first correction arrived
+    QVector<bool>     _delivered;   // ACs delivered (index into _ACs)
+    int               _numACs;      // number of ACs delivered
     QVector<cmbCorr*> corrs;
   };
 
-  void  processEpoch();
+  // One row of the first design matrix; all partials are equal to one
+  class cmbRow {
+   public:
+    QVector<int> iPar;      // parameter indices (0-based)
+    double       ll;
+    double       pp;
+  };
+
+  qint64    epoKey(const bncTime& tt) const;
+  cmbEpoch* findEpoch(const bncTime& tt);
+  cmbEpoch* oldestEpoch();
+  void      deliver(cmbEpoch* epoch, int iAC);
+  double    waitTime(const cmbAC* AC) const;
+  bool      epochReady(const cmbEpoch* epoch, const bncTime& lastTime) const;
+  void      releaseEpoch(cmbEpoch* epoch);
+  void      processEpochs(const bncTime& lastTime);
+  cmbCorr*  acquireCorr();
+  void      releaseCorr(cmbCorr* corr);
+  void  processEpoch(cmbEpoch* epoch);
   t_irc processEpoch_filter(QTextStream& out, QMap<QString, cmbCorr*>& resCorr,
                             ColumnVector& dx);
   t_irc processEpoch_singleEpoch(QTextStream& out, QMap<QString, cmbCorr*>& resCorr,
                                  ColumnVector& dx);
-  t_irc createAmat(Matrix& AA, ColumnVector& ll, DiagonalMatrix& PP,
-                   const ColumnVector& x0, QMap<QString, cmbCorr*>& resCorr);
+  t_irc createAmat(QVector<cmbRow>& rows, const ColumnVector& x0,
+                   QMap<QString, cmbCorr*>& resCorr);
+  void  kalmanUpdate(const QVector<cmbRow>& rows, SymmetricMatrix& QQ,
+                     ColumnVector& dx);
+  void  residuals(const QVector<cmbRow>& rows, const ColumnVector& dx,
+                  ColumnVector& vv);
   void  dumpResults(const QMap<QString, cmbCorr*>& resCorr);
   void  printResults(QTextStream& out, const QMap<QString, cmbCorr*>& resCorr);
-  void  switchToLastEph(t_eph* lastEph, cmbCorr* corr);
+  QByteArray switchToLastEph(const QSharedPointer<const t_eph>& lastEph, cmbCorr* corr);
   t_irc checkOrbits(QTextStream& out);
-  QVector<cmbCorr*>& corrs() {return _buffer[_resTime].corrs;}
+  QVector<cmbCorr*>& corrs() {return _epoch->corrs;}
 
   QMutex                                 _mutex;
   QList<cmbAC*>                          _ACs;
   bncTime                                _resTime;
   QVector<cmbParam*>                     _params;
-  QMap<bncTime, cmbEpoch>                _buffer;
+  static const int                       _numSlots   = 16;   // epochs in the ring
+  static const int                       _minWait    = 100;  // min. wait for missing ACs [ms]
+  static const unsigned                  _maxMissing = 3;    // missing epochs, AC not waited for
+  static const int                       _epoTimerInt = 100; // check of waiting epochs [ms]
+  QTimer*                                _epoTimer;
+  bncTime                                _lastTime;        // newest corrections
+  cmbEpoch                               _ring[_numSlots];
+  cmbEpoch*                              _epoch;           // epoch being combined
+  QVector<cmbCorr*>                      _corrPool;        // released corrections
+  double                                 _latencySum;      // combination latency [ms]
+  unsigned                               _numEpochs;
   bncRtnetDecoder*                       _rtnetDecoder;
   SymmetricMatrix                        _QQ;
   QByteArray                             _log;
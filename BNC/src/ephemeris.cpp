@@ -9,6 +9,7 @@
 #include "bncutils.h"
 #include "bnctime.h"
 #include "bnccore.h"
+#include "bncsatcache.h"
 #include "bncutils.h"
 #include "satObs.h"
 #include "pppInclude.h"
@@ -20,89 +21,83 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////////////
 t_eph::t_eph() {
   _checkState = unchecked;
-  _orbCorr    = 0;
-  _clkCorr    = 0;
+  _fingerprint.store(0);
 }
 // Destructor
 ////////////////////////////////////////////////////////////////////////////
 t_eph::~t_eph() {
-  if (_orbCorr)
-    delete _orbCorr;
-  if (_clkCorr)
-    delete _clkCorr;
 }
 
-//
+// Hash of the ephemeris content (identifies copies in bncSatCache)
 ////////////////////////////////////////////////////////////////////////////
-void t_eph::setOrbCorr(const t_orbCorr* orbCorr) {
-  if (_orbCorr) {
-    delete _orbCorr;
-    _orbCorr = 0;
+unsigned t_eph::fingerprint() const {
+  int fp = _fingerprint.loadAcquire();
+  if (fp == 0) {
+    fp = int(qHash(toString(3.0)) | 1u);
+    _fingerprint.storeRelease(fp);
   }
-  _orbCorr = new t_orbCorr(*orbCorr);
+  return unsigned(fp);
 }
 
-//
+// Position and clock, corrected if orbit and clock corrections are given
 ////////////////////////////////////////////////////////////////////////////
-void t_eph::setClkCorr(const t_clkCorr* clkCorr) {
-  if (_clkCorr) {
-    delete _clkCorr;
-    _clkCorr = 0;
+t_irc t_eph::getCrd(const bncTime& tt, ColumnVector& xc, ColumnVector& vv,
+                    const t_orbCorr* orbCorr, const t_clkCorr* clkCorr) const {
+
+  if (_checkState == bad) {
+    return failure;
+  }
+  xc.ReSize(4);
+  vv.ReSize(3);
+  if ((orbCorr == 0) != (clkCorr == 0)) {
+    return failure;
   }
-  _clkCorr = new t_clkCorr(*clkCorr);
+  return bncSatCache::instance()->position(this, tt, orbCorr, clkCorr, xc.data(), vv.data());
 }
 
-//
+// Apply orbit and clock corrections to a broadcast state
 ////////////////////////////////////////////////////////////////////////////
-t_irc t_eph::getCrd(const bncTime& tt, ColumnVector& xc, ColumnVector& vv, bool useCorr) const {
+void t_eph::applyCorr(const bncTime& tt, const t_orbCorr* orbCorr,
+                      const t_clkCorr* clkCorr, double* xc, double* vv) {
 
-  if (_checkState == bad) {
-    return failure;
-  }
   const QVector<int> updateInt = QVector<int>()  << 1 << 2 << 5 << 10 << 15 << 30
                                                  << 60 << 120 << 240 << 300 << 600
                                                  << 900 << 1800 << 3600 << 7200
                                                  << 10800;
-  xc.ReSize(4);
-  vv.ReSize(3);
-  if (position(tt.gpsw(), tt.gpssec(), xc.data(), vv.data()) != success) {
-    return failure;
+
+  ColumnVector rr(3);
+  ColumnVector rv(3);
+  rr << xc;
+  rv << vv;
+
+  double dtO = tt - orbCorr->_time;
+  if (orbCorr->_updateInt) {
+    dtO -= (0.5 * updateInt[orbCorr->_updateInt]);
   }
-  if (useCorr) {
-    if (_orbCorr && _clkCorr) {
-      double dtO = tt - _orbCorr->_time;
-      if (_orbCorr->_updateInt) {
-        dtO -= (0.5 * updateInt[_orbCorr->_updateInt]);
-      }
-      ColumnVector dx(3);
-      dx[0] = _orbCorr->_xr[0] + _orbCorr->_dotXr[0] * dtO;
-      dx[1] = _orbCorr->_xr[1] + _orbCorr->_dotXr[1] * dtO;
-      dx[2] = _orbCorr->_xr[2] + _orbCorr->_dotXr[2] * dtO;
+  ColumnVector dx(3);
+  dx[0] = orbCorr->_xr[0] + orbCorr->_dotXr[0] * dtO;
+  dx[1] = orbCorr->_xr[1] + orbCorr->_dotXr[1] * dtO;
+  dx[2] = orbCorr->_xr[2] + orbCorr->_dotXr[2] * dtO;
 
-      RSW_to_XYZ(xc.Rows(1,3), vv.Rows(1,3), dx, dx);
+  RSW_to_XYZ(rr, rv, dx, dx);
 
-      xc[0] -= dx[0];
-      xc[1] -= dx[1];
-      xc[2] -= dx[2];
+  xc[0] -= dx[0];
+  xc[1] -= dx[1];
+  xc[2] -= dx[2];
+  rr << xc;
 
-      ColumnVector dv(3);
-      RSW_to_XYZ(xc.Rows(1,3), vv.Rows(1,3), _orbCorr->_dotXr, dv);
+  ColumnVector dv(3);
+  RSW_to_XYZ(rr, rv, orbCorr->_dotXr, dv);
 
-      vv[0] -= dv[0];
-      vv[1] -= dv[1];
-      vv[2] -= dv[2];
+  vv[0] -= dv[0];
+  vv[1] -= dv[1];
+  vv[2] -= dv[2];
 
-      double dtC = tt - _clkCorr->_time;
-      if (_clkCorr->_updateInt) {
-        dtC -= (0.5 * updateInt[_clkCorr->_updateInt]);
-      }
-      xc[3] += _clkCorr->_dClk + _clkCorr->_dotDClk * dtC + _clkCorr->_dotDotDClk * dtC * dtC;
-    }
-    else {
-      return failure;
-    }
+  double dtC = tt - clkCorr->_time;
+  if (clkCorr->_updateInt) {
+    dtC -= (0.5 * updateInt[clkCorr->_updateInt]);
   }
-  return success;
+  xc[3] += clkCorr->_dClk + clkCorr->_dotDClk * dtC + clkCorr->_dotDotDClk * dtC * dtC;
 }
 
 //
@@ -595,6 +590,8 @@ t_ephGlo::t_ephGlo(float rnxVersion, const QStringList& lines) {
   _xv(6) = _z_velocity * 1.e3;
 }
 
+const double t_ephGlo::tableStep = 30.0;
+
 // Compute Glonass Satellite Position (virtual)
 ////////////////////////////////////////////////////////////////////////////
 t_irc t_ephGlo::position(int GPSweek, double GPSweeks, double* xc, double* vv) const {
@@ -603,8 +600,6 @@ t_irc t_ephGlo::position(int GPSweek, double GPSweeks, double* xc, double* vv) c
     return failure;
   }
 
-  static const double nominalStep = 10.0;
-
   memset(xc, 0, 4*sizeof(double));
   memset(vv, 0, 3*sizeof(double));
 
@@ -614,27 +609,35 @@ t_irc t_ephGlo::position(int GPSweek, double GPSweeks, double* xc, double* vv) c
     return failure;
   }
 
-  int nSteps  = int(fabs(dtPos) / nominalStep) + 1;
-  double step = dtPos / nSteps;
-
-  double acc[3];
-  acc[0] = _x_acceleration * 1.e3;
-  acc[1] = _y_acceleration * 1.e3;
-  acc[2] = _z_acceleration * 1.e3;
-  for (int ii = 1; ii <= nSteps; ii++) {
-    _xv = rungeKutta4(_tt.gpssec(), _xv, step, acc, glo_deriv);
-    _tt = _tt + step;
+  // Orbit table (integrated once, extended on demand)
+  // -------------------------------------------------
+  double    hh  = (dtPos >= 0.0) ? tableStep : -tableStep;
+  double    xx  = fabs(dtPos) / tableStep;
+  unsigned  idx = unsigned(xx);
+  t_gloNode n0, n1;
+  {
+    QMutexLocker locker(&_table._mutex);
+    std::vector<t_gloNode>& table = (dtPos >= 0.0) ? _table._fwd : _table._bwd;
+    if (table.size() < idx + 2) {
+      extendTable(table, hh, idx + 2);
+    }
+    n0 = table[idx];
+    n1 = table[idx+1];
   }
 
-  // Position and Velocity
-  // ---------------------
-  xc[0] = _xv(1);
-  xc[1] = _xv(2);
-  xc[2] = _xv(3);
-
-  vv[0] = _xv(4);
-  vv[1] = _xv(5);
-  vv[2] = _xv(6);
+  // Cubic Hermite interpolation (position from velocity, velocity from acceleration)
+  // --------------------------------------------------------------------------------
+  double ss  = xx - idx;
+  double s2  = ss * ss;
+  double s3  = s2 * ss;
+  double h00 =  2.0*s3 - 3.0*s2 + 1.0;
+  double h10 =      s3 - 2.0*s2 + ss;
+  double h01 = -2.0*s3 + 3.0*s2;
+  double h11 =      s3 -     s2;
+  for (int ii = 0; ii < 3; ii++) {
+    xc[ii] = h00 * n0._xv[ii]   + h10 * hh * n0._va[ii]   + h01 * n1._xv[ii]   + h11 * hh * n1._va[ii];
+    vv[ii] = h00 * n0._xv[ii+3] + h10 * hh * n0._va[ii+3] + h01 * n1._xv[ii+3] + h11 * hh * n1._va[ii+3];
+  }
 
   // Clock Correction
   // ----------------
@@ -644,6 +647,50 @@ t_irc t_ephGlo::position(int GPSweek, double GPSweeks, double* xc, double* vv) c
   return success;
 }
 
+// Integrate the orbit table up to the given number of nodes
+////////////////////////////////////////////////////////////////////////////
+void t_ephGlo::extendTable(std::vector<t_gloNode>& table, double step, unsigned size) const {
+
+  static const int nSubSteps = 3; // integration step 10 sec
+
+  double acc[3];
+  acc[0] = _x_acceleration * 1.e3;
+  acc[1] = _y_acceleration * 1.e3;
+  acc[2] = _z_acceleration * 1.e3;
+
+  if (table.empty()) {
+    t_gloNode node;
+    for (int ii = 0; ii < 6; ii++) {
+      node._xv[ii] = _xv[ii];
+    }
+    glo_deriv(node._xv, acc, node._va);
+    table.push_back(node);
+  }
+
+  table.reserve(size);
+
+  double dx = step / nSubSteps;
+  while (table.size() < size) {
+    t_gloNode node = table.back();
+    double* yi = node._xv;
+    for (int iStep = 0; iStep < nSubSteps; iStep++) {
+      double k1[6], k2[6], k3[6], k4[6], yy[6];
+      glo_deriv(yi, acc, k1);
+      for (int ii = 0; ii < 6; ii++) yy[ii] = yi[ii] + k1[ii] * dx / 2.0;
+      glo_deriv(yy, acc, k2);
+      for (int ii = 0; ii < 6; ii++) yy[ii] = yi[ii] + k2[ii] * dx / 2.0;
+      glo_deriv(yy, acc, k3);
+      for (int ii = 0; ii < 6; ii++) yy[ii] = yi[ii] + k3[ii] * dx;
+      glo_deriv(yy, acc, k4);
+      for (int ii = 0; ii < 6; ii++) {
+        yi[ii] += dx * (k1[ii]/6.0 + k2[ii]/3.0 + k3[ii]/3.0 + k4[ii]/6.0);
+      }
+    }
+    glo_deriv(node._xv, acc, node._va);
+    table.push_back(node);
+  }
+}
+
 // RINEX Format String
 //////////////////////////////////////////////////////////////////////////////
 QString t_ephGlo::toString(double version) const {
@@ -682,13 +729,12 @@ QString t_ephGlo::toString(double version) const {
 
 // Derivative of the state vector using a simple force model (static)
 ////////////////////////////////////////////////////////////////////////////
-ColumnVector t_ephGlo::glo_deriv(double /* tt */, const ColumnVector& xv,
-                                 double* acc) {
+void t_ephGlo::glo_deriv(const double* xv, const double* acc, double* va) {
 
   // State vector components
   // -----------------------
-  ColumnVector rr = xv.rows(1,3);
-  ColumnVector vv = xv.rows(4,6);
+  const double* rr = xv;
+  const double* vv = xv + 3;
 
   // Acceleration
   // ------------
@@ -697,24 +743,21 @@ ColumnVector t_ephGlo::glo_deriv(double /* tt */, const ColumnVector& xv,
   static const double OMEGA = 7292115.e-11;
   static const double C20   = -1082.6257e-6;
 
-  double rho = rr.norm_Frobenius();
+  double rho = sqrt(rr[0]*rr[0] + rr[1]*rr[1] + rr[2]*rr[2]);
   double t1  = -gmWGS/(rho*rho*rho);
   double t2  = 3.0/2.0 * C20 * (gmWGS*AE*AE) / (rho*rho*rho*rho*rho);
   double t3  = OMEGA * OMEGA;
   double t4  = 2.0 * OMEGA;
-  double z2  = rr(3) * rr(3);
+  double z2  = rr[2] * rr[2];
 
   // Vector of derivatives
   // ---------------------
-  ColumnVector va(6);
-  va(1) = vv(1);
-  va(2) = vv(2);
-  va(3) = vv(3);
-  va(4) = (t1 + t2*(1.0-5.0*z2/(rho*rho)) + t3) * rr(1) + t4*vv(2) + acc[0];
-  va(5) = (t1 + t2*(1.0-5.0*z2/(rho*rho)) + t3) * rr(2) - t4*vv(1) + acc[1];
-  va(6) = (t1 + t2*(3.0-5.0*z2/(rho*rho))     ) * rr(3)            + acc[2];
-
-  return va;
+  va[0] = vv[0];
+  va[1] = vv[1];
+  va[2] = vv[2];
+  va[3] = (t1 + t2*(1.0-5.0*z2/(rho*rho)) + t3) * rr[0] + t4*vv[1] + acc[0];
+  va[4] = (t1 + t2*(1.0-5.0*z2/(rho*rho)) + t3) * rr[1] - t4*vv[0] + acc[1];
+  va[5] = (t1 + t2*(3.0-5.0*z2/(rho*rho))     ) * rr[2]            + acc[2];
 }
 
 // IOD of Glonass Ephemeris (virtual)
@@ -1758,3 +1801,214 @@ QString t_ephBDS::toString(double version) const {
     .arg("",            19, QChar(' '));
   return rnxStr;
 }
+
+// Remove all satellites
+////////////////////////////////////////////////////////////////////////////
+void t_ephBatch::clear() {
+  _ephs.clear();
+  _kepler.clear();
+  _toe.clear();   _toc.clear();
+  _a0.clear();    _n.clear();     _M0.clear();   _e.clear();
+  _omega.clear(); _i0.clear();    _IDOT.clear();
+  _OM0.clear();   _OMDOT.clear(); _dotOM.clear();
+  _Crc.clear();   _Crs.clear();   _Cic.clear();  _Cis.clear();
+  _Cuc.clear();   _Cus.clear();
+  _af0.clear();   _af1.clear();   _af2.clear();
+  _relF.clear();  _relXV.clear();
+}
+
+// Add a satellite (returns its index in the output arrays)
+////////////////////////////////////////////////////////////////////////////
+unsigned t_ephBatch::add(const t_eph* eph) {
+
+  static const double omegaEarth = 7292115.1467e-11;
+  static const double omegaBDS   = 7292115.0000e-11;
+  static const double gmGRS      = 398.6005e12;
+  static const double gmWGS      = 398.6004418e12;
+  static const double iMaxGEO    = 10.0 / 180.0 * M_PI;
+
+  if (_ephs.empty()) {
+    _refTime = eph->TOC();
+  }
+
+  // Dummy circular orbit (results are replaced for non-Keplerian satellites)
+  // ------------------------------------------------------------------------
+  bool   kepler = false;
+  double a0     = 26560.0e3;
+  double gm     = gmWGS;
+  double toe    = 0.0, toc    = 0.0;
+  double M0     = 0.0, dn     = 0.0, ee   = 0.0, omega = 0.0;
+  double i0     = 0.0, IDOT   = 0.0, OM0  = 0.0, OMDOT = 0.0, dotOM = 0.0;
+  double Crc    = 0.0, Crs    = 0.0, Cic  = 0.0, Cis   = 0.0, Cuc   = 0.0, Cus = 0.0;
+  double af0    = 0.0, af1    = 0.0, af2  = 0.0;
+  double relF   = 0.0, relXV  = 0.0;
+
+  const t_ephGPS* ephGPS = dynamic_cast<const t_ephGPS*>(eph);
+  const t_ephGal* ephGal = dynamic_cast<const t_ephGal*>(eph);
+  const t_ephBDS* ephBDS = dynamic_cast<const t_ephBDS*>(eph);
+
+  if      (ephGPS && ephGPS->_sqrt_A != 0.0) {
+    kepler = true;
+    a0    = ephGPS->_sqrt_A * ephGPS->_sqrt_A;
+    gm    = gmGRS;
+    toe   = bncTime(int(ephGPS->_TOEweek), ephGPS->_TOEsec) - _refTime;
+    M0    = ephGPS->_M0;     dn   = ephGPS->_Delta_n; ee    = ephGPS->_e;
+    omega = ephGPS->_omega;  i0   = ephGPS->_i0;      IDOT  = ephGPS->_IDOT;
+    OM0   = ephGPS->_OMEGA0 - omegaEarth * ephGPS->_TOEsec;
+    OMDOT = ephGPS->_OMEGADOT - omegaEarth;
+    dotOM = ephGPS->_OMEGADOT - omegaEarth;
+    Crc   = ephGPS->_Crc;    Crs  = ephGPS->_Crs;
+    Cic   = ephGPS->_Cic;    Cis  = ephGPS->_Cis;
+    Cuc   = ephGPS->_Cuc;    Cus  = ephGPS->_Cus;
+    af0   = ephGPS->_clock_bias; af1 = ephGPS->_clock_drift; af2 = ephGPS->_clock_driftrate;
+    relXV = 1.0;
+  }
+  else if (ephGal && ephGal->_sqrt_A != 0.0) {
+    kepler = true;
+    a0    = ephGal->_sqrt_A * ephGal->_sqrt_A;
+    gm    = gmWGS;
+    toe   = bncTime(ephGal->_TOC.gpsw(), ephGal->_TOEsec) - _refTime;
+    M0    = ephGal->_M0;     dn   = ephGal->_Delta_n; ee    = ephGal->_e;
+    omega = ephGal->_omega;  i0   = ephGal->_i0;      IDOT  = ephGal->_IDOT;
+    OM0   = ephGal->_OMEGA0 - omegaEarth * ephGal->_TOEsec;
+    OMDOT = ephGal->_OMEGADOT - omegaEarth;
+    dotOM = ephGal->_OMEGADOT - omegaEarth;
+    Crc   = ephGal->_Crc;    Crs  = ephGal->_Crs;
+    Cic   = ephGal->_Cic;    Cis  = ephGal->_Cis;
+    Cuc   = ephGal->_Cuc;    Cus  = ephGal->_Cus;
+    af0   = ephGal->_clock_bias; af1 = ephGal->_clock_drift; af2 = ephGal->_clock_driftrate;
+    relF  = -4.442807633e-10 * ephGal->_e * sqrt(a0);
+  }
+  else if (ephBDS && ephBDS->_sqrt_A != 0.0 && ephBDS->_i0 > iMaxGEO) {
+    kepler = true;
+    a0    = ephBDS->_sqrt_A * ephBDS->_sqrt_A;
+    gm    = gmWGS;
+    toe   = ephBDS->_TOE - _refTime;
+    M0    = ephBDS->_M0;     dn   = ephBDS->_Delta_n; ee    = ephBDS->_e;
+    omega = ephBDS->_omega;  i0   = ephBDS->_i0;      IDOT  = ephBDS->_IDOT;
+    OM0   = ephBDS->_OMEGA0 - omegaBDS * (ephBDS->_TOE.gpssec() - 14.0);
+    OMDOT = ephBDS->_OMEGADOT - omegaBDS;
+    dotOM = ephBDS->_OMEGADOT - t_CST::omega;
+    Crc   = ephBDS->_Crc;    Crs  = ephBDS->_Crs;
+    Cic   = ephBDS->_Cic;    Cis  = ephBDS->_Cis;
+    Cuc   = ephBDS->_Cuc;    Cus  = ephBDS->_Cus;
+    af0   = ephBDS->_clock_bias; af1 = ephBDS->_clock_drift; af2 = ephBDS->_clock_driftrate;
+    relF  = -4.442807633e-10 * ephBDS->_e * sqrt(a0);
+  }
+  if (kepler) {
+    toc = eph->TOC() - _refTime;
+  }
+
+  _ephs.push_back(eph);
+  _kepler.push_back(kepler ? 1 : 0);
+  _toe.push_back(toe);     _toc.push_back(toc);
+  _a0.push_back(a0);       _n.push_back(sqrt(gm/(a0*a0*a0)) + dn);
+  _M0.push_back(M0);       _e.push_back(ee);
+  _omega.push_back(omega); _i0.push_back(i0);       _IDOT.push_back(IDOT);
+  _OM0.push_back(OM0);     _OMDOT.push_back(OMDOT); _dotOM.push_back(dotOM);
+  _Crc.push_back(Crc);     _Crs.push_back(Crs);
+  _Cic.push_back(Cic);     _Cis.push_back(Cis);
+  _Cuc.push_back(Cuc);     _Cus.push_back(Cus);
+  _af0.push_back(af0);     _af1.push_back(af1);     _af2.push_back(af2);
+  _relF.push_back(relF);   _relXV.push_back(relXV);
+
+  return _ephs.size() - 1;
+}
+
+// Positions, velocities and clocks of all satellites at time tt
+////////////////////////////////////////////////////////////////////////////
+void t_ephBatch::getCrd(const bncTime& tt, double* xx, double* yy, double* zz, double* clk,
+                        double* vx, double* vy, double* vz, t_irc* irc) const {
+
+  const unsigned nSat = _ephs.size();
+  if (nSat == 0) {
+    return;
+  }
+
+  const double dt = tt - _refTime;
+
+  // Keplerian orbits (no branches, fixed number of iterations)
+  // -----------------------------------------------------------
+  for (unsigned ii = 0; ii < nSat; ii++) {
+    const double ee = _e[ii];
+    const double n  = _n[ii];
+    const double tk = dt - _toe[ii];
+    const double M  = _M0[ii] + n*tk;
+
+    double E = M + ee*sin(M);
+    for (int iter = 0; iter < nKepler; iter++) {
+      E -= (E - ee*sin(E) - M) / (1.0 - ee*cos(E));
+    }
+    const double sinE   = sin(E);
+    const double cosE   = cos(E);
+    const double sqe    = sqrt(1.0 - ee*ee);
+    const double dEdM   = 1.0 / (1.0 - ee*cosE);
+
+    const double v      = atan2(sqe*sinE, cosE - ee);
+    const double u0     = v + _omega[ii];
+    const double sin2u0 = sin(2*u0);
+    const double cos2u0 = cos(2*u0);
+    const double r      = _a0[ii]*(1 - ee*cosE) + _Crc[ii]*cos2u0 + _Crs[ii]*sin2u0;
+    const double i      = _i0[ii] + _IDOT[ii]*tk + _Cic[ii]*cos2u0 + _Cis[ii]*sin2u0;
+    const double u      = u0 + _Cuc[ii]*cos2u0 + _Cus[ii]*sin2u0;
+    const double sinu   = sin(u);
+    const double cosu   = cos(u);
+    const double xp     = r*cosu;
+    const double yp     = r*sinu;
+    const double OM     = _OM0[ii] + _OMDOT[ii]*tk;
+
+    const double sinom  = sin(OM);
+    const double cosom  = cos(OM);
+    const double sini   = sin(i);
+    const double cosi   = cos(i);
+    xx[ii] = xp*cosom - yp*cosi*sinom;
+    yy[ii] = xp*sinom + yp*cosi*cosom;
+    zz[ii] = yp*sini;
+
+    // Velocity
+    // --------
+    const double dotv  = sqe * dEdM * dEdM * n;
+    const double dotu  = dotv + (-_Cuc[ii]*sin2u0 + _Cus[ii]*cos2u0)*2*dotv;
+    const double dotom = _dotOM[ii];
+    const double doti  = _IDOT[ii] + (-_Cic[ii]*sin2u0 + _Cis[ii]*cos2u0)*2*dotv;
+    const double dotr  = _a0[ii] * ee*sinE * dEdM * n
+                       + (-_Crc[ii]*sin2u0 + _Crs[ii]*cos2u0)*2*dotv;
+    const double dotx  = dotr*cosu - r*sinu*dotu;
+    const double doty  = dotr*sinu + r*cosu*dotu;
+
+    vx[ii] = cosom   *dotx  - cosi*sinom   *doty
+           - xp*sinom*dotom - yp*cosi*cosom*dotom
+                            + yp*sini*sinom*doti;
+    vy[ii] = sinom   *dotx  + cosi*cosom   *doty
+           + xp*cosom*dotom - yp*cosi*sinom*dotom
+                            - yp*sini*cosom*doti;
+    vz[ii] = sini    *doty  + yp*cosi      *doti;
+
+    // Clock with Relativistic Correction
+    // ----------------------------------
+    const double tc = dt - _toc[ii];
+    clk[ii] = _af0[ii] + _af1[ii]*tc + _af2[ii]*tc*tc
+            + _relF[ii] * sinE
+            - _relXV[ii] * 2.0 * (xx[ii]*vx[ii] + yy[ii]*vy[ii] + zz[ii]*vz[ii]) / t_CST::c / t_CST::c;
+  }
+
+  // Check state and other satellites (GLONASS, SBAS, BDS GEO)
+  // ---------------------------------------------------------
+  ColumnVector xc(4);
+  ColumnVector vv(3);
+  for (unsigned ii = 0; ii < nSat; ii++) {
+    if (_kepler[ii] && _ephs[ii]->checkState() != t_eph::bad) {
+      irc[ii] = success;
+      continue;
+    }
+    irc[ii] = _ephs[ii]->getCrd(tt, xc, vv);
+    if (irc[ii] == success) {
+      xx[ii] = xc[0]; yy[ii] = xc[1]; zz[ii] = xc[2]; clk[ii] = xc[3];
+      vx[ii] = vv[0]; vy[ii] = vv[1]; vz[ii] = vv[2];
+    }
+    else {
+      xx[ii] = yy[ii] = zz[ii] = clk[ii] = 0.0;
+      vx[ii] = vy[ii] = vz[ii] = 0.0;
+    }
+  }
+}
@@ -5,6 +5,7 @@
 #include <QtCore>
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include "bnctime.h"
 #include "bncconst.h"
 #include "t_prn.h"
@@ -15,6 +16,7 @@ class t_orbCorr;
 class t_clkCorr;
 
 class t_eph {
+ friend class bncSatCache;
  public:
   enum e_type {unknown, GPS, QZSS, GLONASS, Galileo, SBAS, BDS, IRNSS};
   enum e_checkState {unchecked, ok, bad, outdated, unhealthy};
@@ -23,6 +25,7 @@ class t_eph {
   virtual ~t_eph();
 
   virtual e_type  type() const = 0;
+  virtual t_eph*  clone() const = 0;
   virtual QString toString(double version) const = 0;
   virtual unsigned int IOD() const = 0;
   virtual unsigned int isUnhealthy() const = 0;
@@ -32,27 +35,29 @@ class t_eph {
   e_checkState checkState() const {return _checkState;}
   void    setCheckState(e_checkState checkState) {_checkState = checkState;}
   t_prn   prn() const {return _prn;}
-  t_irc   getCrd(const bncTime& tt, ColumnVector& xc, ColumnVector& vv, bool useCorr) const;
-  void    setOrbCorr(const t_orbCorr* orbCorr);
-  void    setClkCorr(const t_clkCorr* clkCorr);
+  t_irc   getCrd(const bncTime& tt, ColumnVector& xc, ColumnVector& vv,
+                 const t_orbCorr* orbCorr = 0, const t_clkCorr* clkCorr = 0) const;
   const QDateTime& receptDateTime() const {return _receptDateTime;}
   static QString rinexDateStr(const bncTime& tt, const t_prn& prn, double version);
   static QString rinexDateStr(const bncTime& tt, const QString& prnStr, double version);
   static bool earlierTime(const t_eph* eph1, const t_eph* eph2) {return eph1->_TOC < eph2->_TOC;}
+  unsigned fingerprint() const;
 
  protected:
   virtual t_irc position(int GPSweek, double GPSweeks, double* xc, double* vv) const = 0;
+  static void applyCorr(const bncTime& tt, const t_orbCorr* orbCorr,
+                        const t_clkCorr* clkCorr, double* xc, double* vv);
   t_prn        _prn;
   bncTime      _TOC;
   QDateTime    _receptDateTime;
   e_checkState _checkState;
-  t_orbCorr*   _orbCorr;
-  t_clkCorr*   _clkCorr;
+  mutable QAtomicInt _fingerprint;
 };
 
 
 class t_ephGPS : public t_eph {
  friend class t_ephEncoder;
+ friend class t_ephBatch;
  friend class RTCM3Decoder;
  public:
   t_ephGPS() {
@@ -98,6 +103,7 @@ class t_ephGPS : public t_eph {
     };
     return t_eph::GPS;
   }
+  virtual t_eph* clone() const {return new t_ephGPS(*this);}
   virtual QString toString(double version) const;
   virtual unsigned int  IOD() const { return static_cast<unsigned int>(_IODE); }
   virtual unsigned int  isUnhealthy() const { return static_cast<unsigned int>(_health); }
@@ -189,17 +195,46 @@ class t_ephGlo : public t_eph {
   virtual ~t_ephGlo() {}
 
   virtual e_type type() const {return t_eph::GLONASS;}
+  virtual t_eph* clone() const {return new t_ephGlo(*this);}
   virtual QString toString(double version) const;
   virtual unsigned int  IOD() const;
   virtual unsigned int isUnhealthy() const;
   virtual int slotNum() const {return int(_frequency_number);}
 
  private:
+  class t_gloNode {
+   public:
+    double _xv[6];  // position, velocity
+    double _va[6];  // velocity, acceleration (derivative of _xv)
+  };
+
+  // Orbit table, extended on demand under the mutex (position() may be
+  // called from several threads); a copy of the ephemeris starts empty
+  // -------------------------------------------------------------------
+  class t_gloTable {
+   public:
+    t_gloTable() {}
+    t_gloTable(const t_gloTable&) {}
+    t_gloTable& operator=(const t_gloTable&) {
+      QMutexLocker locker(&_mutex);
+      _fwd.clear();
+      _bwd.clear();
+      return *this;
+    }
+    QMutex                 _mutex;
+    std::vector<t_gloNode> _fwd;  // integrated states at _tt + ii * tableStep
+    std::vector<t_gloNode> _bwd;  // integrated states at _tt - ii * tableStep
+  };
+
   virtual t_irc position(int GPSweek, double GPSweeks, double* xc, double* vv) const;
-  static ColumnVector glo_deriv(double /* tt */, const ColumnVector& xv, double* acc);
+  static void glo_deriv(const double* xv, const double* acc, double* va);
+  void   extendTable(std::vector<t_gloNode>& table, double step, unsigned size) const;
+
+  static const double tableStep;   // node spacing of the orbit table [s]
 
-  mutable bncTime      _tt;  // time
-  mutable ColumnVector _xv;  // status vector (position, velocity) at time _tt
+  bncTime            _tt;     // time of the initial state
+  ColumnVector       _xv;     // initial status vector (position, velocity) at time _tt
+  mutable t_gloTable _table;
 
   double  _gps_utc;
   double  _tau;              // [s]
@@ -245,6 +280,7 @@ class t_ephGlo : public t_eph {
 
 class t_ephGal : public t_eph {
  friend class t_ephEncoder;
+ friend class t_ephBatch;
  friend class RTCM3Decoder;
  public:
   t_ephGal() {
@@ -282,6 +318,7 @@ class t_ephGal : public t_eph {
 
   virtual QString toString(double version) const;
   virtual e_type type() const {return t_eph::Galileo;}
+  virtual t_eph* clone() const {return new t_ephGal(*this);}
   virtual unsigned int  IOD() const { return static_cast<unsigned long>(_IODnav); }
   virtual unsigned int  isUnhealthy() const;
 
@@ -361,6 +398,7 @@ class t_ephSBAS : public t_eph {
   virtual ~t_ephSBAS() {}
 
   virtual e_type  type() const {return t_eph::SBAS;}
+  virtual t_eph*  clone() const {return new t_ephSBAS(*this);}
   virtual unsigned int IOD() const;
   virtual unsigned int  isUnhealthy() const { return static_cast<unsigned int>(_health); }
   virtual QString toString(double version) const;
@@ -391,6 +429,7 @@ class t_ephSBAS : public t_eph {
 
 class t_ephBDS : public t_eph {
  friend class t_ephEncoder;
+ friend class t_ephBatch;
  friend class RTCM3Decoder;
  public:
  t_ephBDS() : _TOEweek(-1.0) {
@@ -428,6 +467,7 @@ class t_ephBDS : public t_eph {
   virtual ~t_ephBDS() {}
 
   virtual e_type  type() const {return t_eph::BDS;}
+  virtual t_eph*  clone() const {return new t_ephBDS(*this);}
   virtual unsigned int IOD() const;
   virtual unsigned int  isUnhealthy() const { return static_cast<unsigned int>(_SatH1); }
   virtual QString toString(double version) const;
@@ -466,4 +506,51 @@ class t_ephBDS : public t_eph {
   double  _TOEsec;           //  [s] of BDT week
   double  _TOEweek;          //  BDT week will be set only in case of RINEX file input
 };
+
+// Broadcast orbits and clocks of a set of satellites evaluated at once.
+// Keplerian orbits (GPS, QZSS, IRNSS, Galileo, BDS MEO/IGSO) are kept as
+// structure of arrays and computed in one loop without virtual calls,
+// other satellites fall back to t_eph::getCrd. Corrections are not applied.
+////////////////////////////////////////////////////////////////////////////
+class t_ephBatch {
+ public:
+  t_ephBatch() {}
+  void         clear();
+  unsigned     add(const t_eph* eph);
+  unsigned     size() const {return _ephs.size();}
+  const t_eph* eph(unsigned ii) const {return _ephs[ii];}
+  void         getCrd(const bncTime& tt, double* xx, double* yy, double* zz, double* clk,
+                      double* vx, double* vy, double* vz, t_irc* irc) const;
+
+ private:
+  static const int nKepler = 5;  // Newton iterations for Kepler's equation (e < 0.3)
+
+  bncTime                   _refTime;  // reference for the times below
+  std::vector<const t_eph*> _ephs;
+  std::vector<char>         _kepler;   // 1: Keplerian elements are used
+  std::vector<double>       _toe;      // [s] since _refTime
+  std::vector<double>       _toc;      // [s] since _refTime
+  std::vector<double>       _a0;
+  std::vector<double>       _n;        // corrected mean motion
+  std::vector<double>       _M0;
+  std::vector<double>       _e;
+  std::vector<double>       _omega;
+  std::vector<double>       _i0;
+  std::vector<double>       _IDOT;
+  std::vector<double>       _OM0;      // OMEGA0 - omegaEarth * toe (sec of week)
+  std::vector<double>       _OMDOT;    // OMEGADOT - omegaEarth
+  std::vector<double>       _dotOM;    // OMEGADOT - omegaEarth (velocity)
+  std::vector<double>       _Crc;
+  std::vector<double>       _Crs;
+  std::vector<double>       _Cic;
+  std::vector<double>       _Cis;
+  std::vector<double>       _Cuc;
+  std::vector<double>       _Cus;
+  std::vector<double>       _af0;
+  std::vector<double>       _af1;
+  std::vector<double>       _af2;
+  std::vector<double>       _relF;     // relativistic clock correction F*e*sqrt(a) (Galileo, BDS)
+  std::vector<double>       _relXV;    // 1: relativistic clock correction from x*v (GPS)
+};
+
 #endif
@@ -0,0 +1,343 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+/* -------------------------------------------------------------------------
+ * BKG NTRIP Client
+ * -------------------------------------------------------------------------
+ *
+ * Class:      t_pppBatchData, t_pppBatch
+ *
+ * Purpose:    Batch Post-Processing PPP on a Thread Pool
+ *
+ * Created:    18-Oct-2026
+ *
+ * Changes:
+ *
+ * -----------------------------------------------------------------------*/
+
+#include <iostream>
+#include <limits>
+
+#include "pppBatch.h"
+#include "pppRun.h"
+#include "bnccore.h"
+#include "ephemeris.h"
+#include "rinex/rnxnavfile.h"
+#include "rinex/corrfile.h"
+
+using namespace BNC_PPP;
+using namespace std;
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+t_pppBatchData::t_event::~t_event() {
+  delete _eph;
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+t_pppBatchData::t_pppBatchData(const QString& navFileName,
+                               const QString& corrFileName) : QObject(0) {
+
+  _firstEvent = 0;
+  _rnxNavFile = new t_rnxNavFile(navFileName, t_rnxNavFile::input);
+  _corrFile   = 0;
+
+  // The corrections are collected in the thread reading the file
+  // ------------------------------------------------------------
+  if (!corrFileName.isEmpty()) {
+    _corrFile = new t_corrFile(corrFileName);
+    connect(_corrFile, SIGNAL(newTec(t_vTec)),
+            this, SLOT(slotNewTec(t_vTec)), Qt::DirectConnection);
+    connect(_corrFile, SIGNAL(newOrbCorrections(QList<t_orbCorr>)),
+            this, SLOT(slotNewOrbCorrections(QList<t_orbCorr>)), Qt::DirectConnection);
+    connect(_corrFile, SIGNAL(newClkCorrections(QList<t_clkCorr>)),
+            this, SLOT(slotNewClkCorrections(QList<t_clkCorr>)), Qt::DirectConnection);
+    connect(_corrFile, SIGNAL(newCodeBiases(QList<t_satCodeBias>)),
+            this, SLOT(slotNewCodeBiases(QList<t_satCodeBias>)), Qt::DirectConnection);
+    connect(_corrFile, SIGNAL(newPhaseBiases(QList<t_satPhaseBias>)),
+            this, SLOT(slotNewPhaseBiases(QList<t_satPhaseBias>)), Qt::DirectConnection);
+  }
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+t_pppBatchData::~t_pppBatchData() {
+  delete _corrFile;
+  delete _rnxNavFile;
+  for (unsigned ii = 0; ii < _events.size(); ii++) {
+    delete _events[ii];
+  }
+}
+
+// Register a new job (before the jobs are started)
+////////////////////////////////////////////////////////////////////////////
+int t_pppBatchData::addJob() {
+  QMutexLocker locker(&_mutex);
+  _nextEvent << _firstEvent;
+  _inUse     << _firstEvent;
+  return _nextEvent.size() - 1;
+}
+
+// Job finished - its events may be released
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatchData::removeJob(int iJob) {
+  QMutexLocker locker(&_mutex);
+  _nextEvent[iJob] = numeric_limits<qint64>::max();
+  _inUse[iJob]     = numeric_limits<qint64>::max();
+  release();
+}
+
+// Error message of the last failed read
+////////////////////////////////////////////////////////////////////////////
+QString t_pppBatchData::errorString() const {
+  QMutexLocker locker(&_mutex);
+  return _errorString;
+}
+
+// New events of a job up to (and including) epoch tt; the events returned
+// by the previous call of the job are no longer used
+////////////////////////////////////////////////////////////////////////////
+t_irc t_pppBatchData::events(int iJob, const bncTime& tt,
+                             QVector<const t_event*>& newEvents) {
+
+  QMutexLocker locker(&_mutex);
+
+  _inUse[iJob] = _nextEvent[iJob];
+  release();
+
+  if (!_errorString.isEmpty()) {
+    return failure;
+  }
+
+  if (!_lastTime.valid() || tt > _lastTime) {
+    if (read(tt) != success) {
+      return failure;
+    }
+    _lastTime = tt;
+  }
+
+  qint64 iEvent = _nextEvent[iJob];
+  qint64 nEvent = _firstEvent + qint64(_events.size());
+  while (iEvent < nEvent && _events[iEvent - _firstEvent]->_time <= tt) {
+    newEvents << _events[iEvent - _firstEvent];
+    ++iEvent;
+  }
+  _nextEvent[iJob] = iEvent;
+
+  return success;
+}
+
+// Read the corrections and ephemerides up to epoch tt (private, locked)
+////////////////////////////////////////////////////////////////////////////
+t_irc t_pppBatchData::read(const bncTime& tt) {
+
+  _readTime = tt;
+
+  if (_corrFile) {
+    try {
+      _corrFile->syncRead(tt);
+    }
+    catch (const char* msg) {
+      _errorString = msg;
+    }
+    catch (const string& msg) {
+      _errorString = msg.c_str();
+    }
+    catch (...) {
+      _errorString = "unknown exceptions in corrFile";
+    }
+    if (!_errorString.isEmpty()) {
+      return failure;
+    }
+  }
+
+  t_eph* eph = 0;
+  const QMap<QString, unsigned int>* corrIODs = _corrFile ? &_corrFile->corrIODs() : 0;
+  while ( (eph = _rnxNavFile->getNextEph(tt, corrIODs)) != 0 ) {
+    t_event* event = new t_event(tt);
+    event->_eph = eph;
+    _events.push_back(event);
+  }
+
+  return success;
+}
+
+// Delete the events no longer used by any job (private, locked)
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatchData::release() {
+  qint64 minInUse = numeric_limits<qint64>::max();
+  for (int iJob = 0; iJob < _inUse.size(); iJob++) {
+    minInUse = qMin(minInUse, _inUse[iJob]);
+  }
+  while (!_events.empty() && _firstEvent < minInUse) {
+    delete _events.front();
+    _events.pop_front();
+    ++_firstEvent;
+  }
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatchData::slotNewTec(t_vTec vTec) {
+  t_event* event = new t_event(_readTime);
+  event->_tec << vTec;
+  _events.push_back(event);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatchData::slotNewOrbCorrections(QList<t_orbCorr> orbCorr) {
+  t_event* event = new t_event(_readTime);
+  event->_orbCorr = orbCorr;
+  _events.push_back(event);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatchData::slotNewClkCorrections(QList<t_clkCorr> clkCorr) {
+  t_event* event = new t_event(_readTime);
+  event->_clkCorr = clkCorr;
+  _events.push_back(event);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatchData::slotNewCodeBiases(QList<t_satCodeBias> codeBiases) {
+  t_event* event = new t_event(_readTime);
+  event->_codeBiases = codeBiases;
+  _events.push_back(event);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatchData::slotNewPhaseBiases(QList<t_satPhaseBias> phaseBiases) {
+  t_event* event = new t_event(_readTime);
+  event->_phaseBiases = phaseBiases;
+  _events.push_back(event);
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+t_pppBatch::t_job::t_job(const t_pppOptions* opt, t_pppBatchData* data) {
+  setAutoDelete(false);
+  _opt       = opt;
+  _data      = data;
+  _iJob      = data->addJob();
+  _numEpochs = 0;
+  _msec      = 0;
+}
+
+// Process one RINEX observation file (in a thread of the pool)
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatch::t_job::run() {
+  QElapsedTimer timer;
+  timer.start();
+  try {
+    t_pppRun pppRun(_opt);
+    _numEpochs = pppRun.processBatch(_data, _iJob, _errorString);
+  }
+  catch (t_except exc) {
+    _errorString = exc.what().c_str();
+  }
+  catch (...) {
+    _errorString = QString("cannot process %1").arg(_opt->_rinexObs.c_str());
+  }
+  _data->removeJob(_iJob);
+  _msec = timer.elapsed();
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+t_pppBatch::t_pppBatch(const QList<t_pppOptions*>& options) : QThread(0) {
+
+  _options = options;
+
+  connect(this, SIGNAL(newMessage(QByteArray,bool)),
+          BNC_CORE, SLOT(slotMessage(const QByteArray,bool)));
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+t_pppBatch::~t_pppBatch() {
+  wait();
+  qDeleteAll(_jobs);
+  qDeleteAll(_data);
+}
+
+// Run all jobs, report the throughput (virtual)
+////////////////////////////////////////////////////////////////////////////
+void t_pppBatch::run() {
+
+  // Jobs with the same navigation and correction files share their data
+  // -------------------------------------------------------------------
+  QListIterator<t_pppOptions*> iOpt(_options);
+  while (iOpt.hasNext()) {
+    const t_pppOptions* opt = iOpt.next();
+    QString navFile(opt->_rinexNav.c_str());
+    QString corrFile(opt->_corrFile.c_str());
+    QString key = navFile + '\n' + corrFile;
+    if (!_data.contains(key)) {
+      _data[key] = new t_pppBatchData(navFile, corrFile);
+    }
+    _jobs << new t_job(opt, _data[key]);
+  }
+
+  QThreadPool pool;
+  int numThreads = qMax(1, qMin(QThread::idealThreadCount(), _jobs.size()));
+  pool.setMaxThreadCount(numThreads);
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int ii = 0; ii < _jobs.size(); ii++) {
+    pool.start(_jobs[ii]);
+  }
+  pool.waitForDone();
+  double sec = timer.elapsed() / 1000.0;
+
+  // Throughput
+  // ----------
+  int numEpochs = 0;
+  for (int ii = 0; ii < _jobs.size(); ii++) {
+    const t_job* job = _jobs[ii];
+    numEpochs += job->_numEpochs;
+    QString msg = QString("PPP batch %1: %2 epochs, %3 epochs/sec")
+                  .arg(job->_opt->_rinexObs.c_str())
+                  .arg(job->_numEpochs)
+                  .arg(job->_msec > 0 ? job->_numEpochs * 1000.0 / job->_msec : 0.0, 0, 'f', 1);
+    if (!job->_errorString.isEmpty()) {
+      msg += ", " + job->_errorString;
+    }
+    emit newMessage(msg.toLatin1(), true);
+  }
+  emit newMessage(QString("PPP batch: %1 jobs, %2 epochs in %3 sec on %4 threads, "
+                          "%5 epochs/sec per core")
+                  .arg(_jobs.size()).arg(numEpochs).arg(sec, 0, 'f', 1).arg(numThreads)
+                  .arg(sec > 0.0 ? numEpochs / sec / numThreads : 0.0, 0, 'f', 1)
+                  .toLatin1(), true);
+
+  if (BNC_CORE->mode() != t_bncCore::interactive) {
+    qApp->exit(0);
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef PPPBATCH_H
+#define PPPBATCH_H
+
+#include <deque>
+#include <QtCore>
+
+#include "satObs.h"
+#include "pppOptions.h"
+
+class t_eph;
+class t_rnxNavFile;
+class t_corrFile;
+
+namespace BNC_PPP {
+
+// Navigation and correction data read once and shared by all batch jobs
+// using the same files. The files are read on demand up to the latest
+// epoch requested by any job; an event is kept until all jobs got it.
+////////////////////////////////////////////////////////////////////////////
+class t_pppBatchData : public QObject {
+ Q_OBJECT
+ public:
+  class t_event {
+   public:
+    t_event(const bncTime& tt) : _time(tt), _eph(0) {}
+    ~t_event();
+    bncTime               _time;       // epoch at which the data were read
+    t_eph*                _eph;
+    QList<t_orbCorr>      _orbCorr;
+    QList<t_clkCorr>      _clkCorr;
+    QList<t_satCodeBias>  _codeBiases;
+    QList<t_satPhaseBias> _phaseBiases;
+    QList<t_vTec>         _tec;
+  };
+
+  t_pppBatchData(const QString& navFileName, const QString& corrFileName);
+  ~t_pppBatchData();
+  int     addJob();
+  void    removeJob(int iJob);
+  t_irc   events(int iJob, const bncTime& tt, QVector<const t_event*>& newEvents);
+  QString errorString() const;
+
+ private slots:
+  void slotNewTec(t_vTec vTec);
+  void slotNewOrbCorrections(QList<t_orbCorr> orbCorr);
+  void slotNewClkCorrections(QList<t_clkCorr> clkCorr);
+  void slotNewCodeBiases(QList<t_satCodeBias> codeBiases);
+  void slotNewPhaseBiases(QList<t_satPhaseBias> phaseBiases);
+
+ private:
+  t_irc read(const bncTime& tt);
+  void  release();
+
+  mutable QMutex        _mutex;
+  t_rnxNavFile*         _rnxNavFile;
+  t_corrFile*           _corrFile;
+  bncTime               _lastTime;
+  bncTime               _readTime;
+  QString               _errorString;
+  std::deque<t_event*>  _events;
+  qint64                _firstEvent;  // index of _events.front()
+  QVector<qint64>       _nextEvent;   // per job: first event not yet delivered
+  QVector<qint64>       _inUse;       // per job: first event possibly in use
+};
+
+// Batch post-processing PPP: one job per rover and RINEX observation file,
+// all jobs run on a thread pool without any event loop involvement
+////////////////////////////////////////////////////////////////////////////
+class t_pppBatch : public QThread {
+ Q_OBJECT
+ public:
+  t_pppBatch(const QList<t_pppOptions*>& options);
+  ~t_pppBatch();
+
+ signals:
+  void newMessage(QByteArray msg, bool showOnScreen);
+
+ protected:
+  virtual void run();
+
+ private:
+  class t_job : public QRunnable {
+   public:
+    t_job(const t_pppOptions* opt, t_pppBatchData* data);
+    virtual void run();
+    const t_pppOptions* _opt;
+    t_pppBatchData*     _data;
+    int                 _iJob;
+    int                 _numEpochs;
+    qint64              _msec;
+    QString             _errorString;
+  };
+
+  QList<t_pppOptions*>            _options;
+  QMap<QString, t_pppBatchData*>  _data;
+  QList<t_job*>                   _jobs;
+};
+
+}
+
+#endif
@@ -0,0 +1,386 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+/* -------------------------------------------------------------------------
+ * BKG NTRIP Client
+ * -------------------------------------------------------------------------
+ *
+ * Class:      t_pppDispatcher
+ *
+ * Purpose:    Real-Time PPP Clients sharing one Thread Pool
+ *
+ * Created:    18-Oct-2026
+ *
+ * Changes:
+ *
+ * -----------------------------------------------------------------------*/
+
+#include <iostream>
+
+#include "pppDispatcher.h"
+#include "bnccore.h"
+#include "combination/bnccomb.h"
+
+using namespace BNC_PPP;
+using namespace std;
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+t_pppDispatcher::t_pppDispatcher(const QList<t_pppOptions*>& options) : QObject(0) {
+
+  connect(this, SIGNAL(newMessage(QByteArray,bool)),
+          BNC_CORE, SLOT(slotMessage(const QByteArray,bool)));
+
+  // One filter per rover, the same rover may be processed with several options
+  // ---------------------------------------------------------------------------
+  QListIterator<t_pppOptions*> iOpt(options);
+  while (iOpt.hasNext()) {
+    const t_pppOptions* opt = iOpt.next();
+    try {
+      QByteArray staID(opt->_roverName.c_str());
+      t_rover* rover = new t_rover(staID, new t_pppRun(opt));
+      _rovers << rover;
+      _roverByStaID.insertMulti(staID, rover);
+    }
+    catch (t_except exc) {
+      emit newMessage(QByteArray(exc.what().c_str()), true);
+    }
+  }
+
+  _pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
+  // Observations of a rover are processed before the call returns
+  // -------------------------------------------------------------
+  _blocking = (BNC_CORE->mode() == t_bncCore::batchPostProcessing);
+
+  // An epoch waiting for missing satellites is released even if no further
+  // observations arrive; the timer fires in the main thread and only posts
+  // a wake-up into the inboxes
+  // -----------------------------------------------------------------------
+  _epoTimer = 0;
+  if (!_blocking) {
+    _epoTimer = new QTimer(this);
+    connect(_epoTimer, SIGNAL(timeout()), this, SLOT(slotEpoTimer()));
+    _epoTimer->start(_epoTimerInt);
+  }
+
+  // The slots run in the thread of the sender (also the main thread): they
+  // only copy the input into the inboxes of the rovers and never wait for
+  // a rover being processed; in the blocking mode the sender processes the
+  // input itself
+  // ------------------------------------------------------------------------
+  Qt::ConnectionType conType = Qt::DirectConnection;
+
+  connect(BNC_CORE->caster(), SIGNAL(newObs(QByteArray, QList<t_satObs>)),
+          this, SLOT(slotNewObs(QByteArray, QList<t_satObs>)),conType);
+
+  connect(BNC_CORE, SIGNAL(newGPSEph(t_ephGPS)),
+          this, SLOT(slotNewGPSEph(t_ephGPS)),conType);
+
+  connect(BNC_CORE, SIGNAL(newGlonassEph(t_ephGlo)),
+          this, SLOT(slotNewGlonassEph(t_ephGlo)),conType);
+
+  connect(BNC_CORE, SIGNAL(newGalileoEph(t_ephGal)),
+          this, SLOT(slotNewGalileoEph(t_ephGal)),conType);
+
+  connect(BNC_CORE, SIGNAL(newBDSEph(t_ephBDS)),
+          this, SLOT(slotNewBDSEph(t_ephBDS)),conType);
+
+  connect(BNC_CORE, SIGNAL(newTec(t_vTec)),
+          this, SLOT(slotNewTec(t_vTec)),conType);
+
+  connect(BNC_CORE, SIGNAL(newOrbCorrections(QList<t_orbCorr>)),
+          this, SLOT(slotNewOrbCorrections(QList<t_orbCorr>)),conType);
+
+  connect(BNC_CORE, SIGNAL(newClkCorrections(QList<t_clkCorr>)),
+          this, SLOT(slotNewClkCorrections(QList<t_clkCorr>)),conType);
+
+  connect(BNC_CORE, SIGNAL(newCodeBiases(QList<t_satCodeBias>)),
+          this, SLOT(slotNewCodeBiases(QList<t_satCodeBias>)),conType);
+
+  connect(BNC_CORE, SIGNAL(newPhaseBiases(QList<t_satPhaseBias>)),
+          this, SLOT(slotNewPhaseBiases(QList<t_satPhaseBias>)),conType);
+
+  connect(BNC_CMB, SIGNAL(newOrbCorrections(QList<t_orbCorr>)),
+          this, SLOT(slotNewOrbCorrections(QList<t_orbCorr>)),conType);
+
+  connect(BNC_CMB, SIGNAL(newClkCorrections(QList<t_clkCorr>)),
+          this, SLOT(slotNewClkCorrections(QList<t_clkCorr>)),conType);
+
+  connect(BNC_CORE, SIGNAL(providerIDChanged(QString)),
+          this, SLOT(slotProviderIDChanged(QString)),conType);
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+t_pppDispatcher::~t_pppDispatcher() {
+
+  // No new input, wait for the slots still running in other threads
+  // ----------------------------------------------------------------
+  if (BNC_CORE->caster()) {
+    BNC_CORE->caster()->disconnect(this);
+  }
+  BNC_CORE->disconnect(this);
+  BNC_CMB->disconnect(this);
+  delete _epoTimer;
+  QWriteLocker locker(&_lock);
+
+  _pool.waitForDone();
+  QListIterator<t_rover*> it(_rovers);
+  while (it.hasNext()) {
+    delete it.next();
+  }
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+t_pppDispatcher::t_rover::t_rover(const QByteArray& staID, t_pppRun* pppRun) {
+  _staID           = staID;
+  _pppRun          = pppRun;
+  _numObs          = 0;
+  _scheduled       = false;
+  _epoTimerPending = false;
+  setAutoDelete(false);
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+t_pppDispatcher::t_rover::~t_rover() {
+  delete _pppRun;
+}
+
+// Process the inbox of one rover (in a pool thread)
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::t_rover::run() {
+  while (true) {
+    t_input input(t_input::obs);
+    {
+      QMutexLocker locker(&_mutex);
+      if (_inbox.isEmpty()) {
+        _scheduled = false;
+        return;
+      }
+      input = _inbox.dequeue();
+      if (input._type == t_input::obs) {
+        --_numObs;
+      }
+      else if (input._type == t_input::epoTimer) {
+        _epoTimerPending = false;
+      }
+    }
+    process(input);
+  }
+}
+
+// Pass one input to the rover
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::t_rover::process(const t_input& input) {
+  switch (input._type) {
+    case t_input::obs:
+      _pppRun->slotNewObs(_staID, input._obs);
+      break;
+    case t_input::eph:
+      _pppRun->putEphemeris(input._eph.data());
+      break;
+    case t_input::tec:
+      _pppRun->slotNewTec(*input._tec);
+      break;
+    case t_input::orbCorr:
+      _pppRun->slotNewOrbCorrections(*input._orbCorr);
+      break;
+    case t_input::clkCorr:
+      _pppRun->slotNewClkCorrections(*input._clkCorr);
+      break;
+    case t_input::codeBias:
+      _pppRun->slotNewCodeBiases(*input._codeBias);
+      break;
+    case t_input::phaseBias:
+      _pppRun->slotNewPhaseBiases(*input._phaseBias);
+      break;
+    case t_input::providerID:
+      _pppRun->slotProviderIDChanged(input._mountPoint);
+      break;
+    case t_input::epoTimer:
+      _pppRun->checkEpochs();
+      break;
+  }
+}
+
+// Put an input into the inbox of a rover and schedule the rover (locked)
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::post(t_rover* rover, const t_input& input) {
+
+  if (_blocking) {
+    rover->process(input);
+    return;
+  }
+
+  QMutexLocker lockerRover(&rover->_mutex);
+  rover->_inbox.enqueue(input);
+
+  // Too many epochs waiting - the oldest observations are dropped
+  // -------------------------------------------------------------
+  if (input._type == t_input::obs && ++rover->_numObs > _maxInbox) {
+    for (int ii = 0; ii < rover->_inbox.size(); ii++) {
+      if (rover->_inbox[ii]._type == t_input::obs) {
+        rover->_inbox.removeAt(ii);
+        --rover->_numObs;
+        break;
+      }
+    }
+  }
+
+  if (!rover->_scheduled) {
+    rover->_scheduled = true;
+    _pool.start(rover);
+  }
+}
+
+// Put an input into the inboxes of all rovers (locked)
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::post(const t_input& input) {
+  for (int ii = 0; ii < _rovers.size(); ii++) {
+    post(_rovers[ii], input);
+  }
+}
+
+// New Observations - route to the rover(s) of this station
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewObs(QByteArray staID, QList<t_satObs> obsList) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::obs);
+  input._obs = obsList;
+  QHash<QByteArray, t_rover*>::const_iterator it = _roverByStaID.constFind(staID);
+  while (it != _roverByStaID.constEnd() && it.key() == staID) {
+    post(it.value(), input);
+    ++it;
+  }
+}
+
+// Ephemerides and corrections are passed to all rovers
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewGPSEph(t_ephGPS eph) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::eph);
+  input._eph = QSharedPointer<const t_eph>(new t_ephGPS(eph));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewGlonassEph(t_ephGlo eph) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::eph);
+  input._eph = QSharedPointer<const t_eph>(new t_ephGlo(eph));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewGalileoEph(t_ephGal eph) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::eph);
+  input._eph = QSharedPointer<const t_eph>(new t_ephGal(eph));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewBDSEph(t_ephBDS eph) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::eph);
+  input._eph = QSharedPointer<const t_eph>(new t_ephBDS(eph));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewTec(t_vTec vTec) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::tec);
+  input._tec = QSharedPointer<const t_vTec>(new t_vTec(vTec));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewOrbCorrections(QList<t_orbCorr> orbCorr) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::orbCorr);
+  input._orbCorr = QSharedPointer<const QList<t_orbCorr> >(new QList<t_orbCorr>(orbCorr));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewClkCorrections(QList<t_clkCorr> clkCorr) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::clkCorr);
+  input._clkCorr = QSharedPointer<const QList<t_clkCorr> >(new QList<t_clkCorr>(clkCorr));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewCodeBiases(QList<t_satCodeBias> codeBiases) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::codeBias);
+  input._codeBias = QSharedPointer<const QList<t_satCodeBias> >(new QList<t_satCodeBias>(codeBiases));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotNewPhaseBiases(QList<t_satPhaseBias> phaseBiases) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::phaseBias);
+  input._phaseBias = QSharedPointer<const QList<t_satPhaseBias> >(new QList<t_satPhaseBias>(phaseBiases));
+  post(input);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotProviderIDChanged(QString mountPoint) {
+  QReadLocker locker(&_lock);
+  t_input input(t_input::providerID);
+  input._mountPoint = mountPoint;
+  post(input);
+}
+
+// Wake up the rovers to release waiting epochs (main thread)
+////////////////////////////////////////////////////////////////////////////
+void t_pppDispatcher::slotEpoTimer() {
+  t_input input(t_input::epoTimer);
+  for (int ii = 0; ii < _rovers.size(); ii++) {
+    t_rover* rover = _rovers[ii];
+    {
+      QMutexLocker lockerRover(&rover->_mutex);
+      if (rover->_epoTimerPending) {
+        continue;
+      }
+      rover->_epoTimerPending = true;
+    }
+    post(rover, input);
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef PPPDISPATCHER_H
+#define PPPDISPATCHER_H
+
+#include <QtCore>
+
+#include "satObs.h"
+#include "pppOptions.h"
+#include "pppRun.h"
+
+namespace BNC_PPP {
+
+// Real-time PPP for many rovers: the input signals are received once (in
+// the thread of the sender) and only copied into the inboxes of the rovers,
+// observations are routed by station name to the owning rover; the rovers
+// process their inboxes on a thread pool
+////////////////////////////////////////////////////////////////////////////
+class t_pppDispatcher : public QObject {
+ Q_OBJECT
+ public:
+  t_pppDispatcher(const QList<t_pppOptions*>& options);
+  ~t_pppDispatcher();
+
+ signals:
+  void newMessage(QByteArray msg, bool showOnScreen);
+
+ public slots:
+  void slotNewGPSEph(t_ephGPS);
+  void slotNewGlonassEph(t_ephGlo);
+  void slotNewGalileoEph(t_ephGal);
+  void slotNewBDSEph(t_ephBDS);
+  void slotNewTec(t_vTec);
+  void slotNewOrbCorrections(QList<t_orbCorr> orbCorr);
+  void slotNewClkCorrections(QList<t_clkCorr> clkCorr);
+  void slotNewCodeBiases(QList<t_satCodeBias> codeBiases);
+  void slotNewPhaseBiases(QList<t_satPhaseBias> phaseBiases);
+  void slotNewObs(QByteArray staID, QList<t_satObs> obsList);
+  void slotProviderIDChanged(QString mountPoint);
+
+ private slots:
+  void slotEpoTimer();
+
+ private:
+  // Input of a rover, ephemerides and corrections are shared by all rovers
+  class t_input {
+   public:
+    enum e_type {obs, eph, tec, orbCorr, clkCorr, codeBias, phaseBias, providerID,
+                 epoTimer};
+    t_input(e_type type) : _type(type) {}
+    e_type                           _type;
+    QList<t_satObs>                  _obs;
+    QSharedPointer<const t_eph>      _eph;
+    QSharedPointer<const t_vTec>     _tec;
+    QSharedPointer<const QList<t_orbCorr> >      _orbCorr;
+    QSharedPointer<const QList<t_clkCorr> >      _clkCorr;
+    QSharedPointer<const QList<t_satCodeBias> >  _codeBias;
+    QSharedPointer<const QList<t_satPhaseBias> > _phaseBias;
+    QString                          _mountPoint;
+  };
+
+  class t_rover : public QRunnable {
+   public:
+    t_rover(const QByteArray& staID, t_pppRun* pppRun);
+    ~t_rover();
+    virtual void run();
+    void process(const t_input& input);
+    QByteArray                _staID;
+    t_pppRun*                 _pppRun;
+    QMutex                    _mutex;      // guards the inbox only
+    QQueue<t_input>           _inbox;
+    int                       _numObs;     // observation inputs in the inbox
+    bool                      _scheduled;
+    bool                      _epoTimerPending;
+  };
+
+  void post(const t_input& input);
+  void post(t_rover* rover, const t_input& input);
+
+  static const int               _maxInbox = 120;  // observation inputs
+  static const int               _epoTimerInt = 100;  // check of waiting epochs [ms]
+  QReadWriteLock                 _lock;  // slots running vs. destructor
+  QThreadPool                    _pool;
+  QList<t_rover*>                _rovers;
+  QHash<QByteArray, t_rover*>    _roverByStaID;
+  bool                           _blocking;
+  QTimer*                        _epoTimer;
+};
+
+}
+
+#endif
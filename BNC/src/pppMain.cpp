@@ -44,6 +44,7 @@
 #include "pppMain.h"
 #include "pppCrdFile.h"
 #include "bncsettings.h"
+#include "bncsatcache.h"
 
 using namespace BNC_PPP;
 using namespace std;
@@ -51,7 +52,9 @@ using namespace std;
 // Constructor
 //////////////////////////////////////////////////////////////////////////////
 t_pppMain::t_pppMain() {
-  _running = false;
+  _running    = false;
+  _dispatcher = 0;
+  _batch      = 0;
 }
 
 // Destructor
@@ -74,6 +77,27 @@ void t_pppMain::start() {
   try {
     readOptions();
 
+    // Real-time rovers share one dispatcher and its thread pool
+    // ---------------------------------------------------------
+    if (_realTime) {
+      if (!_options.isEmpty()) {
+        _dispatcher = new t_pppDispatcher(_options);
+        _running = true;
+      }
+      return;
+    }
+
+    // Batch post-processing of the RINEX files on a thread pool
+    // ---------------------------------------------------------
+    if (BNC_CORE->mode() == t_bncCore::batchPostProcessing) {
+      if (!_options.isEmpty()) {
+        _batch = new t_pppBatch(_options);
+        _batch->start();
+        _running = true;
+      }
+      return;
+    }
+
     QListIterator<t_pppOptions*> iOpt(_options);
     while (iOpt.hasNext()) {
       const t_pppOptions* opt = iOpt.next();
@@ -84,6 +108,7 @@ void t_pppMain::start() {
     }
   }
   catch (t_except exc) {
+    BNC_CORE->slotMessage(QByteArray(exc.what().c_str()), true);
     _running = true;
     stop();
   }
@@ -97,22 +122,15 @@ void t_pppMain::stop() {
     return;
   }
 
-  if (_realTime) {
-    QListIterator<t_pppThread*> it(_pppThreads);
-    while (it.hasNext()) {
-      t_pppThread* pppThread = it.next();
-      pppThread->exit();
-#ifdef BNC_DEBUG
-      if (BNC_CORE->mode() != t_bncCore::interactive) {
-        while(!pppThread->isFinished()) {
-          pppThread->wait();
-        }
-        delete pppThread;
-      }
-#endif
-    }
-    _pppThreads.clear();
-  }
+  delete _dispatcher;
+  _dispatcher = 0;
+
+  delete _batch;
+  _batch = 0;
+
+  bncSatCache* satCache = bncSatCache::instance();
+  BNC_CORE->slotMessage(QString("PPP satellite cache: %1 hits, %2 misses")
+                        .arg(satCache->numHits()).arg(satCache->numMisses()).toLatin1(), false);
 
   _running = false;
 }
@@ -140,6 +158,21 @@ void t_pppMain::readOptions() {
     return;
   }
 
+  // Several RINEX files (comma separated) define the jobs of a batch run
+  // --------------------------------------------------------------------
+  QStringList obsFiles  = settings.value("PPP/rinexObs").toString().split(",", QString::SkipEmptyParts);
+  QStringList navFiles  = settings.value("PPP/rinexNav").toString().split(",", QString::SkipEmptyParts);
+  QStringList corrFiles = settings.value("PPP/corrFile").toString().split(",", QString::SkipEmptyParts);
+
+  if (obsFiles.size() > 1) {
+    if (navFiles.size() > 1 && navFiles.size() != obsFiles.size()) {
+      throw t_except("pppMain: number of RINEX navigation files does not match the observation files");
+    }
+    if (corrFiles.size() > 1 && corrFiles.size() != obsFiles.size()) {
+      throw t_except("pppMain: number of correction files does not match the observation files");
+    }
+  }
+
   QListIterator<QString> iSta(settings.value("PPP/staTable").toStringList());
   while (iSta.hasNext()) {
     QStringList hlp = iSta.next().split(",");
@@ -393,12 +426,44 @@ void t_pppMain::readOptions() {
     opt->_eleWgtPhase = (settings.value("PPP/eleWgtPhase").toInt() != 0);
     opt->_seedingTime = settings.value("PPP/seedingTime").toDouble();
 
+    // The filter report is only formatted if written into the PPP log file
+    // --------------------------------------------------------------------
+    opt->_logLevel    = settings.value("PPP/logPath").toString().isEmpty() ? 0 : 1;
+
     // Some default values
     // -------------------
     opt->_aprSigAmb   = 1000.0;
     opt->_noiseClk    = 1000.0;
 
-    _options << opt;
+    // One job per observation file of the rover (name starting with the rover ID)
+    // ---------------------------------------------------------------------------
+    if (!_realTime && obsFiles.size() > 1) {
+      QString ID4 = QString(opt->_roverName.c_str()).left(4);
+      int numFiles = 0;
+      for (int iFile = 0; iFile < obsFiles.size(); iFile++) {
+        QString obsFile = obsFiles[iFile].trimmed();
+        if (!QFileInfo(obsFile).fileName().startsWith(ID4, Qt::CaseInsensitive)) {
+          continue;
+        }
+        QString navFile  = (navFiles.size()  > 1) ? navFiles[iFile]  : navFiles.value(0);
+        QString corrFile = (corrFiles.size() > 1) ? corrFiles[iFile] : corrFiles.value(0);
+        t_pppOptions* optFile = new t_pppOptions(*opt);
+        optFile->_rinexObs.assign(obsFile.toStdString());
+        optFile->_rinexNav.assign(navFile.trimmed().toStdString());
+        optFile->_corrFile.assign(corrFile.trimmed().toStdString());
+        _options << optFile;
+        ++numFiles;
+      }
+      if (numFiles == 0) {
+        string msg = "pppMain: no RINEX observation file for rover " + opt->_roverName;
+        delete opt;
+        throw t_except(msg.c_str());
+      }
+      delete opt;
+    }
+    else {
+      _options << opt;
+    }
   }
 }
 
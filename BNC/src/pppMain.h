@@ -4,6 +4,8 @@
 #include <QtCore>
 #include "pppOptions.h"
 #include "pppThread.h"
+#include "pppDispatcher.h"
+#include "pppBatch.h"
 #include "bnccore.h"
 
 namespace BNC_PPP {
@@ -20,6 +22,8 @@ class t_pppMain {
 
   QList<t_pppOptions*> _options;
   QList<t_pppThread*>  _pppThreads;
+  t_pppDispatcher*     _dispatcher;
+  t_pppBatch*          _batch;
   bool     _running;
   bool     _realTime;
 };
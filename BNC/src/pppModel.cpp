@@ -41,8 +41,10 @@
 
 
 #include <cmath>
+#include <cstring>
 
 #include "pppModel.h"
+#include "bncbincache.h"
 
 using namespace BNC_PPP;
 using namespace std;
@@ -51,6 +53,11 @@ const double t_astro::RHO_DEG   = 180.0 / M_PI;
 const double t_astro::RHO_SEC   = 3600.0 * 180.0 / M_PI;
 const double t_astro::MJD_J2000 = 51544.5;
 
+QMutex       t_astro::_mutex;
+t_astroState t_astro::_states[t_astro::_maxStates];
+int          t_astro::_numStates = 0;
+int          t_astro::_nextState = 0;
+
 Matrix t_astro::rotX(double Angle) {
   const double C = cos(Angle);
   const double S = sin(Angle);
@@ -81,6 +88,45 @@ Matrix t_astro::rotZ(double Angle) {
   return UU;
 }
 
+// 3x3 rotation about the axis iAxis (0,1,2 = x,y,z), fixed-size storage
+///////////////////////////////////////////////////////////////////////////
+static void rot3(int iAxis, double Angle, double RR[3][3]) {
+  const double C = cos(Angle);
+  const double S = sin(Angle);
+  int i1 = (iAxis + 1) % 3;
+  int i2 = (iAxis + 2) % 3;
+  for (int ii = 0; ii < 3; ii++) {
+    for (int jj = 0; jj < 3; jj++) {
+      RR[ii][jj] = 0.0;
+    }
+  }
+  RR[iAxis][iAxis] = 1.0;
+  RR[i1][i1] = +C;  RR[i1][i2] = +S;
+  RR[i2][i1] = -S;  RR[i2][i2] = +C;
+}
+
+// CC = AA * BB (CC may be identical with AA or BB)
+///////////////////////////////////////////////////////////////////////////
+static void mult3(const double AA[3][3], const double BB[3][3], double CC[3][3]) {
+  double HH[3][3];
+  for (int ii = 0; ii < 3; ii++) {
+    for (int jj = 0; jj < 3; jj++) {
+      HH[ii][jj] = AA[ii][0] * BB[0][jj] + AA[ii][1] * BB[1][jj] + AA[ii][2] * BB[2][jj];
+    }
+  }
+  memcpy(CC, HH, sizeof(HH));
+}
+
+// yy = RR * xx (yy may be identical with xx)
+///////////////////////////////////////////////////////////////////////////
+static void mult3(const double RR[3][3], const double* xx, double* yy) {
+  double hh[3];
+  for (int ii = 0; ii < 3; ii++) {
+    hh[ii] = RR[ii][0] * xx[0] + RR[ii][1] * xx[1] + RR[ii][2] * xx[2];
+  }
+  yy[0] = hh[0]; yy[1] = hh[1]; yy[2] = hh[2];
+}
+
 // Greenwich Mean Sidereal Time
 ///////////////////////////////////////////////////////////////////////////
 double t_astro::GMST(double Mjd_UT1) {
@@ -100,7 +146,7 @@ double t_astro::GMST(double Mjd_UT1) {
 
 // Nutation Matrix
 ///////////////////////////////////////////////////////////////////////////
-Matrix t_astro::NutMatrix(double Mjd_TT) {
+void t_astro::NutMatrix(double Mjd_TT, double NN[3][3]) {
 
   const double T  = (Mjd_TT-MJD_J2000)/36525.0;
 
@@ -116,12 +162,15 @@ Matrix t_astro::NutMatrix(double Mjd_TT) {
 
   double eps  = 0.4090928-2.2696E-4*T;
 
-  return  rotX(-eps-deps)*rotZ(-dpsi)*rotX(+eps);
+  double RR[3][3];
+  rot3(0, -eps-deps, NN);
+  rot3(2, -dpsi,     RR);  mult3(NN, RR, NN);
+  rot3(0, +eps,      RR);  mult3(NN, RR, NN);
 }
 
 // Precession Matrix
 ///////////////////////////////////////////////////////////////////////////
-Matrix t_astro::PrecMatrix(double Mjd_1, double Mjd_2) {
+void t_astro::PrecMatrix(double Mjd_1, double Mjd_2, double PP[3][3]) {
 
   const double T  = (Mjd_1-MJD_J2000)/36525.0;
   const double dT = (Mjd_2-Mjd_1)/36525.0;
@@ -132,37 +181,49 @@ Matrix t_astro::PrecMatrix(double Mjd_1, double Mjd_2) {
   double theta =  ( (2004.3109-(0.85330+0.000217*T)*T)-
                         ((0.42665+0.000217*T)+0.041833*dT)*dT )*dT/RHO_SEC;
 
-  return rotZ(-z) * rotY(theta) * rotZ(-zeta);
+  double RR[3][3];
+  rot3(2, -z,     PP);
+  rot3(1, theta,  RR);  mult3(PP, RR, PP);
+  rot3(2, -zeta,  RR);  mult3(PP, RR, PP);
 }
 
-// Sun's position
+// Ecliptic (mean equinox J2000) to Earth-fixed coordinates
 ///////////////////////////////////////////////////////////////////////////
-ColumnVector t_astro::Sun(double Mjd_TT) {
-
+void t_astro::toECEF(const t_astroState& astroState, const double* xx,
+                     double* xEcef) {
   const double eps = 23.43929111/RHO_DEG;
-  const double T   = (Mjd_TT-MJD_J2000)/36525.0;
+  double RR[3][3];
+  rot3(0, -eps, RR);
+  mult3(RR, xx, xEcef);
+  mult3(astroState._prec, xEcef, xEcef);
+  mult3(astroState._nut,  xEcef, xEcef);
+  rot3(2, astroState._gmst, RR);
+  mult3(RR, xEcef, xEcef);
+}
+
+// Sun and Moon positions, sidereal time, nutation and precession
+///////////////////////////////////////////////////////////////////////////
+void t_astro::computeState(double Mjd_TT, t_astroState& astroState) {
+
+  const double T = (Mjd_TT-MJD_J2000)/36525.0;
 
+  astroState._mjd  = Mjd_TT;
+  astroState._gmst = GMST(Mjd_TT);
+  NutMatrix(Mjd_TT, astroState._nut);
+  PrecMatrix(MJD_J2000, Mjd_TT, astroState._prec);
+
+  // Sun's position
+  // --------------
   double M = 2.0*M_PI * Frac ( 0.9931267 + 99.9973583*T);
   double L = 2.0*M_PI * Frac ( 0.7859444 + M/2.0/M_PI +
                         (6892.0*sin(M)+72.0*sin(2.0*M)) / 1296.0e3);
   double r = 149.619e9 - 2.499e9*cos(M) - 0.021e9*cos(2*M);
 
-  ColumnVector r_Sun(3);
-  r_Sun << r*cos(L) << r*sin(L) << 0.0; r_Sun = rotX(-eps) * r_Sun;
-
-  return    rotZ(GMST(Mjd_TT))
-          * NutMatrix(Mjd_TT)
-          * PrecMatrix(MJD_J2000, Mjd_TT)
-          * r_Sun;
-}
-
-// Moon's position
-///////////////////////////////////////////////////////////////////////////
-ColumnVector t_astro::Moon(double Mjd_TT) {
-
-  const double eps = 23.43929111/RHO_DEG;
-  const double T   = (Mjd_TT-MJD_J2000)/36525.0;
+  double r_Sun[3] = {r*cos(L), r*sin(L), 0.0};
+  toECEF(astroState, r_Sun, astroState._xSun);
 
+  // Moon's position
+  // ---------------
   double L_0 = Frac ( 0.606433 + 1336.851344*T );
   double l   = 2.0*M_PI*Frac ( 0.374897 + 1325.552410*T );
   double lp  = 2.0*M_PI*Frac ( 0.993133 +   99.997361*T );
@@ -174,7 +235,7 @@ ColumnVector t_astro::Moon(double Mjd_TT) {
               +192*sin(l+2*D) - 165*sin(lp-2*D) - 125*sin(D) - 110*sin(l+lp)
               +148*sin(l-lp) - 55*sin(2*F-2*D);
 
-  double L = 2.0*M_PI * Frac( L_0 + dL/1296.0e3 );
+  L = 2.0*M_PI * Frac( L_0 + dL/1296.0e3 );
 
   double S  = F + (dL+412*sin(2*F)+541*sin(lp)) / RHO_SEC;
   double h  = F-2*D;
@@ -189,39 +250,90 @@ ColumnVector t_astro::Moon(double Mjd_TT) {
       -570e3*cos(2*l) + 246e3*cos(2*l-2*D) - 205e3*cos(lp-2*D)
       -171e3*cos(l+2*D) - 152e3*cos(l+lp-2*D);
 
-  ColumnVector r_Moon(3);
-  r_Moon << R*cos(L)*cosB << R*sin(L)*cosB << R*sin(B);
-  r_Moon = rotX(-eps) * r_Moon;
+  double r_Moon[3] = {R*cos(L)*cosB, R*sin(L)*cosB, R*sin(B)};
+  toECEF(astroState, r_Moon, astroState._xMoon);
+
+  // Unit vectors and distances
+  // --------------------------
+  astroState._rSun  = sqrt(astroState._xSun[0]  * astroState._xSun[0]  +
+                           astroState._xSun[1]  * astroState._xSun[1]  +
+                           astroState._xSun[2]  * astroState._xSun[2]);
+  astroState._rMoon = sqrt(astroState._xMoon[0] * astroState._xMoon[0] +
+                           astroState._xMoon[1] * astroState._xMoon[1] +
+                           astroState._xMoon[2] * astroState._xMoon[2]);
+  for (int ii = 0; ii < 3; ii++) {
+    astroState._xSun[ii]  /= astroState._rSun;
+    astroState._xMoon[ii] /= astroState._rMoon;
+  }
+}
+
+// Astronomical state of an epoch - computed once for all PPP instances
+///////////////////////////////////////////////////////////////////////////
+void t_astro::state(double Mjd_TT, t_astroState& astroState) {
+
+  {
+    QMutexLocker locker(&_mutex);
+    for (int ii = 0; ii < _numStates; ii++) {
+      if (_states[ii]._mjd == Mjd_TT) {
+        astroState = _states[ii];
+        return;
+      }
+    }
+  }
+
+  // Computed outside the lock; two threads may compute the same epoch
+  // -----------------------------------------------------------------
+  computeState(Mjd_TT, astroState);
 
-  return    rotZ(GMST(Mjd_TT))
-          * NutMatrix(Mjd_TT)
-          * PrecMatrix(MJD_J2000, Mjd_TT)
-          * r_Moon;
+  QMutexLocker locker(&_mutex);
+  _states[_nextState] = astroState;
+  _nextState = (_nextState + 1) % _maxStates;
+  if (_numStates < _maxStates) {
+    ++_numStates;
+  }
+}
+
+// Sun's position
+///////////////////////////////////////////////////////////////////////////
+ColumnVector t_astro::Sun(double Mjd_TT) {
+  t_astroState astroState;
+  state(Mjd_TT, astroState);
+  ColumnVector r_Sun(3);
+  for (int ii = 0; ii < 3; ii++) {
+    r_Sun[ii] = astroState._rSun * astroState._xSun[ii];
+  }
+  return r_Sun;
+}
+
+// Moon's position
+///////////////////////////////////////////////////////////////////////////
+ColumnVector t_astro::Moon(double Mjd_TT) {
+  t_astroState astroState;
+  state(Mjd_TT, astroState);
+  ColumnVector r_Moon(3);
+  for (int ii = 0; ii < 3; ii++) {
+    r_Moon[ii] = astroState._rMoon * astroState._xMoon[ii];
+  }
+  return r_Moon;
 }
 
 // Tidal Correction
 ////////////////////////////////////////////////////////////////////////////
 ColumnVector t_tides::displacement(const bncTime& time, const ColumnVector& xyz) {
 
+  ColumnVector dX(3); dX = 0.0;
+
   if (time.undef()) {
-    ColumnVector dX(3); dX = 0.0;
     return dX;
   }
 
   double Mjd = time.mjd() + time.daysec() / 86400.0;
 
-  if (Mjd != _lastMjd) {
-    _lastMjd = Mjd;
-    _xSun = t_astro::Sun(Mjd);
-    _rSun = sqrt(DotProduct(_xSun,_xSun));
-    _xSun /= _rSun;
-    _xMoon = t_astro::Moon(Mjd);
-    _rMoon = sqrt(DotProduct(_xMoon,_xMoon));
-    _xMoon /= _rMoon;
-  }
+  t_astroState astro;
+  t_astro::state(Mjd, astro);
 
-  double       rRec    = sqrt(DotProduct(xyz, xyz));
-  ColumnVector xyzUnit = xyz / rRec;
+  double rRec       = sqrt(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]);
+  double xyzUnit[3] = {xyz[0] / rRec, xyz[1] / rRec, xyz[2] / rRec};
 
   // Love's Numbers
   // --------------
@@ -230,8 +342,10 @@ ColumnVector t_tides::displacement(const bncTime& time, const ColumnVector& xyz)
 
   // Tidal Displacement
   // ------------------
-  double scSun  = DotProduct(xyzUnit, _xSun);
-  double scMoon = DotProduct(xyzUnit, _xMoon);
+  double scSun  = xyzUnit[0] * astro._xSun[0]  + xyzUnit[1] * astro._xSun[1]  +
+                  xyzUnit[2] * astro._xSun[2];
+  double scMoon = xyzUnit[0] * astro._xMoon[0] + xyzUnit[1] * astro._xMoon[1] +
+                  xyzUnit[2] * astro._xMoon[2];
 
   double p2Sun  = 3.0 * (H2/2.0-L2) * scSun  * scSun  - H2/2.0;
   double p2Moon = 3.0 * (H2/2.0-L2) * scMoon * scMoon - H2/2.0;
@@ -244,13 +358,15 @@ ColumnVector t_tides::displacement(const bncTime& time, const ColumnVector& xyz)
   const double gmm   = 4.9027890e12;
 
   double facSun  = gms / gmWGS *
-                   (rRec * rRec * rRec * rRec) / (_rSun * _rSun * _rSun);
+                   (rRec * rRec * rRec * rRec) / (astro._rSun * astro._rSun * astro._rSun);
 
   double facMoon = gmm / gmWGS *
-                   (rRec * rRec * rRec * rRec) / (_rMoon * _rMoon * _rMoon);
+                   (rRec * rRec * rRec * rRec) / (astro._rMoon * astro._rMoon * astro._rMoon);
 
-  ColumnVector dX = facSun  * (x2Sun  * _xSun  + p2Sun  * xyzUnit) +
-                    facMoon * (x2Moon * _xMoon + p2Moon * xyzUnit);
+  for (int ii = 0; ii < 3; ii++) {
+    dX[ii] = facSun  * (x2Sun  * astro._xSun[ii]  + p2Sun  * xyzUnit[ii]) +
+             facMoon * (x2Moon * astro._xMoon[ii] + p2Moon * xyzUnit[ii]);
+  }
 
   return dX;
 }
@@ -278,6 +394,17 @@ t_loading::~t_loading() {
 }
 
 t_irc t_loading::readFile(const QString& fileName) {
+
+  // Binary cache of the parsed file
+  // -------------------------------
+  bncBinCache  cache(fileName, "blq", 1);
+  QDataStream* cacheIn = cache.in();
+  if (cacheIn && readCache(*cacheIn) == success) {
+    return success;
+  }
+
+  QStringList sites;
+
   QFile inFile(fileName);
   inFile.open(QIODevice::ReadOnly | QIODevice::Text);
   QTextStream in(&inFile);
@@ -318,7 +445,11 @@ t_irc t_loading::readFile(const QString& fileName) {
         break;
       case 7:
         if (newBlqData && !site.isEmpty()) {
+          if (blqMap.contains(site)) {
+            delete blqMap[site];
+          }
           blqMap[site] = newBlqData;
+          sites << site;
           site = QString();
           row = -1;
           newBlqData = 0;
@@ -328,6 +459,67 @@ t_irc t_loading::readFile(const QString& fileName) {
     row++;
   }
   inFile.close();
+
+  QByteArray payload;
+  QDataStream out(&payload, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_0);
+  sites.removeDuplicates();
+  writeCache(out, sites);
+  cache.save(payload);
+
+  return success;
+}
+
+// Write the sites read from one file into the binary cache
+////////////////////////////////////////////////////////////////////////////
+void t_loading::writeCache(QDataStream& out, const QStringList& sites) const {
+  out << quint32(sites.size());
+  for (int iSite = 0; iSite < sites.size(); iSite++) {
+    const t_blqData* blq = blqMap[sites[iSite]];
+    out << sites[iSite];
+    for (int rr = 0; rr < 3; rr++) {
+      for (int cc = 0; cc < 11; cc++) {
+        out << blq->amplitudes[rr][cc] << blq->phases[rr][cc];
+      }
+    }
+  }
+}
+
+// Read the sites from the binary cache
+////////////////////////////////////////////////////////////////////////////
+t_irc t_loading::readCache(QDataStream& in) {
+
+  QList<QPair<QString, t_blqData*> > newData;
+  quint32 nSite = 0;
+  in >> nSite;
+  for (quint32 iSite = 0; iSite < nSite && in.status() == QDataStream::Ok; iSite++) {
+    t_blqData* blq = new t_blqData;
+    blq->amplitudes.ReSize(3,11);
+    blq->phases.ReSize(3,11);
+    QString site;
+    in >> site;
+    for (int rr = 0; rr < 3; rr++) {
+      for (int cc = 0; cc < 11; cc++) {
+        in >> blq->amplitudes[rr][cc] >> blq->phases[rr][cc];
+      }
+    }
+    newData << qMakePair(site, blq);
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    for (int ii = 0; ii < newData.size(); ii++) {
+      delete newData[ii].second;
+    }
+    return failure;
+  }
+
+  for (int ii = 0; ii < newData.size(); ii++) {
+    if (blqMap.contains(newData[ii].first)) {
+      delete blqMap[newData[ii].first];
+    }
+    blqMap[newData[ii].first] = newData[ii].second;
+  }
+
   return success;
 }
 
@@ -487,6 +679,8 @@ double t_tropo::delay_saast(const ColumnVector& xyz, double Ele) {
 ///////////////////////////////////////////////////////////////////////////
 t_iono::t_iono() {
   _psiPP = _phiPP = _lambdaPP = _lonS = 0.0;
+  _vTec  = 0;
+  _maxN  = -1;
 }
 
 t_iono::~t_iono() {}
@@ -524,37 +718,116 @@ double t_iono::stec(const t_vTec* vTec, double signalPropagationTime,
 
   double epoch = fmod(epochTime.gpssec(), 86400.0);
 
+  update(vTec);
+
   double stec = 0.0;
-  for (unsigned ii = 0; ii < vTec->_layers.size(); ii++) {
-    piercePoint(vTec->_layers[ii]._height, epoch, geocSta.data(), sphEle, sphAzi);
-    double vtec = vtecSingleLayerContribution(vTec->_layers[ii]);
+  for (unsigned ii = 0; ii < _layers.size(); ii++) {
+    piercePoint(_layers[ii]._height, epoch, geocSta.data(), sphEle, sphAzi);
+    double vtec = vtecSingleLayerContribution(_layers[ii]);
     stec += vtec * sin(sphEle + _psiPP);
   }
   return stec;
 }
 
-double t_iono::vtecSingleLayerContribution(const t_vTecLayer& vTecLayer) {
+// Copy the coefficients of a new model into the triangular layout and
+// extend the recursion coefficients if necessary
+////////////////////////////////////////////////////////////////////////////
+void t_iono::update(const t_vTec* vTec) {
 
-  double vtec = 0.0;
-  int N = vTecLayer._C.Nrows()-1;
-  int M = vTecLayer._C.Ncols()-1;
-  double fac;
+  if (vTec == _vTec && vTec->_time == _vTecTime &&
+      vTec->_layers.size() == _layers.size()) {
+    return;
+  }
+  _vTec     = vTec;
+  _vTecTime = vTec->_time;
 
-  for (int n = 0; n <= N; n++) {
-    for (int m = 0; m <= min(n, M); m++) {
-      double pnm = associatedLegendreFunction(n, m, sin(_phiPP));
-      double a = double(factorial(n - m));
-      double b = double(factorial(n + m));
-      if (m == 0) {
-        fac = sqrt(2.0 * n + 1);
+  int maxN = 0;
+  _layers.resize(vTec->_layers.size());
+  for (unsigned ii = 0; ii < vTec->_layers.size(); ii++) {
+    const t_vTecLayer& vTecLayer = vTec->_layers[ii];
+    t_layer&           layer     = _layers[ii];
+    layer._N      = vTecLayer._C.Nrows() - 1;
+    layer._M      = vTecLayer._C.Ncols() - 1;
+    layer._height = vTecLayer._height;
+    layer._C.assign((layer._N + 1) * (layer._N + 2) / 2, 0.0);
+    layer._S.assign((layer._N + 1) * (layer._N + 2) / 2, 0.0);
+    for (int n = 0; n <= layer._N; n++) {
+      for (int m = 0; m <= min(n, layer._M); m++) {
+        layer._C[n*(n+1)/2 + m] = vTecLayer._C[n][m];
+        layer._S[n*(n+1)/2 + m] = vTecLayer._S[n][m];
       }
-      else {
-        fac = sqrt(2.0 * (2.0 * n + 1) * a / b);
+    }
+    maxN = max(maxN, layer._N);
+  }
+
+  // Recursion coefficients of the fully normalized functions
+  // ---------------------------------------------------------
+  if (maxN > _maxN) {
+    _maxN = maxN;
+    _aNM.assign((_maxN + 1) * (_maxN + 2) / 2, 0.0);
+    _bNM.assign((_maxN + 1) * (_maxN + 2) / 2, 0.0);
+    _pNM.assign((_maxN + 1) * (_maxN + 2) / 2, 0.0);
+    _cosML.assign(_maxN + 1, 0.0);
+    _sinML.assign(_maxN + 1, 0.0);
+    for (int n = 2; n <= _maxN; n++) {
+      for (int m = 0; m <= n - 2; m++) {
+        double nm = double(n - m) * (n + m);
+        _aNM[n*(n+1)/2 + m] = sqrt((2.0*n - 1) * (2.0*n + 1) / nm);
+        _bNM[n*(n+1)/2 + m] = sqrt((2.0*n + 1) * (n + m - 1) * (n - m - 1) / ((2.0*n - 3) * nm));
       }
-      pnm *= fac;
-      double Cnm_mlambda = vTecLayer._C[n][m] * cos(m * _lonS);
-      double Snm_mlambda = vTecLayer._S[n][m] * sin(m * _lonS);
-      vtec += (Snm_mlambda + Cnm_mlambda) * pnm;
+    }
+  }
+}
+
+// Fully normalized associated Legendre functions of sin(latitude) by the
+// standard column recursion; t = sin(phi), u = cos(phi)
+////////////////////////////////////////////////////////////////////////////
+void t_iono::legendre(int N, int M, double t, double u) {
+
+  double* P = &_pNM[0];
+
+  P[0] = 1.0;
+  for (int m = 0; m <= min(N, M); m++) {
+    int mm = m*(m+1)/2 + m;
+    if      (m == 1) {
+      P[mm] = sqrt(3.0) * u;
+    }
+    else if (m > 1) {
+      P[mm] = sqrt((2.0*m + 1) / (2.0*m)) * u * P[mm - m - 1];
+    }
+    if (m < N) {
+      P[mm + m + 1] = sqrt(2.0*m + 3) * t * P[mm];
+    }
+    for (int n = m + 2; n <= N; n++) {
+      int nm = n*(n+1)/2 + m;
+      P[nm] = _aNM[nm] * t * P[nm - n] - _bNM[nm] * P[nm - n - n + 1];
+    }
+  }
+}
+
+double t_iono::vtecSingleLayerContribution(const t_layer& layer) {
+
+  int N = layer._N;
+  int M = min(layer._M, N);
+
+  legendre(N, M, sin(_phiPP), cos(_phiPP));
+
+  // cos(m*lonS), sin(m*lonS) by the angle addition theorems
+  // -------------------------------------------------------
+  double cos1 = cos(_lonS);
+  double sin1 = sin(_lonS);
+  _cosML[0] = 1.0;
+  _sinML[0] = 0.0;
+  for (int m = 1; m <= M; m++) {
+    _cosML[m] = _cosML[m-1] * cos1 - _sinML[m-1] * sin1;
+    _sinML[m] = _sinML[m-1] * cos1 + _cosML[m-1] * sin1;
+  }
+
+  double vtec = 0.0;
+  for (int n = 0; n <= N; n++) {
+    int n0 = n*(n+1)/2;
+    for (int m = 0; m <= min(n, M); m++) {
+      vtec += (layer._C[n0+m] * _cosML[m] + layer._S[n0+m] * _sinML[m]) * _pNM[n0+m];
     }
   }
 
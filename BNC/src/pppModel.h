@@ -4,6 +4,7 @@
 #include <math.h>
 #include <newmat.h>
 #include <iostream>
+#include <vector>
 #include "bnctime.h"
 #include "t_prn.h"
 #include "satObs.h"
@@ -11,10 +12,26 @@
 
 namespace BNC_PPP {
 
+// Astronomical state of one epoch: Sun and Moon positions (ECEF), sidereal
+// time, nutation and precession; shared by all PPP instances
+////////////////////////////////////////////////////////////////////////////
+class t_astroState {
+ public:
+  double _mjd;          // Mjd_TT of the state
+  double _gmst;
+  double _nut[3][3];
+  double _prec[3][3];
+  double _xSun[3];      // unit vector
+  double _rSun;
+  double _xMoon[3];     // unit vector
+  double _rMoon;
+};
+
 class t_astro {
  public:
   static ColumnVector Sun(double Mjd_TT);
   static ColumnVector Moon(double Mjd_TT);
+  static void   state(double Mjd_TT, t_astroState& astroState);
   static Matrix rotX(double Angle);
   static Matrix rotY(double Angle);
   static Matrix rotZ(double Angle);
@@ -25,25 +42,24 @@ class t_astro {
   static const double MJD_J2000;
 
   static double GMST(double Mjd_UT1);
-  static Matrix NutMatrix(double Mjd_TT);
-  static Matrix PrecMatrix (double Mjd_1, double Mjd_2);
+  static void   NutMatrix(double Mjd_TT, double NN[3][3]);
+  static void   PrecMatrix(double Mjd_1, double Mjd_2, double PP[3][3]);
+  static void   toECEF(const t_astroState& astroState, const double* xx,
+                       double* xEcef);
+  static void   computeState(double Mjd_TT, t_astroState& astroState);
+
+  static const int    _maxStates = 16;   // most recent epochs kept
+  static QMutex       _mutex;
+  static t_astroState _states[_maxStates];
+  static int          _numStates;
+  static int          _nextState;
 };
 
 class t_tides {
  public:
-  t_tides() {
-    _lastMjd = 0.0;
-    _rSun    = 0.0;
-    _rMoon   = 0.0;
-  }
+  t_tides() {}
   ~t_tides() {}
   ColumnVector displacement(const bncTime& time, const ColumnVector& xyz);
- private:
-  double       _lastMjd;
-  ColumnVector _xSun;
-  ColumnVector _xMoon;
-  double       _rSun;
-  double       _rMoon;
 };
 
 class t_loading {
@@ -60,6 +76,9 @@ class t_loading {
     Matrix amplitudes;
     Matrix phases;
   };
+  void  writeCache(QDataStream& out, const QStringList& sites) const;
+  t_irc readCache(QDataStream& in);
+
   t_blqData*                 newBlqData;
   QMap <QString, t_blqData*> blqMap;
 
@@ -89,7 +108,18 @@ class t_iono {
       const ColumnVector& rSat, const bncTime& epochTime,
       const ColumnVector& xyzSta);
  private:
-  double vtecSingleLayerContribution(const t_vTecLayer& vTecLayer);
+  // Coefficients of one layer, triangular layout (index n*(n+1)/2 + m)
+  class t_layer {
+   public:
+    int                 _N;
+    int                 _M;
+    double              _height;
+    std::vector<double> _C;
+    std::vector<double> _S;
+  };
+  void   update(const t_vTec* vTec);
+  void   legendre(int N, int M, double t, double u);
+  double vtecSingleLayerContribution(const t_layer& layer);
   void piercePoint(double layerHeight, double epoch, const double* geocSta,
       double sphEle, double sphAzi);
   double _psiPP;
@@ -97,7 +127,15 @@ class t_iono {
   double _lambdaPP;
   double _lonS;
 
-
+  const t_vTec*        _vTec;       // model of the cached layers
+  bncTime              _vTecTime;
+  std::vector<t_layer> _layers;
+  int                  _maxN;       // degree of the recursion coefficients
+  std::vector<double>  _aNM;        // recursion coefficients (triangular)
+  std::vector<double>  _bNM;
+  std::vector<double>  _pNM;        // normalized Legendre functions
+  std::vector<double>  _cosML;      // cos(m * lonS)
+  std::vector<double>  _sinML;      // sin(m * lonS)
 };
 
 }
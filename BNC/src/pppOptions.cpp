@@ -51,6 +51,7 @@ t_pppOptions::t_pppOptions() {
   _neuEccRover.ReSize(3); _neuEccRover = 0.0;
   _aprSigCrd.ReSize(3);   _aprSigCrd   = 0.0;
   _noiseCrd.ReSize(3);    _noiseCrd    = 0.0;
+  _logLevel = 1;
 }
 
 // Destructor
@@ -54,6 +54,7 @@ class t_pppOptions {
   int                     _nmeaPort;
   double                  _aprSigAmb;
   double                  _seedingTime;
+  int                     _logLevel;      // 0: warnings only, 1: complete filter report
   std::vector<t_lc::type> _LCsGPS;
   std::vector<t_lc::type> _LCsGLONASS;
   std::vector<t_lc::type> _LCsGalileo;
@@ -48,6 +48,7 @@
 
 #include "pppRun.h"
 #include "pppThread.h"
+#include "pppBatch.h"
 #include "bnccore.h"
 #include "bncephuser.h"
 #include "bncsettings.h"
@@ -56,7 +57,6 @@
 #include "rinex/rnxobsfile.h"
 #include "rinex/rnxnavfile.h"
 #include "rinex/corrfile.h"
-#include "combination/bnccomb.h"
 
 using namespace BNC_PPP;
 using namespace std;
@@ -80,52 +80,9 @@ t_pppRun::t_pppRun(const t_pppOptions* opt) {
 
   bncSettings settings;
 
-  if (_opt->_realTime) {
-    Qt::ConnectionType conType = Qt::AutoConnection;
-    if (BNC_CORE->mode() == t_bncCore::batchPostProcessing) {
-      conType = Qt::BlockingQueuedConnection;
-    }
-
-    connect(BNC_CORE->caster(), SIGNAL(newObs(QByteArray, QList<t_satObs>)),
-            this, SLOT(slotNewObs(QByteArray, QList<t_satObs>)),conType);
-
-    connect(BNC_CORE, SIGNAL(newGPSEph(t_ephGPS)),
-            this, SLOT(slotNewGPSEph(t_ephGPS)),conType);
-
-    connect(BNC_CORE, SIGNAL(newGlonassEph(t_ephGlo)),
-            this, SLOT(slotNewGlonassEph(t_ephGlo)),conType);
-
-    connect(BNC_CORE, SIGNAL(newGalileoEph(t_ephGal)),
-            this, SLOT(slotNewGalileoEph(t_ephGal)),conType);
-
-    connect(BNC_CORE, SIGNAL(newBDSEph(t_ephBDS)),
-            this, SLOT(slotNewBDSEph(t_ephBDS)),conType);
-
-    connect(BNC_CORE, SIGNAL(newTec(t_vTec)),
-            this, SLOT(slotNewTec(t_vTec)),conType);
-
-    connect(BNC_CORE, SIGNAL(newOrbCorrections(QList<t_orbCorr>)),
-            this, SLOT(slotNewOrbCorrections(QList<t_orbCorr>)),conType);
-
-    connect(BNC_CORE, SIGNAL(newClkCorrections(QList<t_clkCorr>)),
-            this, SLOT(slotNewClkCorrections(QList<t_clkCorr>)),conType);
-
-    connect(BNC_CORE, SIGNAL(newCodeBiases(QList<t_satCodeBias>)),
-            this, SLOT(slotNewCodeBiases(QList<t_satCodeBias>)),conType);
-
-    connect(BNC_CORE, SIGNAL(newPhaseBiases(QList<t_satPhaseBias>)),
-            this, SLOT(slotNewPhaseBiases(QList<t_satPhaseBias>)),conType);
-
-    connect(BNC_CMB, SIGNAL(newOrbCorrections(QList<t_orbCorr>)),
-            this, SLOT(slotNewOrbCorrections(QList<t_orbCorr>)),conType);
-
-    connect(BNC_CMB, SIGNAL(newClkCorrections(QList<t_clkCorr>)),
-            this, SLOT(slotNewClkCorrections(QList<t_clkCorr>)),conType);
-
-    connect(BNC_CORE, SIGNAL(providerIDChanged(QString)),
-            this, SLOT(slotProviderIDChanged(QString)));
-  }
-  else {
+  // Real-time input is delivered by t_pppDispatcher
+  // ------------------------------------------------
+  if (!_opt->_realTime) {
     _rnxObsFile = 0;
     _rnxNavFile = 0;
     _corrFile   = 0;
@@ -139,6 +96,15 @@ t_pppRun::t_pppRun(const t_pppOptions* opt) {
 
   _stopFlag = false;
 
+  _expected.assign(t_prn::MAXPRN + 1, false);
+  _numExpected = 0;
+  _numLateObs  = 0;
+  _numLostEpo  = 0;
+
+  // Epoch summary only if shown on screen or written into the BNC log file
+  // ----------------------------------------------------------------------
+  _logSummary = BNC_CORE->GUIenabled() || !settings.value("logFile").toString().isEmpty();
+
   QString roverName(_opt->_roverName.c_str()), ID9("");
   QString country;
   QString monNum = "0";
@@ -238,38 +204,177 @@ t_pppRun::~t_pppRun() {
   delete _logFile;
   delete _nmeaFile;
   delete _snxtroFile;
-  while (!_epoData.empty()) {
-    delete _epoData.front();
-    _epoData.pop_front();
+  for (unsigned ii = 0; ii < _epoData.size(); ii++) {
+    delete _epoData[ii];
+  }
+  for (unsigned ii = 0; ii < _epoPool.size(); ii++) {
+    delete _epoPool[ii];
   }
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void t_pppRun::slotNewGPSEph(t_ephGPS eph) {
+void t_pppRun::putEphemeris(const t_eph* eph) {
   QMutexLocker locker(&_mutex);
-  _pppClient->putEphemeris(&eph);
+  _pppClient->putEphemeris(eph);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////
+void t_pppRun::slotNewGPSEph(t_ephGPS eph) {
+  putEphemeris(&eph);
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewGlonassEph(t_ephGlo eph) {
-  QMutexLocker locker(&_mutex);
-  _pppClient->putEphemeris(&eph);
+  putEphemeris(&eph);
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewGalileoEph(t_ephGal eph) {
-  QMutexLocker locker(&_mutex);
-  _pppClient->putEphemeris(&eph);
+  putEphemeris(&eph);
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewBDSEph(t_ephBDS eph) {
-  QMutexLocker locker(&_mutex);
-  _pppClient->putEphemeris(&eph);
+  putEphemeris(&eph);
+}
+
+// Epoch time in units of the time quantum (1 ms) - the hash key
+////////////////////////////////////////////////////////////////////////////
+qint64 t_pppRun::epoKey(const bncTime& tt) {
+  return qint64(tt.mjd()) * 86400000 + qRound64(tt.daysec() * 1000.0);
+}
+
+// Prepare a (pooled) epoch for new observations
+////////////////////////////////////////////////////////////////////////////
+void t_pppRun::t_epoData::reset(qint64 key, const bncTime& tt) {
+  _key  = key;
+  _time = tt;
+  _age.start();
+  _satObs.clear();
+  _seen.assign(_seen.size(), false);
+  _numSat      = 0;
+  _numExpected = 0;
+}
+
+// Copy an observation into the epoch storage, returns true if the
+// satellite is new in this epoch
+////////////////////////////////////////////////////////////////////////////
+bool t_pppRun::t_epoData::add(const t_satObs& obs) {
+
+  if (_satObs.size() == _pool.size()) {
+    _pool.push_back(new t_satObs);
+  }
+  t_satObs* satObs = _pool[_satObs.size()];
+
+  satObs->_staID = obs._staID;
+  satObs->_prn   = obs._prn;
+  satObs->_time  = obs._time;
+  while (satObs->_obs.size() > obs._obs.size()) {
+    delete satObs->_obs.back();
+    satObs->_obs.pop_back();
+  }
+  for (unsigned ii = 0; ii < obs._obs.size(); ii++) {
+    if (ii < satObs->_obs.size()) {
+      *satObs->_obs[ii] = *obs._obs[ii];
+    }
+    else {
+      satObs->_obs.push_back(new t_frqObs(*obs._obs[ii]));
+    }
+  }
+  _satObs.push_back(satObs);
+
+  unsigned iPrn = obs._prn.toInt();
+  if (iPrn < _seen.size() && !_seen[iPrn]) {
+    _seen[iPrn] = true;
+    ++_numSat;
+    return true;
+  }
+  return false;
+}
+
+// Find the epoch of the observation time or insert a new one in time
+// order; returns 0 if the epoch has already been processed
+////////////////////////////////////////////////////////////////////////////
+t_pppRun::t_epoData* t_pppRun::findEpoch(const bncTime& tt) {
+
+  qint64 key = epoKey(tt);
+
+  QHash<qint64, t_epoData*>::const_iterator it = _epoIndex.constFind(key);
+  if (it != _epoIndex.constEnd()) {
+    return it.value();
+  }
+
+  if (_lastEpoTime.valid() && key <= epoKey(_lastEpoTime)) {
+    return 0;
+  }
+
+  t_epoData* epoch = 0;
+  if (_epoPool.empty()) {
+    epoch = new t_epoData;
+  }
+  else {
+    epoch = _epoPool.back();
+    _epoPool.pop_back();
+  }
+  epoch->reset(key, tt);
+  _epoIndex.insert(key, epoch);
+
+  if (_epoData.empty() || key > _epoData.back()->_key) {
+    _epoData.push_back(epoch);
+  }
+  else {
+    deque<t_epoData*>::iterator pos = _epoData.begin();
+    while ((*pos)->_key < key) {
+      ++pos;
+    }
+    _epoData.insert(pos, epoch);
+  }
+
+  return epoch;
+}
+
+// Completeness policy: an epoch is released if all satellites of the last
+// processed epoch are present, if observations of a later epoch arrived, or
+// if missing satellites were waited for long enough; the first epoch (nothing
+// expected yet) is released at once
+////////////////////////////////////////////////////////////////////////////
+bool t_pppRun::epochReady(const t_epoData* epoch) const {
+  if (!_opt->_realTime) {
+    return true;   // files deliver complete epochs
+  }
+  if (epoch->_numExpected >= _numExpected) {
+    return true;
+  }
+  if (_epoData.size() > 1) {
+    return true;
+  }
+  return epoch->_age.elapsed() >= _maxEpoWait;
+}
+
+// Remove the oldest epoch from the buffer, keep it for re-use
+////////////////////////////////////////////////////////////////////////////
+void t_pppRun::releaseEpoch() {
+  t_epoData* epoch = _epoData.front();
+  _epoData.pop_front();
+  _epoIndex.remove(epoch->_key);
+  _epoPool.push_back(epoch);
+  _lastEpoTime = epoch->_time;
+}
+
+// Remove all buffered epochs
+////////////////////////////////////////////////////////////////////////////
+void t_pppRun::clearEpochs() {
+  while (!_epoData.empty()) {
+    releaseEpoch();
+  }
+  _lastEpoTime.reset();
+  _expected.assign(_expected.size(), false);
+  _numExpected = 0;
 }
 
 //
@@ -285,50 +390,43 @@ void t_pppRun::slotNewObs(QByteArray staID, QList<t_satObs> obsList) {
   // -----------------------------------------------------
   QListIterator<t_satObs> it(obsList);
   while (it.hasNext()) {
-    const t_satObs& oldObs = it.next();
-    t_satObs*       newObs = new t_satObs(oldObs);
-
-    // Find the corresponding data epoch or create a new one
-    // -----------------------------------------------------
-    t_epoData* epoch = 0;
-    deque<t_epoData*>::const_iterator it;
-    for (it = _epoData.begin(); it != _epoData.end(); it++) {
-      if (newObs->_time == (*it)->_time) {
-        epoch = *it;
-        break;
-      }
-    }
+    const t_satObs& obs   = it.next();
+    t_epoData*      epoch = findEpoch(obs._time);
     if (epoch == 0) {
-      if (_epoData.empty() || newObs->_time > _epoData.back()->_time) {
-        epoch = new t_epoData;
-        epoch->_time = newObs->_time;
-        _epoData.push_back(epoch);
-      }
-    }
-
-    // Put data into the epoch
-    // -----------------------
-    if (epoch != 0) {
-      epoch->_satObs.push_back(newObs);
+      ++_numLateObs;
     }
-    else {
-      delete newObs;
+    else if (epoch->add(obs)) {
+      unsigned iPrn = obs._prn.toInt();
+      if (iPrn < _expected.size() && _expected[iPrn]) {
+        ++epoch->_numExpected;
+      }
     }
   }
 
   // Make sure the buffer does not grow beyond any limit
   // ---------------------------------------------------
-  const unsigned MAX_EPODATA_SIZE = 120;
-  if (_epoData.size() > MAX_EPODATA_SIZE) {
-    delete _epoData.front();
-    _epoData.pop_front();
+  while (_epoData.size() > _maxEpoData) {
+    releaseEpoch();
+    ++_numLostEpo;
   }
 
-  // Process the oldest epochs
-  // ------------------------
-  while (_epoData.size()) {
+  processEpochs();
+}
+
+// Release waiting epochs even if no further observations arrive (locked)
+////////////////////////////////////////////////////////////////////////////
+void t_pppRun::checkEpochs() {
+  QMutexLocker locker(&_mutex);
+  processEpochs();
+}
 
-    const vector<t_satObs*>& satObs = _epoData.front()->_satObs;
+// Process the oldest epochs (private, locked)
+////////////////////////////////////////////////////////////////////////////
+void t_pppRun::processEpochs() {
+
+  while (!_epoData.empty()) {
+
+    const t_epoData* epoch = _epoData.front();
 
     // No corrections yet, skip the epoch
     // ----------------------------------
@@ -336,75 +434,101 @@ void t_pppRun::slotNewObs(QByteArray staID, QList<t_satObs> obsList) {
       return;
     }
 
-    // Process the front epoch
-    // -----------------------
-    if (_opt->_corrWaitTime == 0 ||
-        _epoData.front()->_time - _lastClkCorrTime < _opt->_corrWaitTime) {
-
-      t_output output;
-      _pppClient->processEpoch(satObs, &output);
+    // Corrections for the front epoch missing or epoch incomplete
+    // -----------------------------------------------------------
+    if (_opt->_corrWaitTime != 0 &&
+        epoch->_time - _lastClkCorrTime >= _opt->_corrWaitTime) {
+      return;
+    }
+    if (!epochReady(epoch)) {
+      return;
+    }
 
-      if (!output._error) {
-        QVector<double> xx(6);
-        xx.data()[0] = output._xyzRover[0];
-        xx.data()[1] = output._xyzRover[1];
-        xx.data()[2] = output._xyzRover[2];
-        xx.data()[3] = output._neu[0];
-        xx.data()[4] = output._neu[1];
-        xx.data()[5] = output._neu[2];
-        emit newPosition(staID, output._epoTime, xx);
-      }
+    processEpoch(epoch);
 
-      delete _epoData.front();
-      _epoData.pop_front();
+    // The satellites of this epoch are expected in the next one
+    // ---------------------------------------------------------
+    _expected    = epoch->_seen;
+    _numExpected = epoch->_numSat;
 
-      ostringstream log;
-      if (output._error) {
-        log << output._log;
-      }
-      else {
-        log.setf(ios::fixed);
-        log << string(output._epoTime) << ' ' << staID.data()
-            << " X = "  << setprecision(4) << output._xyzRover[0]
-            << " Y = "  << setprecision(4) << output._xyzRover[1]
-            << " Z = "  << setprecision(4) << output._xyzRover[2]
-            << " NEU: " << showpos << setw(8) << setprecision(4) << output._neu[0]
-            << " "      << showpos << setw(8) << setprecision(4) << output._neu[1]
-            << " "      << showpos << setw(8) << setprecision(4) << output._neu[2]
-            << " TRP: " << showpos << setw(8) << setprecision(4) << output._trp0
-            << " "      << showpos << setw(8) << setprecision(4) << output._trp;
-      }
+    releaseEpoch();
 
-      if (_logFile && output._epoTime.valid()) {
-          _logFile->write(output._epoTime.gpsw(), output._epoTime.gpssec(),
-                        QString(output._log.c_str()));
-      }
+    if (_numLateObs > 0 || _numLostEpo > 0) {
+      QString msg = QString("pppRun %1: %2 late observations, %3 lost epochs")
+                    .arg(_opt->_roverName.c_str()).arg(_numLateObs).arg(_numLostEpo);
+      emit newMessage(msg.toLatin1(), false);
+      _numLateObs = 0;
+      _numLostEpo = 0;
+    }
+  }
+}
 
-      if (!output._error) {
-        QString rmcStr = nmeaString('R', output);
-        QString ggaStr = nmeaString('G', output);
-        if (_nmeaFile) {
-          _nmeaFile->write(output._epoTime.gpsw(), output._epoTime.gpssec(), rmcStr);
-          _nmeaFile->write(output._epoTime.gpsw(), output._epoTime.gpssec(), ggaStr);
-        }
-        emit newNMEAstr(staID, rmcStr.toLatin1());
-        emit newNMEAstr(staID, ggaStr.toLatin1());
-        if (_snxtroFile && output._epoTime.valid()) {
-          _snxtroFile->write(staID, int(output._epoTime.gpsw()), output._epoTime.gpssec(),
-                      output._trp0 + output._trp, output._trpStdev);
-        }
-      }
-      emit newMessage(QByteArray(log.str().c_str()), true);
+// Process one epoch (private, locked)
+////////////////////////////////////////////////////////////////////////////
+void t_pppRun::processEpoch(const t_epoData* epoch) {
+
+  QByteArray staID(_opt->_roverName.c_str());
+
+  t_output output;
+  _pppClient->processEpoch(epoch->_satObs, &output);
+
+  if (!output._error) {
+    QVector<double> xx(6);
+    xx.data()[0] = output._xyzRover[0];
+    xx.data()[1] = output._xyzRover[1];
+    xx.data()[2] = output._xyzRover[2];
+    xx.data()[3] = output._neu[0];
+    xx.data()[4] = output._neu[1];
+    xx.data()[5] = output._neu[2];
+    emit newPosition(staID, output._epoTime, xx);
+  }
+
+  ostringstream log;
+  if (output._error) {
+    log << output._log;
+  }
+  else if (_logSummary) {
+    log.setf(ios::fixed);
+    log << string(output._epoTime) << ' ' << staID.data()
+        << " X = "  << setprecision(4) << output._xyzRover[0]
+        << " Y = "  << setprecision(4) << output._xyzRover[1]
+        << " Z = "  << setprecision(4) << output._xyzRover[2]
+        << " NEU: " << showpos << setw(8) << setprecision(4) << output._neu[0]
+        << " "      << showpos << setw(8) << setprecision(4) << output._neu[1]
+        << " "      << showpos << setw(8) << setprecision(4) << output._neu[2]
+        << " TRP: " << showpos << setw(8) << setprecision(4) << output._trp0
+        << " "      << showpos << setw(8) << setprecision(4) << output._trp;
+  }
+
+  if (_logFile && output._epoTime.valid()) {
+      _logFile->write(output._epoTime.gpsw(), output._epoTime.gpssec(),
+                    QString(output._log.c_str()));
+  }
+
+  if (!output._error) {
+    QString rmcStr = nmeaString('R', output);
+    QString ggaStr = nmeaString('G', output);
+    if (_nmeaFile) {
+      _nmeaFile->write(output._epoTime.gpsw(), output._epoTime.gpssec(), rmcStr);
+      _nmeaFile->write(output._epoTime.gpsw(), output._epoTime.gpssec(), ggaStr);
     }
-    else {
-      return;
+    emit newNMEAstr(staID, rmcStr.toLatin1());
+    emit newNMEAstr(staID, ggaStr.toLatin1());
+    if (_snxtroFile && output._epoTime.valid()) {
+      _snxtroFile->write(staID, int(output._epoTime.gpsw()), output._epoTime.gpssec(),
+                  output._trp0 + output._trp, output._trpStdev);
     }
   }
+  if (log.tellp() > 0) {
+    emit newMessage(QByteArray(log.str().c_str()), true);
+  }
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewTec(t_vTec vTec) {
+  QMutexLocker locker(&_mutex);
+
   if (vTec._layers.size() == 0) {
     return;
   }
@@ -421,6 +545,8 @@ void t_pppRun::slotNewTec(t_vTec vTec) {
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewOrbCorrections(QList<t_orbCorr> orbCorr) {
+  QMutexLocker locker(&_mutex);
+
   if (orbCorr.size() == 0) {
     return;
   }
@@ -445,6 +571,8 @@ void t_pppRun::slotNewOrbCorrections(QList<t_orbCorr> orbCorr) {
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewClkCorrections(QList<t_clkCorr> clkCorr) {
+  QMutexLocker locker(&_mutex);
+
   if (clkCorr.size() == 0) {
     return;
   }
@@ -464,11 +592,19 @@ void t_pppRun::slotNewClkCorrections(QList<t_clkCorr> clkCorr) {
   for (unsigned ii = 0; ii < corrections.size(); ii++) {
     delete corrections[ii];
   }
+
+  // Epochs waiting for these corrections need not wait for the next epoch
+  // ---------------------------------------------------------------------
+  if (_opt->_realTime) {
+    processEpochs();
+  }
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewCodeBiases(QList<t_satCodeBias> codeBiases) {
+  QMutexLocker locker(&_mutex);
+
   if (codeBiases.size() == 0) {
     return;
   }
@@ -493,6 +629,8 @@ void t_pppRun::slotNewCodeBiases(QList<t_satCodeBias> codeBiases) {
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotNewPhaseBiases(QList<t_satPhaseBias> phaseBiases) {
+  QMutexLocker locker(&_mutex);
+
   if (phaseBiases.size() == 0) {
     return;
   }
@@ -614,6 +752,66 @@ void t_pppRun::processFiles() {
   }
 }
 
+// Batch post-processing - no pacing and no event loop, the ephemerides and
+// corrections are shared with the other jobs; returns the number of epochs
+////////////////////////////////////////////////////////////////////////////
+int t_pppRun::processBatch(t_pppBatchData* batchData, int iJob, QString& errorString) {
+
+  t_rnxObsFile rnxObsFile(QString(_opt->_rinexObs.c_str()), t_rnxObsFile::input);
+
+  QByteArray staID(_opt->_roverName.c_str());
+
+  int   nEpo = 0;
+  const t_rnxObsFile::t_rnxEpo* epo = 0;
+  QVector<const t_pppBatchData::t_event*> events;
+  while ( !_stopFlag && (epo = rnxObsFile.nextEpoch()) != 0 ) {
+    ++nEpo;
+
+    // Get Ephemerides and Corrections
+    // -------------------------------
+    events.clear();
+    if (batchData->events(iJob, epo->tt, events) != success) {
+      errorString = batchData->errorString();
+      break;
+    }
+    for (int ii = 0; ii < events.size(); ii++) {
+      const t_pppBatchData::t_event* event = events[ii];
+      if (event->_eph) {
+        _pppClient->putEphemeris(event->_eph);
+      }
+      if (!event->_tec.isEmpty()) {
+        slotNewTec(event->_tec.first());
+      }
+      if (!event->_orbCorr.isEmpty()) {
+        slotNewOrbCorrections(event->_orbCorr);
+      }
+      if (!event->_clkCorr.isEmpty()) {
+        slotNewClkCorrections(event->_clkCorr);
+      }
+      if (!event->_codeBiases.isEmpty()) {
+        slotNewCodeBiases(event->_codeBiases);
+      }
+      if (!event->_phaseBiases.isEmpty()) {
+        slotNewPhaseBiases(event->_phaseBiases);
+      }
+    }
+
+    // Create list of observations and process the epoch
+    // -------------------------------------------------
+    QList<t_satObs> obsList;
+    for (unsigned iObs = 0; iObs < epo->rnxSat.size(); iObs++) {
+      const t_rnxObsFile::t_rnxSat& rnxSat = epo->rnxSat[iObs];
+
+      t_satObs obs;
+      t_rnxObsFile::setObsFromRnx(&rnxObsFile, epo, rnxSat, obs);
+      obsList << obs;
+    }
+    slotNewObs(staID, obsList);
+  }
+
+  return nEpo;
+}
+
 //
 ////////////////////////////////////////////////////////////////////////////
 void t_pppRun::slotSetSpeed(int speed) {
@@ -708,8 +906,5 @@ void t_pppRun::slotProviderIDChanged(QString mountPoint) {
 
   _pppClient->reset();
 
-  while (!_epoData.empty()) {
-    delete _epoData.front();
-    _epoData.pop_front();
-  }
+  clearEpochs();
 }
@@ -17,6 +17,8 @@ class bncSinexTro;
 
 namespace BNC_PPP {
 
+class t_pppBatchData;
+
 class t_pppRun : public QObject {
  Q_OBJECT
  public:
@@ -24,6 +26,9 @@ class t_pppRun : public QObject {
   ~t_pppRun();
 
   void processFiles();
+  int  processBatch(t_pppBatchData* batchData, int iJob, QString& errorString);
+  void putEphemeris(const t_eph* eph);
+  void checkEpochs();
 
   static QString nmeaString(char strType, const t_output& output);
 
@@ -50,31 +55,61 @@ class t_pppRun : public QObject {
   void slotProviderIDChanged(QString mountPoint);
 
  private:
+  // Observations of one epoch; the satellite storage is re-used when the
+  // epoch object is taken from the pool again
+  // ---------------------------------------------------------------------
   class t_epoData {
    public:
-    t_epoData() {}
+    t_epoData() : _seen(t_prn::MAXPRN + 1, false) {}
     ~t_epoData() {
-      for (unsigned ii = 0; ii < _satObs.size(); ii++) {
-        delete _satObs[ii];
+      for (unsigned ii = 0; ii < _pool.size(); ii++) {
+        delete _pool[ii];
       }
     }
+    void reset(qint64 key, const bncTime& tt);
+    bool add(const t_satObs& obs);
+    qint64                 _key;          // epoch time in units of the time quantum
     bncTime                _time;
-    std::vector<t_satObs*> _satObs;
+    QElapsedTimer          _age;          // since the first observation arrived
+    std::vector<t_satObs*> _satObs;       // observations of the epoch (in _pool)
+    std::vector<t_satObs*> _pool;
+    std::vector<bool>      _seen;         // satellites present (t_prn::toInt())
+    unsigned               _numSat;       // number of different satellites
+    unsigned               _numExpected;  // present satellites of the last epoch
   };
 
-  QMutex                 _mutex;
-  const t_pppOptions*    _opt;
-  t_pppClient*           _pppClient;
-  std::deque<t_epoData*> _epoData;
-  bncTime                _lastClkCorrTime;
-  t_rnxObsFile*          _rnxObsFile;
-  t_rnxNavFile*          _rnxNavFile;
-  t_corrFile*            _corrFile;
-  int                    _speed;
-  bool                   _stopFlag;
-  bncoutf*               _logFile;
-  bncoutf*               _nmeaFile;
-  bncSinexTro*           _snxtroFile;
+  static qint64 epoKey(const bncTime& tt);
+  t_epoData* findEpoch(const bncTime& tt);
+  bool       epochReady(const t_epoData* epoch) const;
+  void       releaseEpoch();
+  void       clearEpochs();
+  void       processEpochs();
+  void       processEpoch(const t_epoData* epoch);
+
+  static const unsigned  _maxEpoData  = 120;  // max. number of buffered epochs
+  static const int       _maxEpoWait  = 500;  // max. wait for missing satellites [ms]
+
+  QMutex                    _mutex;
+  const t_pppOptions*       _opt;
+  t_pppClient*              _pppClient;
+  std::deque<t_epoData*>    _epoData;      // buffered epochs, ordered by time
+  QHash<qint64, t_epoData*> _epoIndex;     // epoch key -> buffered epoch
+  std::vector<t_epoData*>   _epoPool;      // released epochs for re-use
+  std::vector<bool>         _expected;     // satellites of the last processed epoch
+  unsigned                  _numExpected;
+  bncTime                   _lastEpoTime;  // last processed (or dropped) epoch
+  unsigned                  _numLateObs;   // observations arrived too late
+  unsigned                  _numLostEpo;   // epochs dropped (buffer overflow)
+  bncTime                   _lastClkCorrTime;
+  t_rnxObsFile*             _rnxObsFile;
+  t_rnxNavFile*             _rnxNavFile;
+  t_corrFile*               _corrFile;
+  int                       _speed;
+  bool                      _stopFlag;
+  bool                      _logSummary;
+  bncoutf*                  _logFile;
+  bncoutf*                  _nmeaFile;
+  bncSinexTro*              _snxtroFile;
 };
 
 }
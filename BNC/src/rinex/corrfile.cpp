@@ -42,19 +42,28 @@
 #include "corrfile.h"
 #include "bncutils.h"
 #include "bncephuser.h"
+#include "bncgzip.h"
 
 using namespace std;
 
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
-t_corrFile::t_corrFile(QString fileName) {
+t_corrFile::t_corrFile(QString fileName) : _stream(0) {
   expandEnvVar(fileName);
-  _stream.open(fileName.toLatin1().data());
+  _file = createFileDevice(fileName);
+  _buf  = new bncDeviceBuf(_file);
+  _stream.rdbuf(_buf);
+  if (!_file->open(QIODevice::ReadOnly)) {
+    _stream.setstate(ios::failbit);
+  }
 }
 
 // Destructor
 ////////////////////////////////////////////////////////////////////////////
 t_corrFile::~t_corrFile() {
+  _stream.rdbuf(0);
+  delete _buf;
+  delete _file;
 }
 
 // Read till a given time
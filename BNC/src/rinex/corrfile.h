@@ -31,6 +31,8 @@
 #include "bnctime.h"
 #include "satObs.h"
 
+class bncDeviceBuf;
+
 class t_corrFile : public QObject {
  Q_OBJECT
 
@@ -48,7 +50,9 @@ class t_corrFile : public QObject {
   void newTec(t_vTec);
 
  private:
-  std::ifstream               _stream;
+  QIODevice*                  _file;
+  bncDeviceBuf*               _buf;
+  std::istream                _stream;
   std::string                 _lastLine;
   bncTime                     _lastEpoTime;
   QMap<QString, unsigned int> _corrIODs;
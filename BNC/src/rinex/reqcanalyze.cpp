@@ -56,6 +56,54 @@
 
 using namespace std;
 
+// Quality check of one observation file (runs in the file thread pool)
+////////////////////////////////////////////////////////////////////////////
+class t_reqcAnalyze::t_qcFileTask : public QRunnable {
+ public:
+  t_qcFileTask(t_reqcAnalyze* parent, int iFile) {
+    _parent = parent;
+    _iFile  = iFile;
+  }
+  virtual void run() {
+    _parent->analyzeFile(_iFile);
+  }
+ private:
+  t_reqcAnalyze* _parent;
+  int            _iFile;
+};
+
+// Multipath, slip and availability analysis of one satellite
+////////////////////////////////////////////////////////////////////////////
+class t_reqcAnalyze::t_qcSatTask : public QRunnable {
+ public:
+  t_qcSatTask(const t_reqcAnalyze* parent, const t_qcFile* qcFile,
+              const t_prn& prn, const ColumnVector& xyzSta) {
+    _parent    = parent;
+    _qcFile    = qcFile;
+    _prn       = prn;
+    _xyzSta    = xyzSta;
+    _qcSatSum  = 0;
+    _numExpObs = 0;
+    setAutoDelete(false);
+  }
+  virtual void run() {
+    if (_qcSatSum) {
+      _parent->analyzeMultipath(*_qcFile, *this);
+    }
+    if (_parent->_navFileNames.size()) {
+      _numExpObs = _parent->numExpectedObs(*_qcFile, _prn, _xyzSta);
+    }
+  }
+  const t_reqcAnalyze*    _parent;
+  const t_qcFile*         _qcFile;
+  t_prn                   _prn;
+  ColumnVector            _xyzSta;
+  t_qcSatSum*             _qcSatSum;
+  QVector<const bncTime*> _epoTime;  // epochs in which the satellite was observed
+  QVector<t_qcSat*>       _qcSat;
+  int                     _numExpObs;
+};
+
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 t_reqcAnalyze::t_reqcAnalyze(QObject* parent) : QThread(parent) {
@@ -65,7 +113,7 @@ t_reqcAnalyze::t_reqcAnalyze(QObject* parent) : QThread(parent) {
   _logFileName     = settings.value("reqcOutLogFile").toString(); expandEnvVar(_logFileName);
   _logFile         = 0;
   _log             = 0;
-  _currEpo         = 0;
+  _nextReport      = 0;
   _obsFileNames    = settings.value("reqcObsFile").toString().split(",", QString::SkipEmptyParts);
   _navFileNames    = settings.value("reqcNavFile").toString().split(",", QString::SkipEmptyParts);
   _reqcPlotSignals = settings.value("reqcSkyPlotSignals").toString();
@@ -74,6 +122,8 @@ t_reqcAnalyze::t_reqcAnalyze(QObject* parent) : QThread(parent) {
     _reqcPlotSignals = _defaultSignalTypes.join(" ");
   }
   analyzePlotSignals(_signalTypes);
+  _logSummaryOnly  = (Qt::CheckState(settings.value("reqcLogSummaryOnly").toInt()) == Qt::Checked);
+  _numSatThreads   = 1;
 
   connect(this, SIGNAL(dspSkyPlot(const QString&, const QString&, QVector<t_polarPoint*>*,
                                   const QString&, QVector<t_polarPoint*>*,
@@ -82,8 +132,10 @@ t_reqcAnalyze::t_reqcAnalyze(QObject* parent) : QThread(parent) {
                                     const QString&, QVector<t_polarPoint*>*,
                                     const QByteArray&, double)));
 
-  connect(this, SIGNAL(dspAvailPlot(const QString&, const QByteArray&)),
-          this, SLOT(slotDspAvailPlot(const QString&, const QByteArray&)));
+  connect(this, SIGNAL(dspAvailPlot(const QString&, const QByteArray&,
+                                    t_plotData*, QMap<t_prn, t_plotData>*)),
+          this, SLOT(slotDspAvailPlot(const QString&, const QByteArray&,
+                                      t_plotData*, QMap<t_prn, t_plotData>*)));
 }
 
 // Destructor
@@ -135,10 +187,32 @@ void t_reqcAnalyze::run() {
   // ----------------
   t_reqcEdit::readEphemerides(_navFileNames, _ephs);
 
-  // Loop over all RINEX Files
-  // -------------------------
-  for (int ii = 0; ii < _rnxObsFiles.size(); ii++) {
-    analyzeFile(_rnxObsFiles[ii]);
+  // First (earliest) ephemeris of each satellite and of each satellite and
+  // navigation message type (e.g. Galileo I/NAV and F/NAV)
+  // ------------------------------------------------------------------------
+  for (int ie = 0; ie < _ephs.size(); ie++) {
+    t_prn prn(_ephs[ie]->prn().system(), _ephs[ie]->prn().number());
+    if (!_ephMap.contains(prn)) {
+      _ephMap[prn] = _ephs[ie];
+    }
+    int key = t_qcFile::ephKey(_ephs[ie]->prn());
+    if (!_ephMapFlags.contains(key)) {
+      _ephMapFlags[key] = _ephs[ie];
+    }
+  }
+
+  // Analyze all RINEX Files in a Thread Pool, Reports are written in File Order
+  // ----------------------------------------------------------------------------
+  if (_rnxObsFiles.size() > 0) {
+    int numThreads = qMax(1, QThread::idealThreadCount());
+    int numFileThreads = qMin(numThreads, _rnxObsFiles.size());
+    _numSatThreads = qMax(1, numThreads / numFileThreads);
+    QThreadPool pool;
+    pool.setMaxThreadCount(numFileThreads);
+    for (int ii = 0; ii < _rnxObsFiles.size(); ii++) {
+      pool.start(new t_qcFileTask(this, ii));
+    }
+    pool.waitForDone();
   }
 
   // Exit
@@ -185,9 +259,15 @@ void t_reqcAnalyze::analyzePlotSignals(QMap<char, QVector<QString> >& signalType
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void t_reqcAnalyze::analyzeFile(t_rnxObsFile* obsFile) {
+void t_reqcAnalyze::analyzeFile(int iFile) {
+
+  t_rnxObsFile* obsFile = _rnxObsFiles[iFile];
+
+  t_qcFile qcFile;
+  initEphemerides(qcFile);
 
-  _qcFile.clear();
+  QString     report;
+  QTextStream log(&report);
 
   // A priori Coordinates
   // --------------------
@@ -198,70 +278,107 @@ void t_reqcAnalyze::analyzeFile(t_rnxObsFile* obsFile) {
   try {
     QMap<QString, bncTime> lastObsTime;
     bool firstEpo = true;
-    while ( (_currEpo = obsFile->nextEpoch()) != 0) {
+    t_rnxObsFile::t_rnxEpo* epo = 0;
+    while ( (epo = obsFile->nextEpoch()) != 0) {
       if (firstEpo) {
         firstEpo = false;
-        _qcFile._startTime    = _currEpo->tt;
-        _qcFile._antennaName  = obsFile->antennaName();
-        _qcFile._markerName   = obsFile->markerName();
-        _qcFile._receiverType = obsFile->receiverType();
-        _qcFile._interval     = obsFile->interval();
+        qcFile._startTime    = epo->tt;
+        qcFile._antennaName  = obsFile->antennaName();
+        qcFile._markerName   = obsFile->markerName();
+        qcFile._receiverType = obsFile->receiverType();
+        qcFile._interval     = obsFile->interval();
       }
-      _qcFile._endTime = _currEpo->tt;
+      qcFile._endTime = epo->tt;
 
-      t_qcEpo qcEpo;
-      qcEpo._epoTime = _currEpo->tt;
-      qcEpo._PDOP    = cmpDOP(xyzSta);
+      qcFile._qcEpo.push_back(t_qcEpo());
+      t_qcEpo& qcEpo = qcFile._qcEpo.back();
+      qcEpo._epoTime = epo->tt;
+      qcFile.evaluateEphs(epo->tt); // satellite positions used by cmpDOP and setQcObs
+      qcEpo._PDOP    = cmpDOP(qcFile, epo, xyzSta);
 
       // Loop over all satellites
       // ------------------------
-      for (unsigned iObs = 0; iObs < _currEpo->rnxSat.size(); iObs++) {
-        const t_rnxObsFile::t_rnxSat& rnxSat = _currEpo->rnxSat[iObs];
+      for (unsigned iObs = 0; iObs < epo->rnxSat.size(); iObs++) {
+        const t_rnxObsFile::t_rnxSat& rnxSat = epo->rnxSat[iObs];
         if (_navFileNames.size() &&
-            _numExpObs.find(rnxSat.prn) == _numExpObs.end()) {
-          _numExpObs[rnxSat.prn] = 0;
+            qcFile._numExpObs.find(rnxSat.prn) == qcFile._numExpObs.end()) {
+          qcFile._numExpObs[rnxSat.prn] = 0;
         }
-        if (_signalTypes.find(rnxSat.prn.system()) == _signalTypes.end()) {
+        if (!_signalTypes.contains(rnxSat.prn.system())) {
           continue;
         }
         t_satObs satObs;
-        t_rnxObsFile::setObsFromRnx(obsFile, _currEpo, rnxSat, satObs);
+        t_rnxObsFile::setObsFromRnx(obsFile, epo, rnxSat, satObs);
         t_qcSat& qcSat = qcEpo._qcSat[satObs._prn];
-        setQcObs(qcEpo._epoTime, xyzSta, satObs, lastObsTime, qcSat);
-        updateQcSat(qcSat, _qcFile._qcSatSum[satObs._prn]);
+        setQcObs(qcFile, qcEpo._epoTime, xyzSta, satObs, lastObsTime, qcSat);
+        updateQcSat(qcSat, qcFile._qcSatSum[satObs._prn]);
       }
-      _qcFile._qcEpo.push_back(qcEpo);
     }
 
-    analyzeMultipath();
+    analyzeSatellites(qcFile, xyzSta);
 
-    if (_navFileNames.size()) {
-      setExpectedObs(_qcFile._startTime, _qcFile._endTime, _qcFile._interval, xyzSta);
-    }
-
-    preparePlotData(obsFile);
+    preparePlotData(obsFile, qcFile);
 
-    printReport(obsFile);
+    if (_log) {
+      printReport(obsFile, qcFile, log);
+    }
   }
   catch (QString str) {
     if (_log) {
-      *_log << "Exception " << str << endl;
+      log << "Exception " << str << endl;
     }
     else {
       qDebug() << str;
     }
   }
+
+  log.flush();
+  writeReport(iFile, report);
+}
+
+// Write the reports to the log file in the order of the input files
+////////////////////////////////////////////////////////////////////////////
+void t_reqcAnalyze::writeReport(int iFile, const QString& report) {
+
+  QMutexLocker locker(&_mutex);
+
+  _pendingReports[iFile] = report;
+
+  while (_pendingReports.contains(_nextReport)) {
+    if (_log) {
+      *_log << _pendingReports.take(_nextReport);
+      _log->flush();
+    }
+    else {
+      _pendingReports.remove(_nextReport);
+    }
+    ++_nextReport;
+  }
+}
+
+// Ephemerides of one file (evaluated once per epoch for all satellites)
+////////////////////////////////////////////////////////////////////////////
+void t_reqcAnalyze::initEphemerides(t_qcFile& qcFile) const {
+
+  qcFile._ephMap = _ephMap;
+
+  QMapIterator<int, t_eph*> it(_ephMapFlags);
+  while (it.hasNext()) {
+    it.next();
+    qcFile._ephIdx[it.key()] = qcFile._ephBatch.add(it.value());
+  }
 }
 
 // Compute Dilution of Precision
 ////////////////////////////////////////////////////////////////////////////
-double t_reqcAnalyze::cmpDOP(const ColumnVector& xyzSta) const {
+double t_reqcAnalyze::cmpDOP(const t_qcFile& qcFile, const t_rnxObsFile::t_rnxEpo* epo,
+                             const ColumnVector& xyzSta) const {
 
   if ( xyzSta.size() != 3 || (xyzSta[0] == 0.0 && xyzSta[1] == 0.0 && xyzSta[2] == 0.0) ) {
     return 0.0;
   }
 
-  unsigned nSat = _currEpo->rnxSat.size();
+  unsigned nSat = epo->rnxSat.size();
 
   if (nSat < 4) {
     return 0.0;
@@ -272,32 +389,22 @@ double t_reqcAnalyze::cmpDOP(const ColumnVector& xyzSta) const {
   unsigned nSatUsed = 0;
   for (unsigned iSat = 0; iSat < nSat; iSat++) {
 
-    const t_rnxObsFile::t_rnxSat& rnxSat = _currEpo->rnxSat[iSat];
+    const t_rnxObsFile::t_rnxSat& rnxSat = epo->rnxSat[iSat];
     const t_prn& prn = rnxSat.prn;
 
     if (_signalTypes.find(prn.system()) == _signalTypes.end()) {
       continue;
     }
 
-    t_eph* eph = 0;
-    for (int ie = 0; ie < _ephs.size(); ie++) {
-      if (_ephs[ie]->prn() == prn) {
-        eph = _ephs[ie];
-        break;
-      }
-    }
-    if (eph) {
-      ColumnVector xSat(4);
-      ColumnVector vv(3);
-      if (eph->getCrd(_currEpo->tt, xSat, vv, false) == success) {
-        ++nSatUsed;
-        ColumnVector dx = xSat.Rows(1,3) - xyzSta;
-        double rho = dx.norm_Frobenius();
-        AA(nSatUsed,1) = dx(1) / rho;
-        AA(nSatUsed,2) = dx(2) / rho;
-        AA(nSatUsed,3) = dx(3) / rho;
-        AA(nSatUsed,4) = 1.0;
-      }
+    ColumnVector xSat(3);
+    if (qcFile.satCrd(prn, xSat)) {
+      ++nSatUsed;
+      ColumnVector dx = xSat - xyzSta;
+      double rho = dx.norm_Frobenius();
+      AA(nSatUsed,1) = dx(1) / rho;
+      AA(nSatUsed,2) = dx(2) / rho;
+      AA(nSatUsed,3) = dx(3) / rho;
+      AA(nSatUsed,4) = 1.0;
     }
   }
 
@@ -337,23 +444,15 @@ void t_reqcAnalyze::updateQcSat(const t_qcSat& qcSat, t_qcSatSum& qcSatSum) {
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void t_reqcAnalyze::setQcObs(const bncTime& epoTime, const ColumnVector& xyzSta,
-                             const t_satObs& satObs, QMap<QString, bncTime>& lastObsTime,
-                             t_qcSat& qcSat) {
+void t_reqcAnalyze::setQcObs(const t_qcFile& qcFile, const bncTime& epoTime,
+                             const ColumnVector& xyzSta, const t_satObs& satObs,
+                             QMap<QString, bncTime>& lastObsTime, t_qcSat& qcSat) const {
 
-  t_eph* eph = 0;
-  for (int ie = 0; ie < _ephs.size(); ie++) {
-    if (_ephs[ie]->prn().system() == satObs._prn.system() &&
-        _ephs[ie]->prn().number() == satObs._prn.number()) {
-      eph = _ephs[ie];
-      break;
-    }
-  }
+  t_eph* eph = qcFile._ephMap.value(t_prn(satObs._prn.system(), satObs._prn.number()), 0);
   if (eph) {
-    ColumnVector xc(4);
-    ColumnVector vv(3);
+    ColumnVector xc(3);
     if ( xyzSta.size() == 3 && (xyzSta[0] != 0.0 || xyzSta[1] != 0.0 || xyzSta[2] != 0.0) &&
-         eph->getCrd(epoTime, xc, vv, false) == success) {
+         qcFile.satCrd(eph->prn(), xc)) {
       double rho, eleSat, azSat;
       topos(xyzSta(1), xyzSta(2), xyzSta(3), xc(1), xc(2), xc(3), rho, eleSat, azSat);
       qcSat._eleSet = true;
@@ -384,7 +483,7 @@ void t_reqcAnalyze::setQcObs(const bncTime& epoTime, const ColumnVector& xyzSta,
     QString key = QString(satObs._prn.toString().c_str()) + qcFrq._rnxType2ch;
     if (lastObsTime[key].valid()) {
       double dt = epoTime - lastObsTime[key];
-      if (dt > 1.5 * _qcFile._interval) {
+      if (dt > 1.5 * qcFile._interval) {
         qcFrq._gap = true;
       }
     }
@@ -397,11 +496,12 @@ void t_reqcAnalyze::setQcObs(const bncTime& epoTime, const ColumnVector& xyzSta,
       t_frequency::type fB = t_frequency::dummy;
       char sys             = satObs._prn.system();
       std::string frqType1, frqType2;
-      if (_signalTypes.find(sys) != _signalTypes.end()) {
+      QMap<char, QVector<QString> >::const_iterator itSig = _signalTypes.constFind(sys);
+      if (itSig != _signalTypes.constEnd()) {
         frqType1.push_back(sys);
-        frqType1.push_back(_signalTypes[sys][0][0].toLatin1());
+        frqType1.push_back(itSig.value()[0][0].toLatin1());
         frqType2.push_back(sys);
-        frqType2.push_back(_signalTypes[sys][1][0].toLatin1());
+        frqType2.push_back(itSig.value()[1][0].toLatin1());
         if      (frqObs->_rnxType2ch[0] == frqType1[1]) {
           fA = t_frequency::toInt(frqType1);
           fB = t_frequency::toInt(frqType2);
@@ -442,117 +542,186 @@ void t_reqcAnalyze::setQcObs(const bncTime& epoTime, const ColumnVector& xyzSta,
   } // satObs loop
 }
 
-//
+// Satellite-specific analysis, satellites are processed independently
 ////////////////////////////////////////////////////////////////////////////
-void t_reqcAnalyze::analyzeMultipath() {
+void t_reqcAnalyze::analyzeSatellites(t_qcFile& qcFile, const ColumnVector& xyzSta) {
 
-  const double SLIPTRESH = 10.0;  // cycle-slip threshold (meters)
-  const double chunkStep = 600.0; // 10 minutes
+  // Collect the epochs of each satellite
+  // ------------------------------------
+  QMap<t_prn, t_qcSatTask*> satTasks;
 
-  // Loop over all satellites available
-  // ----------------------------------
-  QMutableMapIterator<t_prn, t_qcSatSum> itSat(_qcFile._qcSatSum);
+  QMutableMapIterator<t_prn, t_qcSatSum> itSat(qcFile._qcSatSum);
   while (itSat.hasNext()) {
     itSat.next();
-    const t_prn& prn      = itSat.key();
-    t_qcSatSum&  qcSatSum = itSat.value();
+    t_qcSatTask* satTask = new t_qcSatTask(this, &qcFile, itSat.key(), xyzSta);
+    satTask->_qcSatSum = &itSat.value();
+    satTasks[itSat.key()] = satTask;
+  }
+  QMapIterator<t_prn, int> itExp(qcFile._numExpObs);
+  while (itExp.hasNext()) {
+    itExp.next();
+    if (!satTasks.contains(itExp.key())) {
+      satTasks[itExp.key()] = new t_qcSatTask(this, &qcFile, itExp.key(), xyzSta);
+    }
+  }
 
-    // Loop over all frequencies available
-    // -----------------------------------
-    QMutableMapIterator<QString, t_qcFrqSum> itFrq(qcSatSum._qcFrqSum);
-    while (itFrq.hasNext()) {
-      itFrq.next();
-      const QString& frqType  = itFrq.key();
-      t_qcFrqSum&    qcFrqSum = itFrq.value();
-
-      // Loop over all Chunks of Data
-      // ----------------------------
-      for (bncTime chunkStart = _qcFile._startTime;
-           chunkStart < _qcFile._endTime; chunkStart += chunkStep) {
-
-        bncTime chunkEnd = chunkStart + chunkStep;
-
-        QVector<t_qcFrq*> frqVec;
-        QVector<double>   MP;
-
-        // Loop over all Epochs within one Chunk of Data
-        // ---------------------------------------------
-        for (int iEpo = 0; iEpo < _qcFile._qcEpo.size(); iEpo++) {
-          t_qcEpo& qcEpo = _qcFile._qcEpo[iEpo];
-          if (chunkStart <= qcEpo._epoTime && qcEpo._epoTime < chunkEnd) {
-            if (qcEpo._qcSat.contains(prn)) {
-              t_qcSat& qcSat = qcEpo._qcSat[prn];
-              for (int iFrq = 0; iFrq < qcSat._qcFrq.size(); iFrq++) {
-                t_qcFrq& qcFrq = qcSat._qcFrq[iFrq];
-                if (qcFrq._rnxType2ch == frqType) {
-                  frqVec << &qcFrq;
-                  if (qcFrq._setMP) {
-                    MP << qcFrq._rawMP;
-                  }
-                }
-              }
-            }
-          }
+  for (int iEpo = 0; iEpo < qcFile._qcEpo.size(); iEpo++) {
+    t_qcEpo& qcEpo = qcFile._qcEpo[iEpo];
+    QMutableMapIterator<t_prn, t_qcSat> it(qcEpo._qcSat);
+    while (it.hasNext()) {
+      it.next();
+      t_qcSatTask* satTask = satTasks.value(it.key(), 0);
+      if (satTask) {
+        satTask->_epoTime << &qcEpo._epoTime;
+        satTask->_qcSat   << &it.value();
+      }
+    }
+  }
+
+  // Run the satellite tasks
+  // -----------------------
+  if (_numSatThreads > 1 && satTasks.size() > 1) {
+    QThreadPool pool;
+    pool.setMaxThreadCount(_numSatThreads);
+    QMapIterator<t_prn, t_qcSatTask*> it(satTasks);
+    while (it.hasNext()) {
+      pool.start(it.next().value());
+    }
+    pool.waitForDone();
+  }
+  else {
+    QMapIterator<t_prn, t_qcSatTask*> it(satTasks);
+    while (it.hasNext()) {
+      it.next().value()->run();
+    }
+  }
+
+  // Collect the results in PRN order
+  // --------------------------------
+  QMapIterator<t_prn, t_qcSatTask*> it(satTasks);
+  while (it.hasNext()) {
+    it.next();
+    t_qcSatTask* satTask = it.value();
+    if (_navFileNames.size() && qcFile._numExpObs.contains(satTask->_prn)) {
+      if (satTask->_numExpObs >= 0) {
+        qcFile._numExpObs[satTask->_prn] = satTask->_numExpObs;
+      }
+      else if (!qcFile._navFileIncomplete.contains(satTask->_prn.system())) {
+        qcFile._navFileIncomplete.append(satTask->_prn.system());
+      }
+    }
+    delete satTask;
+  }
+}
+
+// Multipath and cycle slips of one satellite (modifies satellite data only)
+////////////////////////////////////////////////////////////////////////////
+void t_reqcAnalyze::analyzeMultipath(const t_qcFile& qcFile, t_qcSatTask& satTask) const {
+
+  const double SLIPTRESH = 10.0;  // cycle-slip threshold (meters)
+  const double chunkStep = 600.0; // 10 minutes
+
+  // Loop over all frequencies available
+  // -----------------------------------
+  QMutableMapIterator<QString, t_qcFrqSum> itFrq(satTask._qcSatSum->_qcFrqSum);
+  while (itFrq.hasNext()) {
+    itFrq.next();
+    const QString& frqType  = itFrq.key();
+    t_qcFrqSum&    qcFrqSum = itFrq.value();
+
+    // Observations of the frequency
+    // -----------------------------
+    QVector<const bncTime*> epoTime;
+    QVector<t_qcFrq*>       qcFrqAll;
+    for (int iEpo = 0; iEpo < satTask._qcSat.size(); iEpo++) {
+      t_qcSat* qcSat = satTask._qcSat[iEpo];
+      for (int iFrq = 0; iFrq < qcSat->_qcFrq.size(); iFrq++) {
+        t_qcFrq& qcFrq = qcSat->_qcFrq[iFrq];
+        if (qcFrq._rnxType2ch == frqType) {
+          epoTime  << satTask._epoTime[iEpo];
+          qcFrqAll << &qcFrq;
         }
+      }
+    }
+
+    // Loop over all Chunks of Data
+    // ----------------------------
+    for (bncTime chunkStart = qcFile._startTime;
+         chunkStart < qcFile._endTime; chunkStart += chunkStep) {
 
-        // Compute the multipath mean and standard deviation
-        // -------------------------------------------------
-        if (MP.size() > 1) {
-          double meanMP = 0.0;
-          for (int ii = 0; ii < MP.size(); ii++) {
-            meanMP += MP[ii];
+      bncTime chunkEnd = chunkStart + chunkStep;
+
+      QVector<t_qcFrq*> frqVec;
+      QVector<double>   MP;
+
+      // Loop over all Epochs within one Chunk of Data
+      // ---------------------------------------------
+      for (int ii = 0; ii < qcFrqAll.size(); ii++) {
+        if (chunkStart <= *epoTime[ii] && *epoTime[ii] < chunkEnd) {
+          t_qcFrq* qcFrq = qcFrqAll[ii];
+          frqVec << qcFrq;
+          if (qcFrq->_setMP) {
+            MP << qcFrq->_rawMP;
           }
-          meanMP /= MP.size();
+        }
+      }
 
-          bool slipMP = false;
+      // Compute the multipath mean and standard deviation
+      // -------------------------------------------------
+      if (MP.size() > 1) {
+        double meanMP = 0.0;
+        for (int ii = 0; ii < MP.size(); ii++) {
+          meanMP += MP[ii];
+        }
+        meanMP /= MP.size();
 
-          double stdMP = 0.0;
-          for (int ii = 0; ii < MP.size(); ii++) {
-            double diff = MP[ii] - meanMP;
-            if (fabs(diff) > SLIPTRESH) {
-              slipMP = true;
-              break;
-            }
-            stdMP += diff * diff;
+        bool slipMP = false;
+
+        double stdMP = 0.0;
+        for (int ii = 0; ii < MP.size(); ii++) {
+          double diff = MP[ii] - meanMP;
+          if (fabs(diff) > SLIPTRESH) {
+            slipMP = true;
+            break;
           }
+          stdMP += diff * diff;
+        }
+
+        if (slipMP) {
+          stdMP = 0.0;
+          qcFrqSum._numSlipsFound += 1;
+        }
+        else {
+          stdMP = sqrt(stdMP / (MP.size()-1));
+          qcFrqSum._numMP += 1;
+          qcFrqSum._sumMP += stdMP;
+        }
 
+        for (int ii = 0; ii < frqVec.size(); ii++) {
+          t_qcFrq* qcFrq = frqVec[ii];
           if (slipMP) {
-            stdMP = 0.0;
-            stdMP = 0.0;
-            qcFrqSum._numSlipsFound += 1;
+            qcFrq->_slip = true;
           }
           else {
-            stdMP = sqrt(stdMP / (MP.size()-1));
-            qcFrqSum._numMP += 1;
-            qcFrqSum._sumMP += stdMP;
-          }
-
-          for (int ii = 0; ii < frqVec.size(); ii++) {
-            t_qcFrq* qcFrq = frqVec[ii];
-            if (slipMP) {
-              qcFrq->_slip = true;
-            }
-            else {
-              qcFrq->_stdMP = stdMP;
-            }
+            qcFrq->_stdMP = stdMP;
           }
         }
-      } // chunk loop
-    } // frq loop
-  } // sat loop
+      }
+    } // chunk loop
+  } // frq loop
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void t_reqcAnalyze::preparePlotData(const t_rnxObsFile* obsFile) {
+void t_reqcAnalyze::preparePlotData(const t_rnxObsFile* obsFile, const t_qcFile& qcFile) {
 
   QString mp1Title = "Multipath\n";
   QString mp2Title = "Multipath\n";
   QString sn1Title = "Signal-to-Noise Ratio\n";
   QString sn2Title = "Signal-to-Noise Ratio\n";
 
-  for(QMap<char, QVector<QString> >::iterator it = _signalTypes.begin();
-      it != _signalTypes.end(); it++) {
+  for(QMap<char, QVector<QString> >::const_iterator it = _signalTypes.constBegin();
+      it != _signalTypes.constEnd(); it++) {
       mp1Title += QString(it.key()) + ":" + it.value()[0] + " ";
       sn1Title += QString(it.key()) + ":" + it.value()[0] + " ";
       mp2Title += QString(it.key()) + ":" + it.value()[1] + " ";
@@ -566,8 +735,8 @@ void t_reqcAnalyze::preparePlotData(const t_rnxObsFile* obsFile) {
 
   // Loop over all observations
   // --------------------------
-  for (int iEpo = 0; iEpo < _qcFile._qcEpo.size(); iEpo++) {
-    t_qcEpo& qcEpo = _qcFile._qcEpo[iEpo];
+  for (int iEpo = 0; iEpo < qcFile._qcEpo.size(); iEpo++) {
+    const t_qcEpo& qcEpo = qcFile._qcEpo[iEpo];
     QMapIterator<t_prn, t_qcSat> it(qcEpo._qcSat);
     while (it.hasNext()) {
       it.next();
@@ -614,7 +783,72 @@ void t_reqcAnalyze::preparePlotData(const t_rnxObsFile* obsFile) {
     QByteArray title = fileInfo.fileName().toLatin1();
     emit dspSkyPlot(obsFile->fileName(), mp1Title,  dataMP1,  mp2Title,  dataMP2,  "Meters",  2.0);
     emit dspSkyPlot(obsFile->fileName(), sn1Title, dataSNR1, sn2Title, dataSNR2, "dbHz",   54.0);
-    emit dspAvailPlot(obsFile->fileName(), title);
+
+    t_plotData*              plotData    = new t_plotData;
+    QMap<t_prn, t_plotData>* plotDataMap = new QMap<t_prn, t_plotData>;
+
+    for (int ii = 0; ii < qcFile._qcEpo.size(); ii++) {
+      const t_qcEpo& qcEpo = qcFile._qcEpo[ii];
+      double mjdX24 = qcEpo._epoTime.mjddec() * 24.0;
+
+      plotData->_mjdX24 << mjdX24;
+      plotData->_PDOP   << qcEpo._PDOP;
+      plotData->_numSat << qcEpo._qcSat.size();
+
+      QMapIterator<t_prn, t_qcSat> it(qcEpo._qcSat);
+      while (it.hasNext()) {
+        it.next();
+        const t_prn&   prn   = it.key();
+        const t_qcSat& qcSat = it.value();
+
+        t_plotData&    data  = (*plotDataMap)[prn];
+
+        if (qcSat._eleSet) {
+          data._mjdX24 << mjdX24;
+          data._eleDeg << qcSat._eleDeg;
+        }
+
+        const QVector<QString>& signalTypes = _signalTypes.constFind(prn.system()).value();
+        char frqChar1 = signalTypes[0][0].toLatin1();
+        char frqChar2 = signalTypes[1][0].toLatin1();
+
+        QString frqType1;
+        QString frqType2;
+        for (int iFrq = 0; iFrq < qcSat._qcFrq.size(); iFrq++) {
+          const t_qcFrq& qcFrq = qcSat._qcFrq[iFrq];
+          if (qcFrq._rnxType2ch[0] == frqChar1 && frqType1.isEmpty()) {
+            frqType1 = qcFrq._rnxType2ch;
+          }
+          if (qcFrq._rnxType2ch[0] == frqChar2 && frqType2.isEmpty()) {
+            frqType2 = qcFrq._rnxType2ch;
+          }
+          if      (qcFrq._rnxType2ch == frqType1) {
+            if      (qcFrq._slip) {
+              data._L1slip << mjdX24;
+            }
+            else if (qcFrq._gap) {
+              data._L1gap << mjdX24;
+            }
+            else {
+              data._L1ok << mjdX24;
+            }
+          }
+          else if (qcFrq._rnxType2ch == frqType2) {
+            if      (qcFrq._slip) {
+              data._L2slip << mjdX24;
+            }
+            else if (qcFrq._gap) {
+              data._L2gap << mjdX24;
+            }
+            else {
+              data._L2ok << mjdX24;
+            }
+          }
+        }
+      }
+    }
+
+    emit dspAvailPlot(obsFile->fileName(), title, plotData, plotDataMap);
   }
   else {
     for (int ii = 0; ii < dataMP1->size(); ii++) {
@@ -698,78 +932,16 @@ void t_reqcAnalyze::slotDspSkyPlot(const QString& fileName, const QString& title
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void t_reqcAnalyze::slotDspAvailPlot(const QString& fileName, const QByteArray& title) {
-
-  t_plotData              plotData;
-  QMap<t_prn, t_plotData> plotDataMap;
-
-  for (int ii = 0; ii < _qcFile._qcEpo.size(); ii++) {
-    const t_qcEpo& qcEpo = _qcFile._qcEpo[ii];
-    double mjdX24 = qcEpo._epoTime.mjddec() * 24.0;
-
-    plotData._mjdX24 << mjdX24;
-    plotData._PDOP   << qcEpo._PDOP;
-    plotData._numSat << qcEpo._qcSat.size();
-
-    QMapIterator<t_prn, t_qcSat> it(qcEpo._qcSat);
-    while (it.hasNext()) {
-      it.next();
-      const t_prn&   prn   = it.key();
-      const t_qcSat& qcSat = it.value();
-
-      t_plotData&    data  = plotDataMap[prn];
-
-      if (qcSat._eleSet) {
-        data._mjdX24 << mjdX24;
-        data._eleDeg << qcSat._eleDeg;
-      }
-
-      char frqChar1 = _signalTypes[prn.system()][0][0].toLatin1();
-      char frqChar2 = _signalTypes[prn.system()][1][0].toLatin1();
-
-      QString frqType1;
-      QString frqType2;
-      for (int iFrq = 0; iFrq < qcSat._qcFrq.size(); iFrq++) {
-        const t_qcFrq& qcFrq = qcSat._qcFrq[iFrq];
-        if (qcFrq._rnxType2ch[0] == frqChar1 && frqType1.isEmpty()) {
-          frqType1 = qcFrq._rnxType2ch;
-        }
-        if (qcFrq._rnxType2ch[0] == frqChar2 && frqType2.isEmpty()) {
-          frqType2 = qcFrq._rnxType2ch;
-        }
-        if      (qcFrq._rnxType2ch == frqType1) {
-          if      (qcFrq._slip) {
-            data._L1slip << mjdX24;
-          }
-          else if (qcFrq._gap) {
-            data._L1gap << mjdX24;
-          }
-          else {
-            data._L1ok << mjdX24;
-          }
-        }
-        else if (qcFrq._rnxType2ch == frqType2) {
-          if      (qcFrq._slip) {
-            data._L2slip << mjdX24;
-          }
-          else if (qcFrq._gap) {
-            data._L2gap << mjdX24;
-          }
-          else {
-            data._L2ok << mjdX24;
-          }
-        }
-      }
-    }
-  }
+void t_reqcAnalyze::slotDspAvailPlot(const QString& fileName, const QByteArray& title,
+                                     t_plotData* plotData, QMap<t_prn, t_plotData>* plotDataMap) {
 
   if (BNC_CORE->GUIenabled()) {
-    t_availPlot* plotA = new t_availPlot(0, plotDataMap);
+    t_availPlot* plotA = new t_availPlot(0, *plotDataMap);
     plotA->setTitle(title);
 
-    t_elePlot* plotZ = new t_elePlot(0, plotDataMap);
+    t_elePlot* plotZ = new t_elePlot(0, *plotDataMap);
 
-    t_dopPlot* plotD = new t_dopPlot(0, plotData);
+    t_dopPlot* plotD = new t_dopPlot(0, *plotData);
 
     QVector<QWidget*> plots;
     plots << plotA << plotZ << plotD;
@@ -787,69 +959,69 @@ void t_reqcAnalyze::slotDspAvailPlot(const QString& fileName, const QByteArray&
       graphWin->savePNG(dirName, ext);
     }
   }
+
+  delete plotData;
+  delete plotDataMap;
 }
 
 // Finish the report
 ////////////////////////////////////////////////////////////////////////////
-void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile) {
-
-  if (!_log) {
-    return;
-  }
+void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile, const t_qcFile& qcFile,
+                                QTextStream& log) {
 
   QFileInfo obsFi(obsFile->fileName());
   QString obsFileName = obsFi.fileName();
 
   // Summary
   // -------
-  *_log << "Observation File   : " << obsFileName                                   << endl
-        << "RINEX Version      : " << QString("%1").arg(obsFile->version(),4,'f',2) << endl
-        << "Marker Name        : " << _qcFile._markerName                           << endl
-        << "Marker Number      : " << obsFile->markerNumber()                       << endl
-        << "Receiver           : " << _qcFile._receiverType                         << endl
-        << "Antenna            : " << _qcFile._antennaName                          << endl
-        << "Position XYZ       : " << QString("%1 %2 %3").arg(obsFile->xyz()(1), 14, 'f', 4)
-                                                        .arg(obsFile->xyz()(2), 14, 'f', 4)
-                                                        .arg(obsFile->xyz()(3), 14, 'f', 4) << endl
-        << "Antenna dH/dE/dN   : " << QString("%1 %2 %3").arg(obsFile->antNEU()(3), 8, 'f', 4)
-                                                        .arg(obsFile->antNEU()(2), 8, 'f', 4)
-                                                        .arg(obsFile->antNEU()(1), 8, 'f', 4) << endl
-        << "Start Time         : " << _qcFile._startTime.datestr().c_str()         << ' '
-                                   << _qcFile._startTime.timestr(1,'.').c_str()    << endl
-        << "End Time           : " << _qcFile._endTime.datestr().c_str()           << ' '
-                                   << _qcFile._endTime.timestr(1,'.').c_str()      << endl
-        << "Interval           : " << _qcFile._interval                            << endl;
+  log << "Observation File   : " << obsFileName                                   << endl
+      << "RINEX Version      : " << QString("%1").arg(obsFile->version(),4,'f',2) << endl
+      << "Marker Name        : " << qcFile._markerName                           << endl
+      << "Marker Number      : " << obsFile->markerNumber()                       << endl
+      << "Receiver           : " << qcFile._receiverType                         << endl
+      << "Antenna            : " << qcFile._antennaName                          << endl
+      << "Position XYZ       : " << QString("%1 %2 %3").arg(obsFile->xyz()(1), 14, 'f', 4)
+                                                      .arg(obsFile->xyz()(2), 14, 'f', 4)
+                                                      .arg(obsFile->xyz()(3), 14, 'f', 4) << endl
+      << "Antenna dH/dE/dN   : " << QString("%1 %2 %3").arg(obsFile->antNEU()(3), 8, 'f', 4)
+                                                      .arg(obsFile->antNEU()(2), 8, 'f', 4)
+                                                      .arg(obsFile->antNEU()(1), 8, 'f', 4) << endl
+      << "Start Time         : " << qcFile._startTime.datestr().c_str()         << ' '
+                                 << qcFile._startTime.timestr(1,'.').c_str()    << endl
+      << "End Time           : " << qcFile._endTime.datestr().c_str()           << ' '
+                                 << qcFile._endTime.timestr(1,'.').c_str()      << endl
+      << "Interval           : " << qcFile._interval                            << endl;
 
   // Number of systems
   // -----------------
   QMap<QChar, QVector<const t_qcSatSum*> > systemMap;
-  QMapIterator<t_prn, t_qcSatSum> itSat(_qcFile._qcSatSum);
+  QMapIterator<t_prn, t_qcSatSum> itSat(qcFile._qcSatSum);
   while (itSat.hasNext()) {
     itSat.next();
     const t_prn&      prn      = itSat.key();
     const t_qcSatSum& qcSatSum = itSat.value();
     systemMap[prn.system()].push_back(&qcSatSum);
   }
-  *_log << "Navigation Systems : " << systemMap.size() << "   ";
+  log << "Navigation Systems : " << systemMap.size() << "   ";
 
   QMapIterator<QChar, QVector<const t_qcSatSum*> > itSys(systemMap);
   while (itSys.hasNext()) {
     itSys.next();
-    *_log << ' ' << itSys.key();
+    log << ' ' << itSys.key();
   }
-  *_log << endl;
+  log << endl;
 
   // Observation types per system
   // -----------------------------
   for (int iSys = 0; iSys < obsFile->numSys(); iSys++) {
     char sys = obsFile->system(iSys);
     if (sys != ' ') {
-      *_log << "Observation Types " << sys << ":";
+      log << "Observation Types " << sys << ":";
       for (int iType = 0; iType < obsFile->nTypes(sys); iType++) {
         QString type = obsFile->obsType(sys, iType);
-        *_log << " " << type;
+        log << " " << type;
       }
-      *_log << endl;
+      log << endl;
     }
   }
 
@@ -861,8 +1033,8 @@ void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile) {
     const QChar&                      sys      = itSys.key();
     const QVector<const t_qcSatSum*>& qcSatVec = itSys.value();
     int numExpectedObs = 0;
-    for(QMap<t_prn, int>::iterator it = _numExpObs.begin();
-        it != _numExpObs.end(); it++) {
+    for(QMap<t_prn, int>::const_iterator it = qcFile._numExpObs.constBegin();
+        it != qcFile._numExpObs.constEnd(); it++) {
       if (sys == it.key().system()) {
         numExpectedObs += it.value();
       }
@@ -879,16 +1051,16 @@ void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile) {
         frqMap[frqType].push_back(&qcFrqSum);
       }
     }
-    *_log << endl
-          << prefixSys << "Satellites: " << qcSatVec.size() << endl
-          << prefixSys << "Signals   : " << frqMap.size() << "   ";
+    log << endl
+        << prefixSys << "Satellites: " << qcSatVec.size() << endl
+        << prefixSys << "Signals   : " << frqMap.size() << "   ";
     QMapIterator<QString, QVector<const t_qcFrqSum*> > itFrq(frqMap);
     while (itFrq.hasNext()) {
       itFrq.next();
       QString frqType = itFrq.key(); if (frqType.length() < 2) frqType += '?';
-      *_log << ' ' << frqType;
+      log << ' ' << frqType;
     }
-    *_log << endl;
+    log << endl;
     QString prefixSys2 = "    " + prefixSys;
     itFrq.toFront();
     while (itFrq.hasNext()) {
@@ -924,31 +1096,30 @@ void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile) {
 
       double ratio = (double(numObs) / double(numExpectedObs)) * 100.0;
 
-      *_log << endl
-            << prefixSys2 << prefixFrq << "Observations      : ";
-      if(_navFileNames.isEmpty() || _navFileIncomplete.contains(sys.toLatin1())) {
-        *_log << QString("%1\n").arg(numObs,           6);
+      log << endl
+          << prefixSys2 << prefixFrq << "Observations      : ";
+      if(_navFileNames.isEmpty() || qcFile._navFileIncomplete.contains(sys.toLatin1())) {
+        log << QString("%1\n").arg(numObs,           6);
       }
       else {
-        *_log << QString("%1 (%2) %3 \%\n").arg(numObs,           6).arg(numExpectedObs,           8).arg(ratio, 8, 'f', 2);
+        log << QString("%1 (%2) %3 \%\n").arg(numObs,           6).arg(numExpectedObs,           8).arg(ratio, 8, 'f', 2);
       }
-      *_log << prefixSys2 << prefixFrq << "Slips (file+found): " << QString("%1 +").arg(numSlipsFlagged,  8)
-                                                                 << QString("%1\n").arg(numSlipsFound,    8)
-            << prefixSys2 << prefixFrq << "Gaps              : " << QString("%1\n").arg(numGaps,          8)
-            << prefixSys2 << prefixFrq << "Mean SNR          : " << QString("%1\n").arg(sumSNR,   8, 'f', 1)
-            << prefixSys2 << prefixFrq << "Mean Multipath    : " << QString("%1\n").arg(sumMP,    8, 'f', 2);
+      log << prefixSys2 << prefixFrq << "Slips (file+found): " << QString("%1 +").arg(numSlipsFlagged,  8)
+                                                               << QString("%1\n").arg(numSlipsFound,    8)
+          << prefixSys2 << prefixFrq << "Gaps              : " << QString("%1\n").arg(numGaps,          8)
+          << prefixSys2 << prefixFrq << "Mean SNR          : " << QString("%1\n").arg(sumSNR,   8, 'f', 1)
+          << prefixSys2 << prefixFrq << "Mean Multipath    : " << QString("%1\n").arg(sumMP,    8, 'f', 2);
     }
   }
 
   // Epoch-Specific Output
   // ---------------------
-  bncSettings settings;
-  if (Qt::CheckState(settings.value("reqcLogSummaryOnly").toInt()) == Qt::Checked) {
+  if (_logSummaryOnly) {
     return;
   }
-  *_log << endl;
-  for (int iEpo = 0; iEpo < _qcFile._qcEpo.size(); iEpo++) {
-    const t_qcEpo& qcEpo = _qcFile._qcEpo[iEpo];
+  log << endl;
+  for (int iEpo = 0; iEpo < qcFile._qcEpo.size(); iEpo++) {
+    const t_qcEpo& qcEpo = qcFile._qcEpo[iEpo];
 
     unsigned year, month, day, hour, min;
     double sec;
@@ -964,9 +1135,9 @@ void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile) {
       .arg(min,   2, 10, QChar('0'))
       .arg(sec,  11, 'f', 7);
 
-    *_log << dateStr << QString(" %1").arg(qcEpo._qcSat.size(), 2)
-          << QString(" %1").arg(qcEpo._PDOP, 4, 'f', 1)
-          << endl;
+    log << dateStr << QString(" %1").arg(qcEpo._qcSat.size(), 2)
+        << QString(" %1").arg(qcEpo._PDOP, 4, 'f', 1)
+        << endl;
 
     QMapIterator<t_prn, t_qcSat> itSat(qcEpo._qcSat);
     while (itSat.hasNext()) {
@@ -974,8 +1145,8 @@ void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile) {
       const t_prn&   prn   = itSat.key();
       const t_qcSat& qcSat = itSat.value();
 
-      *_log << prn.toString().c_str()
-            << QString(" %1 %2").arg(qcSat._eleDeg, 6, 'f', 2).arg(qcSat._azDeg, 7, 'f', 2);
+      log << prn.toString().c_str()
+          << QString(" %1 %2").arg(qcSat._eleDeg, 6, 'f', 2).arg(qcSat._azDeg, 7, 'f', 2);
 
       int numObsTypes = 0;
       for (int iFrq = 0; iFrq < qcSat._qcFrq.size(); iFrq++) {
@@ -987,41 +1158,41 @@ void t_reqcAnalyze::printReport(const t_rnxObsFile* obsFile) {
           numObsTypes += 1;
         }
       }
-      *_log << QString("  %1").arg(numObsTypes, 2);
+      log << QString("  %1").arg(numObsTypes, 2);
 
       for (int iFrq = 0; iFrq < qcSat._qcFrq.size(); iFrq++) {
         const t_qcFrq& qcFrq = qcSat._qcFrq[iFrq];
         if (qcFrq._phaseValid) {
-          *_log << "  L" << qcFrq._rnxType2ch << ' ';
+          log << "  L" << qcFrq._rnxType2ch << ' ';
           if (qcFrq._slip) {
-            *_log << 's';
+            log << 's';
           }
           else {
-            *_log << '.';
+            log << '.';
           }
           if (qcFrq._gap) {
-            *_log << 'g';
+            log << 'g';
           }
           else {
-            *_log << '.';
+            log << '.';
           }
-          *_log << QString(" %1").arg(qcFrq._SNR,   4, 'f', 1);
+          log << QString(" %1").arg(qcFrq._SNR,   4, 'f', 1);
         }
         if (qcFrq._codeValid) {
-          *_log << "  C" << qcFrq._rnxType2ch << ' ';
+          log << "  C" << qcFrq._rnxType2ch << ' ';
           if (qcFrq._gap) {
-            *_log << " g";
+            log << " g";
           }
           else {
-            *_log << " .";
+            log << " .";
           }
-          *_log << QString(" %1").arg(qcFrq._stdMP, 3, 'f', 2);
+          log << QString(" %1").arg(qcFrq._stdMP, 3, 'f', 2);
         }
       }
-      *_log << endl;
+      log << endl;
     }
   }
-  _log->flush();
+  log.flush();
 }
 
 //
@@ -1051,8 +1222,9 @@ void t_reqcAnalyze::checkEphemerides() {
     unsigned numBad = 0;
     bncEphUser ephUser(false);
     t_rnxNavFile rnxNavFile(fileName, t_rnxNavFile::input);
-    for (unsigned ii = 0; ii < rnxNavFile.ephs().size(); ii++) {
-      t_eph* eph = rnxNavFile.ephs()[ii];
+    const std::vector<t_eph*> navEphs = rnxNavFile.ephs();
+    for (unsigned ii = 0; ii < navEphs.size(); ii++) {
+      t_eph* eph = navEphs[ii];
       ephUser.putNewEph(eph, true);
       if (eph->checkState() == t_eph::bad) {
         ++numBad;
@@ -1065,8 +1237,8 @@ void t_reqcAnalyze::checkEphemerides() {
       *_log << "Ephemeris          : " << numOK << " OK   " << numBad << " BAD" << endl;
     }
     if (numBad > 0) {
-      for (unsigned ii = 0; ii < rnxNavFile.ephs().size(); ii++) {
-        t_eph* eph = rnxNavFile.ephs()[ii];
+      for (unsigned ii = 0; ii < navEphs.size(); ii++) {
+        t_eph* eph = navEphs[ii];
         if (eph->checkState() == t_eph::bad) {
           QFileInfo navFi(fileName);
           if (_log) {
@@ -1082,41 +1254,30 @@ void t_reqcAnalyze::checkEphemerides() {
   }
 }
 
-void t_reqcAnalyze::setExpectedObs(const bncTime& startTime, const bncTime& endTime,
-                                   double interval, const ColumnVector& xyzSta) {
-
-  for(QMap<t_prn, int>::iterator it = _numExpObs.begin();
-      it != _numExpObs.end(); it++) {
-    t_eph* eph = 0;
-    for (int ie = 0; ie < _ephs.size(); ie++) {
-      if (_ephs[ie]->prn().system() == it.key().system() &&
-          _ephs[ie]->prn().number() == it.key().number()) {
-        eph = _ephs[ie];
-        break;
-      }
-    }
-    if (eph) {
-      int numExpObs = 0;
-      bncTime epoTime;
-      for (epoTime = startTime - interval; epoTime < endTime;
-           epoTime = epoTime + interval) {
-        ColumnVector xc(4);
-        ColumnVector vv(3);
-        if ( xyzSta.size() == 3 && (xyzSta[0] != 0.0 || xyzSta[1] != 0.0 || xyzSta[2] != 0.0) &&
-             eph->getCrd(epoTime, xc, vv, false) == success) {
-          double rho, eleSat, azSat;
-          topos(xyzSta(1), xyzSta(2), xyzSta(3), xc(1), xc(2), xc(3), rho, eleSat, azSat);
-          if ((eleSat * 180.0/M_PI) > 0.0) {
-            numExpObs++;
-          }
-        }
-      }
-      it.value() = numExpObs;
-    }
-    else {
-      if (!_navFileIncomplete.contains(it.key().system())) {
-        _navFileIncomplete.append(it.key().system());
+// Number of observations expected for one satellite (-1: no ephemeris)
+////////////////////////////////////////////////////////////////////////////
+int t_reqcAnalyze::numExpectedObs(const t_qcFile& qcFile, const t_prn& prn,
+                                  const ColumnVector& xyzSta) const {
+
+  t_eph* eph = qcFile._ephMap.value(t_prn(prn.system(), prn.number()), 0);
+  if (!eph) {
+    return -1;
+  }
+
+  int numExpObs = 0;
+  bncTime epoTime;
+  for (epoTime = qcFile._startTime - qcFile._interval; epoTime < qcFile._endTime;
+       epoTime = epoTime + qcFile._interval) {
+    ColumnVector xc(4);
+    ColumnVector vv(3);
+    if ( xyzSta.size() == 3 && (xyzSta[0] != 0.0 || xyzSta[1] != 0.0 || xyzSta[2] != 0.0) &&
+         eph->getCrd(epoTime, xc, vv) == success) {
+      double rho, eleSat, azSat;
+      topos(xyzSta(1), xyzSta(2), xyzSta(3), xc(1), xc(2), xc(3), rho, eleSat, azSat);
+      if ((eleSat * 180.0/M_PI) > 0.0) {
+        numExpObs++;
       }
     }
   }
+  return numExpObs;
 }
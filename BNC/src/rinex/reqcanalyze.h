@@ -61,7 +61,7 @@ Q_OBJECT
   void finished();
   void dspSkyPlot(const QString&, const QString&, QVector<t_polarPoint*>*,
                   const QString&, QVector<t_polarPoint*>*, const QByteArray&, double);
-  void dspAvailPlot(const QString&, const QByteArray&);
+  void dspAvailPlot(const QString&, const QByteArray&, t_plotData*, QMap<t_prn, t_plotData>*);
 
  private:
 
@@ -146,6 +146,27 @@ Q_OBJECT
       _interval = 1.0;
     }
     void clear() {_qcSatSum.clear(); _qcEpo.clear();}
+    void evaluateEphs(const bncTime& tt) {
+      unsigned nSat = _ephBatch.size();
+      _xSat.resize(nSat); _ySat.resize(nSat); _zSat.resize(nSat); _clkSat.resize(nSat);
+      _vxSat.resize(nSat); _vySat.resize(nSat); _vzSat.resize(nSat); _ircSat.resize(nSat);
+      if (nSat > 0) {
+        _ephBatch.getCrd(tt, &_xSat[0], &_ySat[0], &_zSat[0], &_clkSat[0],
+                         &_vxSat[0], &_vySat[0], &_vzSat[0], &_ircSat[0]);
+      }
+    }
+    static int ephKey(const t_prn& prn) {  // QMap<t_prn> ignores the flags
+      return 2 * prn.toInt() + prn.flags();
+    }
+    bool satCrd(const t_prn& prn, ColumnVector& xc) const {
+      QMap<int, unsigned>::const_iterator it = _ephIdx.constFind(ephKey(prn));
+      if (it == _ephIdx.constEnd() || it.value() >= _ircSat.size() || _ircSat[it.value()] != success) {
+        return false;
+      }
+      xc.ReSize(3);
+      xc[0] = _xSat[it.value()]; xc[1] = _ySat[it.value()]; xc[2] = _zSat[it.value()];
+      return true;
+    }
     bncTime                 _startTime;
     bncTime                 _endTime;
     QString                 _antennaName;
@@ -154,37 +175,58 @@ Q_OBJECT
     double                  _interval;
     QMap<t_prn, t_qcSatSum> _qcSatSum;
     QVector<t_qcEpo>        _qcEpo;
+    QMap<t_prn, int>        _numExpObs;
+    QVector<char>           _navFileIncomplete;
+    QMap<t_prn, t_eph*>     _ephMap;  // ephemeris used for each satellite
+    t_ephBatch              _ephBatch; // ephemerides of _ephMapFlags, evaluated once per epoch
+    QMap<int, unsigned>     _ephIdx;   // index in _ephBatch (key: ephKey)
+    std::vector<double>     _xSat, _ySat, _zSat, _clkSat, _vxSat, _vySat, _vzSat;
+    std::vector<t_irc>      _ircSat;
+   private:
+    t_qcFile(const t_qcFile&);
+    t_qcFile& operator=(const t_qcFile&);
   };
 
+  class t_qcFileTask;
+  class t_qcSatTask;
+
  private slots:
   void   slotDspSkyPlot(const QString& fileName, const QString& title1,
                     QVector<t_polarPoint*>* data1, const QString& title2,
                     QVector<t_polarPoint*>* data2, const QByteArray& scaleTitle, double maxValue);
 
-  void   slotDspAvailPlot(const QString& fileName, const QByteArray& title);
+  void   slotDspAvailPlot(const QString& fileName, const QByteArray& title,
+                          t_plotData* plotData, QMap<t_prn, t_plotData>* plotDataMap);
 
  private:
   void   checkEphemerides();
 
   void   analyzePlotSignals(QMap<char, QVector<QString> >& signalTypes);
 
-  void   analyzeFile(t_rnxObsFile* obsFile);
+  void   analyzeFile(int iFile);
+
+  void   writeReport(int iFile, const QString& report);
+
+  void   initEphemerides(t_qcFile& qcFile) const;
 
   void   updateQcSat(const t_qcSat& qcSat, t_qcSatSum& qcSatSum);
 
-  void   setQcObs(const bncTime& epoTime, const ColumnVector& xyzSta,
-                  const t_satObs& satObs, QMap<QString, bncTime>& lastObsTime, t_qcSat& qcSat);
+  void   setQcObs(const t_qcFile& qcFile, const bncTime& epoTime, const ColumnVector& xyzSta,
+                  const t_satObs& satObs, QMap<QString, bncTime>& lastObsTime, t_qcSat& qcSat) const;
+
+  void   analyzeSatellites(t_qcFile& qcFile, const ColumnVector& xyzSta);
 
-  void   setExpectedObs(const bncTime& startTime, const bncTime& endTime,
-                        double interval, const ColumnVector& xyzSta);
+  int    numExpectedObs(const t_qcFile& qcFile, const t_prn& prn,
+                        const ColumnVector& xyzSta) const;
 
-  void   analyzeMultipath();
+  void   analyzeMultipath(const t_qcFile& qcFile, t_qcSatTask& satTask) const;
 
-  void   preparePlotData(const t_rnxObsFile* obsFile);
+  void   preparePlotData(const t_rnxObsFile* obsFile, const t_qcFile& qcFile);
 
-  double cmpDOP(const ColumnVector& xyzSta) const;
+  double cmpDOP(const t_qcFile& qcFile, const t_rnxObsFile::t_rnxEpo* epo,
+                const ColumnVector& xyzSta) const;
 
-  void   printReport(const t_rnxObsFile* obsFile);
+  void   printReport(const t_rnxObsFile* obsFile, const t_qcFile& qcFile, QTextStream& log);
 
   QString                       _logFileName;
   QFile*                        _logFile;
@@ -194,12 +236,15 @@ Q_OBJECT
   QStringList                   _navFileNames;
   QString                       _reqcPlotSignals;
   QMap<char, QVector<QString> > _signalTypes;
-  QMap<t_prn, int>              _numExpObs;
-  QVector<char>                 _navFileIncomplete;
   QStringList                   _defaultSignalTypes;
   QVector<t_eph*>               _ephs;
-  t_rnxObsFile::t_rnxEpo*       _currEpo;
-  t_qcFile                      _qcFile;
+  QMap<t_prn, t_eph*>           _ephMap;      // first ephemeris (system, number)
+  QMap<int, t_eph*>             _ephMapFlags; // first ephemeris (t_qcFile::ephKey)
+  bool                          _logSummaryOnly;
+  int                           _numSatThreads;
+  QMutex                        _mutex;
+  QMap<int, QString>            _pendingReports;
+  int                           _nextReport;
 };
 
 #endif
@@ -39,6 +39,7 @@
  * -----------------------------------------------------------------------*/
 
 #include <iostream>
+#include <algorithm>
 #include "reqcedit.h"
 #include "bnccore.h"
 #include "bncsettings.h"
@@ -48,6 +49,101 @@
 
 using namespace std;
 
+// Writes the edited epochs into the output file in a separate thread
+////////////////////////////////////////////////////////////////////////////
+class t_reqcObsWriter : public QThread {
+ public:
+  t_reqcObsWriter(t_rnxObsFile* outObsFile) {
+    _outObsFile = outObsFile;
+    _finished   = false;
+  }
+  ~t_reqcObsWriter() {
+    finish();
+    while (!_queue.isEmpty()) {
+      delete _queue.dequeue();
+    }
+    for (int ii = 0; ii < _free.size(); ii++) {
+      delete _free[ii];
+    }
+  }
+
+  // Queue a copy of the epoch (blocks while the queue is full)
+  void putEpoch(const t_rnxObsFile::t_rnxEpo* epo) {
+    QMutexLocker locker(&_mutex);
+    while (_queue.size() >= maxQueued) {
+      _notFull.wait(&_mutex);
+    }
+    t_rnxObsFile::t_rnxEpo* epoCopy = _free.isEmpty() ? new t_rnxObsFile::t_rnxEpo
+                                                      : _free.takeLast();
+    *epoCopy = *epo;
+    _queue.enqueue(epoCopy);
+    _notEmpty.wakeOne();
+  }
+
+  // Write the remaining epochs and stop the thread
+  void finish() {
+    if (isRunning()) {
+      _mutex.lock();
+      _finished = true;
+      _notEmpty.wakeOne();
+      _mutex.unlock();
+      wait();
+    }
+  }
+
+ protected:
+  virtual void run() {
+    QMutexLocker locker(&_mutex);
+    while (true) {
+      while (_queue.isEmpty() && !_finished) {
+        _notEmpty.wait(&_mutex);
+      }
+      if (_queue.isEmpty()) {
+        break;
+      }
+      t_rnxObsFile::t_rnxEpo* epo = _queue.dequeue();
+      _notFull.wakeOne();
+      locker.unlock();
+      _outObsFile->writeEpoch(epo);
+      epo->clear(); // releases the observations shared with the input file
+      locker.relock();
+      _free.append(epo);
+    }
+  }
+
+ private:
+  static const int maxQueued = 64;
+
+  t_rnxObsFile*                    _outObsFile;
+  QMutex                           _mutex;
+  QWaitCondition                   _notEmpty;
+  QWaitCondition                   _notFull;
+  QQueue<t_rnxObsFile::t_rnxEpo*>  _queue;
+  QVector<t_rnxObsFile::t_rnxEpo*> _free;
+  bool                             _finished;
+};
+
+// Next epoch of one input file (entry of the merge heap)
+////////////////////////////////////////////////////////////////////////////
+class t_reqcMergeItem {
+ public:
+  t_reqcMergeItem(int iFile, const bncTime& tt, t_rnxObsFile::t_rnxEpo* epo) {
+    _iFile = iFile;
+    _tt    = tt;
+    _epo   = epo;
+  }
+  // Heap order: earliest epoch on top, earlier file first for equal epochs
+  bool operator<(const t_reqcMergeItem& item) const {
+    if (_tt == item._tt) {
+      return _iFile > item._iFile;
+    }
+    return item._tt < _tt;
+  }
+  int                     _iFile;
+  bncTime                 _tt;
+  t_rnxObsFile::t_rnxEpo* _epo;  // 0: file not yet opened for reading
+};
+
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 t_reqcEdit::t_reqcEdit(QObject* parent) : QThread(parent) {
@@ -292,79 +388,121 @@ void t_reqcEdit::editObservations() {
     gloSlots.removeDuplicates();
   }
 
-  // Loop over all input observation files
-  // -------------------------------------
+  // Write the output header (first input file)
+  // -------------------------------------------
+  if (_rnxObsFiles.isEmpty()) {
+    return;
+  }
+  {
+    t_rnxObsFile* obsFile = _rnxObsFiles[0];
+    outObsFile.setHeader(obsFile->header(), int(_rnxVersion), &useObsTypes,
+        &phaseShifts, &gloBiases, &gloSlots);
+    if (_begTime.valid() && _begTime > outObsFile.startTime()) {
+      outObsFile.setStartTime(_begTime);
+    }
+    if (_samplingRate > outObsFile.interval()) {
+      outObsFile.setInterval(_samplingRate);
+    }
+    editRnxObsHeader(outObsFile);
+    bncSettings settings;
+    QMap<QString, QString> txtMap;
+    QString runBy = settings.value("reqcRunBy").toString();
+    if (!runBy.isEmpty()) {
+      txtMap["RUN BY"]  = runBy;
+    }
+    QString comment = settings.value("reqcComment").toString();
+    if (!comment.isEmpty()) {
+      txtMap["COMMENT"]  = comment;
+    }
+    if (int(_rnxVersion) < int(obsFile->header().version())) {
+      addRnxConversionDetails(obsFile, txtMap);
+    }
+    outObsFile.header().write(outObsFile.stream(), &txtMap);
+  }
+
+  // Merge the epochs of all input files (k-way merge in time order). Files
+  // enter the heap with their header start time and are read only when
+  // their turn comes, i.e. only one epoch per active file is kept in memory.
+  // Epochs not later than the last merged epoch (overlaps) are skipped.
+  // ----------------------------------------------------------------------
+  t_reqcObsWriter writer(&outObsFile);
+  writer.start();
+
+  std::vector<t_reqcMergeItem> heap;
   for (int ii = 0; ii < _rnxObsFiles.size(); ii++) {
-    t_rnxObsFile* obsFile = _rnxObsFiles[ii];
-    if (_log) {
-      *_log << "Processing File: " << obsFile->fileName() << "  start: "
-            << obsFile->startTime().datestr().c_str() << ' '
-            << obsFile->startTime().timestr(0).c_str() << endl;
-    }
-    if (ii == 0) {
-      outObsFile.setHeader(obsFile->header(), int(_rnxVersion), &useObsTypes,
-          &phaseShifts, &gloBiases, &gloSlots);
-      if (_begTime.valid() && _begTime > outObsFile.startTime()) {
-        outObsFile.setStartTime(_begTime);
-      }
-      if (_samplingRate > outObsFile.interval()) {
-        outObsFile.setInterval(_samplingRate);
-      }
-      editRnxObsHeader(outObsFile);
-      bncSettings settings;
-      QMap<QString, QString> txtMap;
-      QString runBy = settings.value("reqcRunBy").toString();
-      if (!runBy.isEmpty()) {
-        txtMap["RUN BY"]  = runBy;
-      }
-      QString comment = settings.value("reqcComment").toString();
-      if (!comment.isEmpty()) {
-        txtMap["COMMENT"]  = comment;
+    heap.push_back(t_reqcMergeItem(ii, _rnxObsFiles[ii]->startTime(), 0));
+  }
+  std::make_heap(heap.begin(), heap.end());
+
+  bncTime lastTime;
+  try {
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end());
+      t_reqcMergeItem item = heap.back();
+      heap.pop_back();
+
+      t_rnxObsFile* obsFile = _rnxObsFiles[item._iFile];
+
+      if (item._epo == 0) {
+        if (_log) {
+          *_log << "Processing File: " << obsFile->fileName() << "  start: "
+                << obsFile->startTime().datestr().c_str() << ' '
+                << obsFile->startTime().timestr(0).c_str() << endl;
+        }
+        if (_begTime.valid() && obsFile->startTime() < _begTime) {
+          obsFile->seek(_begTime); // epochs are skipped below if seek fails
+        }
       }
-      if (int(_rnxVersion) < int(obsFile->header().version())) {
-        addRnxConversionDetails(obsFile, txtMap);
+      else {
+        t_rnxObsFile::t_rnxEpo* epo = item._epo;
+        if (!lastTime.valid() || lastTime < epo->tt) {
+          if (_samplingRate == 0 ||
+              fmod(round(epo->tt.gpssec()), _samplingRate) == 0) {
+            applyLLI(obsFile, epo);
+            writer.putEpoch(epo);
+          }
+          else {
+            rememberLLI(obsFile, epo);
+          }
+          lastTime = epo->tt;
+        }
       }
-      outObsFile.header().write(outObsFile.stream(), &txtMap);
-    }
-    t_rnxObsFile::t_rnxEpo* epo = 0;
-    try {
+
+      // Next epoch of the same file
+      // ---------------------------
+      t_rnxObsFile::t_rnxEpo* epo = 0;
       while ( (epo = obsFile->nextEpoch()) != 0) {
         if (_begTime.valid() && epo->tt < _begTime) {
           continue;
         }
         if (_endTime.valid() && epo->tt > _endTime) {
-          break;
-        }
-
-        if (_samplingRate == 0 ||
-            fmod(round(epo->tt.gpssec()), _samplingRate) == 0) {
-          applyLLI(obsFile, epo);
-          outObsFile.writeEpoch(epo);
+          epo = 0;
         }
-        else {
-          rememberLLI(obsFile, epo);
-        }
-      }
-    }
-    catch (QString str) {
-      if (_log) {
-        *_log << "Exception " << str << endl;
+        break;
       }
-      else {
-        qDebug() << str;
+      if (epo) {
+        heap.push_back(t_reqcMergeItem(item._iFile, epo->tt, epo));
+        std::push_heap(heap.begin(), heap.end());
       }
-      return;
     }
-    catch (...) {
-      if (_log) {
-        *_log << "Exception unknown" << endl;
-      }
-      else {
-        qDebug() << "Exception unknown";
-      }
-      return;
+  }
+  catch (QString str) {
+    if (_log) {
+      *_log << "Exception " << str << endl;
+    }
+    else {
+      qDebug() << str;
+    }
+  }
+  catch (...) {
+    if (_log) {
+      *_log << "Exception unknown" << endl;
+    }
+    else {
+      qDebug() << "Exception unknown";
     }
   }
+  writer.finish();
 }
 
 // Change RINEX Header Content
@@ -620,8 +758,9 @@ void t_reqcEdit::appendEphemerides(const QString& fileName,
                                    QVector<t_eph*>& ephs) {
 
   t_rnxNavFile rnxNavFile(fileName, t_rnxNavFile::input);
-  for (unsigned ii = 0; ii < rnxNavFile.ephs().size(); ii++) {
-    t_eph* eph   = rnxNavFile.ephs()[ii];
+  const std::vector<t_eph*> navEphs = rnxNavFile.ephs();
+  for (unsigned ii = 0; ii < navEphs.size(); ii++) {
+    t_eph* eph   = navEphs[ii];
     bool   isNew = true;
     for (int iOld = 0; iOld < ephs.size(); iOld++) {
       const t_eph* ephOld = ephs[iOld];
@@ -39,10 +39,12 @@
  * -----------------------------------------------------------------------*/
 
 #include <iostream>
+#include <algorithm>
 #include <newmatio.h>
 #include "rnxnavfile.h"
 #include "bnccore.h"
 #include "bncutils.h"
+#include "bncgzip.h"
 #include "ephemeris.h"
 
 using namespace std;
@@ -90,9 +92,12 @@ t_irc t_rnxNavFile::t_rnxNavHeader::read(QTextStream* stream) {
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 t_rnxNavFile::t_rnxNavFile(const QString& fileName, e_inpOut inpOut) {
-  _inpOut = inpOut;
-  _stream = 0;
-  _file   = 0;
+  _inpOut      = inpOut;
+  _stream      = 0;
+  _file        = 0;
+  _numReleased = 0;
+  _indexed     = false;
+  _timeCursor  = 0;
   if (_inpOut == input) {
     openRead(fileName);
   }
@@ -106,7 +111,7 @@ t_rnxNavFile::t_rnxNavFile(const QString& fileName, e_inpOut inpOut) {
 void t_rnxNavFile::openRead(const QString& fileName) {
 
   _fileName = fileName; expandEnvVar(_fileName);
-  _file     = new QFile(_fileName);
+  _file     = createFileDevice(_fileName);
   _file->open(QIODevice::ReadOnly | QIODevice::Text);
   _stream = new QTextStream();
   _stream->setDevice(_file);
@@ -120,7 +125,7 @@ void t_rnxNavFile::openRead(const QString& fileName) {
 void t_rnxNavFile::openWrite(const QString& fileName) {
 
   _fileName = fileName; expandEnvVar(_fileName);
-  _file     = new QFile(_fileName);
+  _file     = createFileDevice(_fileName);
   _file->open(QIODevice::WriteOnly | QIODevice::Text);
   _stream = new QTextStream();
   _stream->setDevice(_file);
@@ -220,28 +225,99 @@ void t_rnxNavFile::read(QTextStream* stream) {
   }
 }
 
-// Read Next Ephemeris
+// Ephemerides not yet released by getNextEph (in file order)
+////////////////////////////////////////////////////////////////////////////
+const std::vector<t_eph*> t_rnxNavFile::ephs() const {
+  if (_numReleased == 0) {
+    return _ephs;
+  }
+  std::vector<t_eph*> ephs;
+  ephs.reserve(_ephs.size() - _numReleased);
+  for (unsigned ii = 0; ii < _ephs.size(); ii++) {
+    if (_ephs[ii]) {
+      ephs.push_back(_ephs[ii]);
+    }
+  }
+  return ephs;
+}
+
+// Sort positions by time of clock, equal times keep the file order
+////////////////////////////////////////////////////////////////////////////
+class t_earlierTOC {
+ public:
+  t_earlierTOC(const std::vector<t_eph*>& ephs) : _ephs(ephs) {}
+  bool operator()(unsigned ii, unsigned jj) const {
+    return _ephs[ii]->TOC() < _ephs[jj]->TOC();
+  }
+ private:
+  const std::vector<t_eph*>& _ephs;
+};
+
+// Build the time and (PRN, IOD) index of all ephemerides
+////////////////////////////////////////////////////////////////////////////
+void t_rnxNavFile::buildIndex() {
+
+  _indexed = true;
+
+  _timeIndex.clear();
+  _timeIndex.reserve(_ephs.size());
+  for (unsigned ii = 0; ii < _ephs.size(); ii++) {
+    if (_ephs[ii]) {
+      _timeIndex.push_back(ii);
+    }
+  }
+  std::stable_sort(_timeIndex.begin(), _timeIndex.end(), t_earlierTOC(_ephs));
+  _timeCursor = 0;
+
+  _iodIndex.clear();
+  for (unsigned ii = 0; ii < _timeIndex.size(); ii++) {
+    const t_eph* eph = _ephs[_timeIndex[ii]];
+    QPair<QString, unsigned int> key(QString(eph->prn().toInternalString().c_str()), eph->IOD());
+    _iodIndex[key]._index.push_back(_timeIndex[ii]);
+  }
+}
+
+// Hand over one ephemeris to the caller
+////////////////////////////////////////////////////////////////////////////
+t_eph* t_rnxNavFile::release(unsigned index) {
+  t_eph* eph = _ephs[index];
+  _ephs[index] = 0;
+  ++_numReleased;
+  return eph;
+}
+
+// Read Next Ephemeris (the caller takes ownership)
 ////////////////////////////////////////////////////////////////////////////
 t_eph* t_rnxNavFile::getNextEph(const bncTime& tt,
                                 const QMap<QString, unsigned int>* corrIODs) {
 
+  if (!_indexed) {
+    buildIndex();
+  }
+
   // Get Ephemeris according to IOD
   // ------------------------------
   if (corrIODs) {
     QMapIterator<QString, unsigned int> itIOD(*corrIODs);
     while (itIOD.hasNext()) {
       itIOD.next();
-      QString prn = itIOD.key();
-      unsigned int iod = itIOD.value();
-      vector<t_eph*>::iterator it = _ephs.begin();
-      while (it != _ephs.end()) {
-        t_eph* eph = *it;
-        double dt = eph->TOC() - tt;
-        if (dt < 8*3600.0 && QString(eph->prn().toInternalString().c_str()) == prn && eph->IOD() == iod) {
-          it = _ephs.erase(it);
-          return eph;
+      QMap<QPair<QString, unsigned int>, t_iodEphs>::iterator it =
+        _iodIndex.find(QPair<QString, unsigned int>(itIOD.key(), itIOD.value()));
+      if (it == _iodIndex.end()) {
+        continue;
+      }
+      t_iodEphs& iodEphs = it.value();
+      while (iodEphs._cursor < iodEphs._index.size() &&
+             _ephs[iodEphs._index[iodEphs._cursor]] == 0) {
+        ++iodEphs._cursor;
+      }
+      if (iodEphs._cursor < iodEphs._index.size()) {
+        unsigned index = iodEphs._index[iodEphs._cursor];
+        double dt = _ephs[index]->TOC() - tt;
+        if (dt < 8*3600.0) {
+          ++iodEphs._cursor;
+          return release(index);
         }
-        ++it;
       }
     }
   }
@@ -249,15 +325,16 @@ t_eph* t_rnxNavFile::getNextEph(const bncTime& tt,
   // Get Ephemeris according to time
   // -------------------------------
   else {
-    vector<t_eph*>::iterator it = _ephs.begin();
-    while (it != _ephs.end()) {
-      t_eph* eph = *it;
-      double dt = eph->TOC() - tt;
+    while (_timeCursor < _timeIndex.size() && _ephs[_timeIndex[_timeCursor]] == 0) {
+      ++_timeCursor;
+    }
+    if (_timeCursor < _timeIndex.size()) {
+      unsigned index = _timeIndex[_timeCursor];
+      double dt = _ephs[index]->TOC() - tt;
       if (dt < 2*3600.0) {
-        it = _ephs.erase(it);
-        return eph;
+        ++_timeCursor;
+        return release(index);
       }
-      ++it;
     }
   }
 
@@ -56,7 +56,7 @@ class t_rnxNavFile {
   t_rnxNavFile(const QString& fileName, e_inpOut inpOut);
   ~t_rnxNavFile();
   t_eph* getNextEph(const bncTime& tt, const QMap<QString, unsigned int>* corrIODs);
-  const std::vector<t_eph*> ephs() const {return _ephs;}
+  const std::vector<t_eph*> ephs() const;
   double version() const {return _header._version;}
   void   setVersion(double version) {_header._version = version;}
   bool   glonass() const {return _header._glonass;}
@@ -72,14 +72,28 @@ class t_rnxNavFile {
   void close();
 
  private:
+  class t_iodEphs {
+   public:
+    t_iodEphs() {_cursor = 0;}
+    std::vector<unsigned> _index;  // positions in _ephs, sorted by TOC
+    unsigned              _cursor; // first entry not yet released
+  };
+
   void read(QTextStream* stream);
+  void buildIndex();
+  t_eph* release(unsigned index);
 
-  e_inpOut            _inpOut;
-  QFile*              _file;
-  QString             _fileName;
-  QTextStream*        _stream;
-  std::vector<t_eph*> _ephs;
-  t_rnxNavHeader      _header;
+  e_inpOut                                      _inpOut;
+  QIODevice*                                    _file;
+  QString                                       _fileName;
+  QTextStream*                                  _stream;
+  std::vector<t_eph*>                           _ephs;        // 0: released by getNextEph
+  unsigned                                      _numReleased;
+  bool                                          _indexed;
+  std::vector<unsigned>                         _timeIndex;   // positions in _ephs, sorted by TOC
+  unsigned                                      _timeCursor;
+  QMap<QPair<QString, unsigned int>, t_iodEphs> _iodIndex;    // key: internal PRN string, IOD
+  t_rnxNavHeader                                _header;
 };
 
 #endif
@@ -41,13 +41,86 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include "rnxobsfile.h"
 #include "bncutils.h"
+#include "bncgzip.h"
 #include "bnccore.h"
 #include "bncsettings.h"
 
 using namespace std;
 
+// Read fixed-column fields without creating QStrings (same results as
+// readInt/readDbl: blanks are skipped, invalid fields give zero)
+////////////////////////////////////////////////////////////////////////////
+static bool copyField(const char* line, int len, int pos, int fldLen,
+                      char* buffer, int bufSize) {
+  int nn = 0;
+  for (int ii = pos; ii < pos + fldLen && ii < len && nn < bufSize - 1; ii++) {
+    if (line[ii] != ' ') {
+      buffer[nn++] = line[ii];
+    }
+    else if (nn > 0 && ii + 1 < len && ii + 1 < pos + fldLen && line[ii+1] != ' ') {
+      return false; // embedded blank
+    }
+  }
+  buffer[nn] = '\0';
+  return nn > 0;
+}
+
+static int fieldToInt(const char* line, int len, int pos, int fldLen, int& value) {
+  char buffer[32];
+  value = 0;
+  if (!copyField(line, len, pos, fldLen, buffer, sizeof(buffer))) {
+    return 1;
+  }
+  char* end;
+  long hlp = strtol(buffer, &end, 10);
+  if (*end != '\0') {
+    return 1;
+  }
+  value = hlp;
+  return 0;
+}
+
+// Number conversion independent of the locale (set by QCoreApplication),
+// the number ends at the first blank or at the end of the string
+static double strToDbl(const char* str, const char** end, bool* ok) {
+  while (*str == ' ') {
+    ++str;
+  }
+  const char* pp = str;
+  while (*pp != '\0' && *pp != ' ') {
+    ++pp;
+  }
+  *end = pp;
+  return QByteArray::fromRawData(str, pp - str).toDouble(ok);
+}
+
+static int fieldToDbl(const char* line, int len, int pos, int fldLen, double& value) {
+  char buffer[32];
+  value = 0.0;
+  if (!copyField(line, len, pos, fldLen, buffer, sizeof(buffer))) {
+    return 1;
+  }
+  for (char* pp = buffer; *pp; pp++) {
+    if (*pp == 'D' || *pp == 'd' || *pp == 'E') {
+      *pp = 'e';
+    }
+  }
+  const char* end;
+  bool ok;
+  double hlp = strToDbl(buffer, &end, &ok);
+  if (!ok || *end != '\0') {
+    return 1;
+  }
+  value = hlp;
+  return 0;
+}
+
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 t_rnxObsHeader::t_rnxObsHeader() {
@@ -971,6 +1044,13 @@ t_rnxObsFile::t_rnxObsFile(const QString& fileName, e_inpOut inpOut) {
   _inpOut       = inpOut;
   _stream       = 0;
   _flgPowerFail = false;
+  _mapData      = 0;
+  _mapSize      = 0;
+  _mapPos       = 0;
+  _typesGen     = 0;
+  _indexed      = false;
+  _idxEnd       = 0;
+  _idxSeekable  = false;
   if (_inpOut == input) {
     openRead(fileName);
   }
@@ -984,12 +1064,13 @@ t_rnxObsFile::t_rnxObsFile(const QString& fileName, e_inpOut inpOut) {
 void t_rnxObsFile::openRead(const QString& fileName) {
 
   _fileName = fileName; expandEnvVar(_fileName);
-  _file     = new QFile(_fileName);
+  _file     = createFileDevice(_fileName);
   _file->open(QIODevice::ReadOnly | QIODevice::Text);
   _stream = new QTextStream();
   _stream->setDevice(_file);
 
   _header.read(_stream);
+  mapFile();
 
   // Guess Observation Interval
   // --------------------------
@@ -1010,6 +1091,7 @@ void t_rnxObsFile::openRead(const QString& fileName) {
     }
     _stream->seek(0);
     _header.read(_stream);
+    rewindMapped();
   }
 
   // Time of first observation
@@ -1022,7 +1104,67 @@ void t_rnxObsFile::openRead(const QString& fileName) {
     _header._startTime = rnxEpo->tt;
     _stream->seek(0);
     _header.read(_stream);
+    rewindMapped();
+  }
+}
+
+// Map RINEX 3 files into memory (plain files only)
+////////////////////////////////////////////////////////////////////////////
+void t_rnxObsFile::mapFile() {
+  QFile* file = qobject_cast<QFile*>(_file);
+  if (version() < 3.0 || !file || file->size() == 0) {
+    return;
+  }
+  uchar* data = file->map(0, file->size());
+  if (data) {
+    _mapData = reinterpret_cast<const char*>(data);
+    _mapSize = file->size();
+    rewindMapped();
+  }
+}
+
+// Position of the first data record in the mapped file
+////////////////////////////////////////////////////////////////////////////
+void t_rnxObsFile::rewindMapped() {
+  if (!_mapData) {
+    return;
+  }
+  ++_typesGen;
+  _mapPos = 0;
+  const char* line;
+  int         len;
+  while (nextMappedLine(line, len)) {
+    if (len > 60) {
+      QByteArray key = QByteArray::fromRawData(line + 60, len - 60).trimmed();
+      if (key == "END OF HEADER") {
+        return;
+      }
+    }
+  }
+}
+
+// Next line of the mapped file (no copy, line terminators removed)
+////////////////////////////////////////////////////////////////////////////
+bool t_rnxObsFile::nextMappedLine(const char*& line, int& len) {
+  if (_mapPos >= _mapSize) {
+    line = "";
+    len  = 0;
+    return false;
+  }
+  line = _mapData + _mapPos;
+  const char* end = static_cast<const char*>(memchr(line, '\n', _mapSize - _mapPos));
+  if (end) {
+    len      = end - line;
+    _mapPos += len + 1;
+  }
+  else {
+    len     = _mapSize - _mapPos;
+    _mapPos = _mapSize;
   }
+  if (len > 0 && line[len-1] == '\r') {
+    --len;
+  }
+  return true;
 }
 
 // Open for output
@@ -1030,7 +1172,7 @@ void t_rnxObsFile::openRead(const QString& fileName) {
 void t_rnxObsFile::openWrite(const QString& fileName) {
 
   _fileName = fileName; expandEnvVar(_fileName);
-  _file     = new QFile(_fileName);
+  _file     = createFileDevice(_fileName);
   _file->open(QIODevice::WriteOnly | QIODevice::Text);
   _stream = new QTextStream();
   _stream->setDevice(_file);
@@ -1045,6 +1187,7 @@ t_rnxObsFile::~t_rnxObsFile() {
 // Close
 ////////////////////////////////////////////////////////////////////////////
 void t_rnxObsFile::close() {
+  _mapData = 0; // unmapped by QFile
   delete _stream; _stream = 0;
   delete _file;   _file = 0;
 }
@@ -1099,6 +1242,10 @@ void t_rnxObsFile::handleEpochFlag(int flag, const QString& line,
 // Retrieve single Epoch
 ////////////////////////////////////////////////////////////////////////////
 t_rnxObsFile::t_rnxEpo* t_rnxObsFile::nextEpoch() {
+  if (_mapData && version() >= 3.0) {
+    _currEpo.tt.reset(); // satellite storage is re-used
+    return nextEpochV3Mapped();
+  }
   _currEpo.clear();
   if (version() < 3.0) {
     return nextEpochV2();
@@ -1179,6 +1326,332 @@ t_rnxObsFile::t_rnxEpo* t_rnxObsFile::nextEpochV3() {
   return 0;
 }
 
+// Line reader used for indexing (mapped file or separate input device)
+////////////////////////////////////////////////////////////////////////////
+class t_idxLineReader {
+ public:
+  t_idxLineReader(const char* mapData, qint64 mapSize, QIODevice* device) {
+    _mapData = mapData;
+    _mapSize = mapSize;
+    _device  = device;
+    _pos     = 0;
+    _buffer.resize(4096);
+  }
+  qint64 pos() const {return _pos;}
+  bool next(qint64& offset, const char*& line, int& len) {
+    offset = _pos;
+    if (_mapData) {
+      if (_pos >= _mapSize) {
+        return false;
+      }
+      line = _mapData + _pos;
+      const char* end = static_cast<const char*>(memchr(line, '\n', _mapSize - _pos));
+      len  = end ? end - line : _mapSize - _pos;
+      _pos += end ? len + 1 : len;
+    }
+    else {
+      len = 0;
+      while (true) {
+        if (_buffer.size() - len < 2) {
+          _buffer.resize(2 * _buffer.size());
+        }
+        qint64 nRead = _device->readLine(_buffer.data() + len, _buffer.size() - len);
+        if (nRead <= 0) {
+          if (len == 0) {
+            return false;
+          }
+          break;
+        }
+        _pos += nRead;
+        len  += nRead;
+        if (_buffer[len-1] == '\n') {
+          --len;
+          break;
+        }
+      }
+      line = _buffer.constData();
+    }
+    if (len > 0 && line[len-1] == '\r') {
+      --len;
+    }
+    return true;
+  }
+ private:
+  const char* _mapData;
+  qint64      _mapSize;
+  QIODevice*  _device;
+  qint64      _pos;
+  QByteArray  _buffer;
+};
+
+static bool earlierIndex(const t_rnxObsFile::t_epoIndex& idx, const bncTime& tt) {
+  return idx.tt < tt;
+}
+
+// Build the epoch index (byte offset of each epoch) in a single pass; the
+// index serves seek() only, a file is not split into time ranges processed
+// in parallel as the quality check needs the complete satellite arcs
+////////////////////////////////////////////////////////////////////////////
+t_irc t_rnxObsFile::buildIndex() {
+
+  if (_inpOut != input) {
+    return failure;
+  }
+
+  _epoIndex.clear();
+  _idxSeekable = true;
+
+  QIODevice* device = 0;
+  if (!_mapData) {
+    device = createFileDevice(_fileName);
+    if (!device->open(QIODevice::ReadOnly)) {
+      delete device;
+      return failure;
+    }
+  }
+  t_idxLineReader reader(_mapData, _mapSize, device);
+
+  int linesPerSat = 1;
+  if (version() < 3.0 && numSys() > 0) {
+    int nTypesV2 = nTypes(system(0));
+    if (nTypesV2 > 5) {
+      linesPerSat = (nTypesV2 + 4) / 5;
+    }
+  }
+
+  bool        inHeader = true;
+  qint64      offset;
+  const char* line;
+  int         len;
+  while (reader.next(offset, line, len)) {
+
+    if (inHeader) {
+      if (len > 60 && QByteArray::fromRawData(line + 60, len - 60).trimmed() == "END OF HEADER") {
+        inHeader = false;
+      }
+      continue;
+    }
+    if (len == 0) {
+      continue;
+    }
+
+    int flag     = 0;
+    int numSat   = 0;
+    int numLines = 0;
+    if (version() >= 3.0) {
+      if (line[0] != '>') {
+        continue;
+      }
+      fieldToInt(line, len, 31, 1, flag);
+      fieldToInt(line, len, 32, 3, numSat);
+      numLines = numSat;
+    }
+    else {
+      fieldToInt(line, len, 28, 1, flag);
+      fieldToInt(line, len, 29, 3, numSat);
+      numLines = (flag > 1) ? numSat : (numSat > 0 ? (numSat - 1) / 12 : 0) + numSat * linesPerSat;
+    }
+
+    if (flag <= 1) {
+      char epoStr[128];
+      int  skip   = (version() >= 3.0) ? 1 : 0;
+      int  epoLen = qMin(len - skip, int(sizeof(epoStr)) - 1);
+      memcpy(epoStr, line + skip, epoLen);
+      epoStr[epoLen] = '\0';
+      char*  ptr   = epoStr;
+      int    year  = strtol(ptr, &ptr, 10);
+      int    month = strtol(ptr, &ptr, 10);
+      int    day   = strtol(ptr, &ptr, 10);
+      int    hour  = strtol(ptr, &ptr, 10);
+      int    min   = strtol(ptr, &ptr, 10);
+      const char* end;
+      bool   ok;
+      double sec   = strToDbl(ptr, &end, &ok);
+      if (version() < 3.0) {
+        if      (year <  80) {
+          year += 2000;
+        }
+        else if (year < 100) {
+          year += 1900;
+        }
+      }
+      t_epoIndex idx;
+      idx.tt.set(year, month, day, hour, min, sec);
+      idx.offset = offset;
+      if (!_epoIndex.empty() && idx.tt <= _epoIndex.back().tt) {
+        _idxSeekable = false;
+      }
+      _epoIndex.push_back(idx);
+    }
+    else if (flag == 3 || flag == 4) {
+      _idxSeekable = false; // header changes in the data section
+    }
+
+    for (int ii = 0; ii < numLines; ii++) {
+      if (!reader.next(offset, line, len)) {
+        break;
+      }
+    }
+  }
+
+  _idxEnd  = reader.pos();
+  _indexed = true;
+  delete device;
+
+  return success;
+}
+
+// Position the file such that nextEpoch returns the first epoch >= tt
+////////////////////////////////////////////////////////////////////////////
+t_irc t_rnxObsFile::seek(const bncTime& tt) {
+
+  if (_inpOut != input) {
+    return failure;
+  }
+  if (!_indexed && buildIndex() != success) {
+    return failure;
+  }
+  if (!_idxSeekable) {
+    return failure;
+  }
+
+  std::vector<t_epoIndex>::const_iterator it =
+    std::lower_bound(_epoIndex.begin(), _epoIndex.end(), tt, earlierIndex);
+  qint64 offset = (it == _epoIndex.end()) ? _idxEnd : it->offset;
+
+  if (_mapData) {
+    _mapPos = offset;
+  }
+  else if (!_stream->seek(offset)) {
+    return failure;
+  }
+  _flgPowerFail = false;
+
+  return success;
+}
+
+// Retrieve single Epoch (RINEX Version 3, memory-mapped file)
+////////////////////////////////////////////////////////////////////////////
+t_rnxObsFile::t_rnxEpo* t_rnxObsFile::nextEpochV3Mapped() {
+
+  const char* line;
+  int         len;
+
+  while (nextMappedLine(line, len)) {
+
+    if (len == 0) {
+      continue;
+    }
+
+    // Special events are handled by the stream-based code
+    // ---------------------------------------------------
+    int flag = 0;
+    fieldToInt(line, len, 31, 1, flag);
+    if (flag > 0) {
+      int         restSize = int(qMin(_mapSize - _mapPos, qint64(INT_MAX)));
+      QByteArray  rest     = QByteArray::fromRawData(_mapData + _mapPos, restSize);
+      QTextStream restStream(&rest, QIODevice::ReadOnly);
+      QTextStream* fileStream = _stream;
+      bool headerReRead = false;
+      _stream = &restStream;
+      try {
+        handleEpochFlag(flag, QString::fromLatin1(line, len), headerReRead);
+      }
+      catch (...) {
+        _stream = fileStream;
+        throw;
+      }
+      _stream  = fileStream;
+      _mapPos += restStream.pos();
+      if (headerReRead) {
+        ++_typesGen;
+        continue;
+      }
+    }
+
+    // Epoch Time
+    // ----------
+    char epoStr[128];
+    int  epoLen = qMin(len - 1, int(sizeof(epoStr)) - 1);
+    memcpy(epoStr, line + 1, epoLen);
+    epoStr[epoLen] = '\0';
+    char*  ptr   = epoStr;
+    int    year  = strtol(ptr, &ptr, 10);
+    int    month = strtol(ptr, &ptr, 10);
+    int    day   = strtol(ptr, &ptr, 10);
+    int    hour  = strtol(ptr, &ptr, 10);
+    int    min   = strtol(ptr, &ptr, 10);
+    const char* end;
+    bool   ok;
+    double sec   = strToDbl(ptr, &end, &ok);
+    _currEpo.tt.set(year, month, day, hour, min, sec);
+
+    // Number of Satellites
+    // --------------------
+    int numSat = 0;
+    fieldToInt(line, len, 32, 3, numSat);
+
+    _currEpo.rnxSat.resize(numSat);
+    if (int(_obsSlots.size()) < numSat) {
+      _obsSlots.resize(numSat);
+    }
+
+    // Observations
+    // ------------
+    for (int iSat = 0; iSat < numSat; iSat++) {
+      nextMappedLine(line, len);
+      t_rnxSat& rnxSat = _currEpo.rnxSat[iSat];
+      rnxSat.prn.set(std::string(line, qMin(len, 3)));
+      char sys    = rnxSat.prn.system();
+      int  nTypes = _header.nTypes(sys);
+
+      // (Re-)Build the type index --> observation table of the slot
+      // -----------------------------------------------------------
+      t_obsSlot& slot = _obsSlots[iSat];
+      if (slot.sys != sys || slot.gen != _typesGen || int(slot.obs.size()) != nTypes ||
+          !rnxSat.obs.isDetached() || rnxSat.obs.size() != slot.nKeys) {
+        rnxSat.obs.clear();
+        slot.obs.resize(nTypes);
+        for (int iType = 0; iType < nTypes; iType++) {
+          slot.obs[iType] = &rnxSat.obs[obsType(sys, iType)];
+        }
+        slot.sys   = sys;
+        slot.gen   = _typesGen;
+        slot.nKeys = rnxSat.obs.size();
+      }
+
+      for (int iType = 0; iType < nTypes; iType++) {
+        int pos = 3 + 16*iType;
+        double obsValue = 0.0;
+        int    lli      = 0;
+        int    snr      = 0;
+        fieldToDbl(line, len, pos,      14, obsValue);
+        fieldToInt(line, len, pos + 14,  1, lli);
+        fieldToInt(line, len, pos + 15,  1, snr);
+        if (_flgPowerFail) {
+          lli |= 1;
+        }
+        t_rnxObs* rnxObs = slot.obs[iType];
+        rnxObs->value = obsValue;
+        rnxObs->lli   = lli;
+        rnxObs->snr   = snr;
+      }
+    }
+
+    // Slots beyond the current number of satellites were destroyed
+    // ------------------------------------------------------------
+    for (unsigned iSlot = numSat; iSlot < _obsSlots.size(); iSlot++) {
+      _obsSlots[iSlot].sys = ' ';
+    }
+
+    _flgPowerFail = false;
+
+    return &_currEpo;
+  }
+
+  return 0;
+}
+
 // Retrieve single Epoch (RINEX Version 2)
 ////////////////////////////////////////////////////////////////////////////
 t_rnxObsFile::t_rnxEpo* t_rnxObsFile::nextEpochV2() {
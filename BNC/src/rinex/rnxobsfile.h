@@ -136,6 +136,12 @@ class t_rnxObsFile {
     std::vector<t_rnxSat> rnxSat;
   };
 
+  class t_epoIndex {
+   public:
+    bncTime tt;
+    qint64  offset;
+  };
+
   enum e_inpOut {input, output};
 
   t_rnxObsFile(const QString& fileName, e_inpOut inpOut);
@@ -183,6 +189,9 @@ class t_rnxObsFile {
 
   t_rnxEpo* nextEpoch();
 
+  t_irc buildIndex();
+  t_irc seek(const bncTime& tt);
+
   int wlFactorL1(unsigned iPrn) {
     return iPrn <= t_prn::MAXPRN_GPS ? _header._wlFactorsL1[iPrn] : 1;
   }
@@ -244,15 +253,39 @@ class t_rnxObsFile {
   void close();
   t_rnxEpo* nextEpochV2();
   t_rnxEpo* nextEpochV3();
+  t_rnxEpo* nextEpochV3Mapped();
   void handleEpochFlag(int flag, const QString& line, bool& headerReRead);
+  void mapFile();
+  void rewindMapped();
+  bool nextMappedLine(const char*& line, int& len);
+
+  // Observation slots of a mapped file (indexed by header type index)
+  // ------------------------------------------------------------------
+  class t_obsSlot {
+   public:
+    t_obsSlot() {sys = ' '; gen = -1; nKeys = 0;}
+    char                   sys;
+    int                    gen;
+    int                    nKeys;
+    std::vector<t_rnxObs*> obs;
+  };
 
-  e_inpOut       _inpOut;
-  QFile*         _file;
-  QString        _fileName;
-  QTextStream*   _stream;
-  t_rnxObsHeader _header;
-  t_rnxEpo       _currEpo;
-  bool           _flgPowerFail;
+  e_inpOut                _inpOut;
+  QIODevice*              _file;
+  QString                 _fileName;
+  QTextStream*            _stream;
+  t_rnxObsHeader          _header;
+  t_rnxEpo                _currEpo;
+  bool                    _flgPowerFail;
+  const char*             _mapData;
+  qint64                  _mapSize;
+  qint64                  _mapPos;
+  int                     _typesGen;
+  std::vector<t_obsSlot>  _obsSlots;
+  std::vector<t_epoIndex> _epoIndex;
+  bool                    _indexed;
+  qint64                  _idxEnd;
+  bool                    _idxSeekable;
 };
 
 #endif
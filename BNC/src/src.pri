@@ -35,9 +35,10 @@ INCLUDEPATH += . ../newmat ./RTCM3 ./RTCM3/clock_and_orbit ./RTCM \
 
 # Additional Libraries
 # --------------------
-unix:LIBS  += -L../newmat -lnewmat -L../qwt -L../qwtpolar -lqwtpolar -lqwt
+unix:LIBS  += -L../newmat -lnewmat -L../qwt -L../qwtpolar -lqwtpolar -lqwt \
+              -lz
 win32:LIBS += -L../newmat/release -L../qwt/release -L../qwtpolar/release \
-              -lnewmat -lqwtpolar -lqwt
+              -lnewmat -lqwtpolar -lqwt -lz
 
 HEADERS = bnchelp.html bncgetthread.h    bncwindow.h   bnctabledlg.h  \
           bnccaster.h bncrinex.h bnccore.h bncutils.h   bnchlpdlg.h   \
@@ -51,13 +52,16 @@ HEADERS = bnchelp.html bncgetthread.h    bncwindow.h   bnctabledlg.h  \
           bncfigureppp.h bncrawfile.h                                 \
           bncmap.h bncantex.h bncephuser.h                            \
           bncoutf.h bncclockrinex.h bncsp3.h bncsinextro.h            \
+          bncgzip.h bncsatcache.h bncbincache.h                       \
           bncbytescounter.h bncsslconfig.h reqcdlg.h                  \
           upload/bncrtnetdecoder.h upload/bncuploadcaster.h           \
           ephemeris.h t_prn.h satObs.h                                \
           upload/bncrtnetuploadcaster.h upload/bnccustomtrafo.h       \
+          upload/bncrtnetparser.h                                     \
           upload/bncephuploadcaster.h qtfilechooser.h                 \
           GPSDecoder.h pppInclude.h pppWidgets.h pppModel.h           \
           pppMain.h pppRun.h pppOptions.h pppCrdFile.h pppThread.h    \
+          pppDispatcher.h pppBatch.h                                  \
           RTCM/RTCM2.h RTCM/RTCM2Decoder.h                            \
           RTCM/RTCM2_2021.h RTCM/rtcm_utils.h                         \
           RTCM3/RTCM3Decoder.h RTCM3/bits.h RTCM3/gnss.h              \
@@ -87,14 +91,16 @@ SOURCES = bncgetthread.cpp  bncwindow.cpp bnctabledlg.cpp             \
           bncfigureppp.cpp bncrawfile.cpp                             \
           bncmap_svg.cpp bncantex.cpp bncephuser.cpp                  \
           bncoutf.cpp bncclockrinex.cpp bncsp3.cpp bncsinextro.cpp    \
+          bncgzip.cpp bncsatcache.cpp bncbincache.cpp                 \
           bncbytescounter.cpp bncsslconfig.cpp reqcdlg.cpp            \
           ephemeris.cpp t_prn.cpp satObs.cpp                          \
           upload/bncrtnetdecoder.cpp upload/bncuploadcaster.cpp       \
           upload/bncrtnetuploadcaster.cpp upload/bnccustomtrafo.cpp   \
+          upload/bncrtnetparser.cpp                                   \
           upload/bncephuploadcaster.cpp qtfilechooser.cpp             \
           GPSDecoder.cpp pppWidgets.cpp pppModel.cpp                  \
           pppMain.cpp pppRun.cpp pppOptions.cpp pppCrdFile.cpp        \
-          pppThread.cpp                                               \
+          pppThread.cpp pppDispatcher.cpp pppBatch.cpp                \
           RTCM/RTCM2.cpp RTCM/RTCM2Decoder.cpp                        \
           RTCM/RTCM2_2021.cpp RTCM/rtcm_utils.cpp                     \
           RTCM3/RTCM3Decoder.cpp                                      \
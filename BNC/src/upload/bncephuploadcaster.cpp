@@ -76,7 +76,8 @@ void bncEphUploadCaster::ephBufferChanged() {
 
       QListIterator<QString> it(prnList());
       while (it.hasNext()) {
-        const t_eph* eph = ephLast(it.next());
+        QSharedPointer<const t_eph> ephShared = ephLast(it.next());
+        const t_eph* eph = ephShared.data();
 
         bncTime toc = eph->TOC();
         double timeDiff = fabs(toc - currentTime);
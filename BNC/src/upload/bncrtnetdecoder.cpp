@@ -49,6 +49,8 @@ using namespace std;
 bncRtnetDecoder::bncRtnetDecoder() {
   bncSettings settings;
 
+  _pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
   // List of upload casters
   // ----------------------
   int iRow = -1;
@@ -95,8 +97,15 @@ bncRtnetDecoder::~bncRtnetDecoder() {
 ////////////////////////////////////////////////////////////////////////
 t_irc bncRtnetDecoder::Decode(char* buffer, int bufLen, vector<string>& errmsg) {
   errmsg.clear();
-  for (int ic = 0; ic < _casters.size(); ic++) {
-    _casters[ic]->decodeRtnetStream(buffer, bufLen);
+
+  // Parse once, share the complete epochs with all casters
+  // ------------------------------------------------------
+  QList<QSharedPointer<const t_rtnetEpoch> > epochs;
+  _parser.input(buffer, bufLen, epochs);
+  for (int iEpo = 0; iEpo < epochs.size(); iEpo++) {
+    for (int ic = 0; ic < _casters.size(); ic++) {
+      _casters[ic]->decodeRtnetEpoch(epochs[iEpo], &_pool);
+    }
   }
   return success;
 }
@@ -28,6 +28,7 @@
 #include <fstream>
 #include <QtCore>
 #include "bncrtnetuploadcaster.h"
+#include "bncrtnetparser.h"
 #include "GPSDecoder.h"
 
 class bncRtnetDecoder: public GPSDecoder {
@@ -37,7 +38,9 @@ class bncRtnetDecoder: public GPSDecoder {
   virtual t_irc Decode(char* buffer, int bufLen, 
                        std::vector<std::string>& errmsg);
  private:
+  bncRtnetParser                 _parser;
   QVector<bncRtnetUploadCaster*> _casters;
+  QThreadPool                    _pool;     // satellite tasks of all casters
 };
 
 #endif  // include blocker
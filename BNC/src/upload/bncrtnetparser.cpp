@@ -0,0 +1,380 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+/* -------------------------------------------------------------------------
+ * BKG NTRIP Client
+ * -------------------------------------------------------------------------
+ *
+ * Class:      bncRtnetParser
+ *
+ * Purpose:    Incremental parser of the RTNet (SP3-like) stream; every byte
+ *             is scanned once, complete epochs are returned as typed
+ *             structures shared by all upload casters
+ *
+ * Created:    18-Oct-2026
+ *
+ * Changes:
+ *
+ * -----------------------------------------------------------------------*/
+
+#include <math.h>
+#include <string.h>
+#include "bncrtnetparser.h"
+
+using namespace std;
+
+// Next blank-separated token of a line
+////////////////////////////////////////////////////////////////////////////
+static bool nextToken(const char*& pos, const char* end,
+                      const char*& tok, int& len) {
+  while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) {
+    ++pos;
+  }
+  if (pos == end) {
+    return false;
+  }
+  tok = pos;
+  while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r') {
+    ++pos;
+  }
+  len = pos - tok;
+  return true;
+}
+
+// Token to double, independent of the locale (exact for up to 15 decimal
+// digits, other formats are passed to QByteArray::toDouble)
+////////////////////////////////////////////////////////////////////////////
+static bool toDouble(const char* tok, int len, double& val) {
+
+  static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,
+                                 1e7,  1e8,  1e9,  1e10, 1e11, 1e12, 1e13,
+                                 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+                                 1e21, 1e22};
+  const char* pp  = tok;
+  const char* end = tok + len;
+
+  bool neg = false;
+  if (pp < end && (*pp == '-' || *pp == '+')) {
+    neg = (*pp == '-');
+    ++pp;
+  }
+
+  quint64 mant    = 0;
+  int     nSig    = 0;   // significant digits in mant
+  int     nDigits = 0;
+  int     exp10   = 0;
+  for (; pp < end && *pp >= '0' && *pp <= '9'; ++pp, ++nDigits) {
+    if (nSig < 19) {
+      mant = 10 * mant + (*pp - '0');
+      if (mant != 0) {
+        ++nSig;
+      }
+    }
+    else {
+      ++exp10;
+    }
+  }
+  if (pp < end && *pp == '.') {
+    ++pp;
+    for (; pp < end && *pp >= '0' && *pp <= '9'; ++pp, ++nDigits) {
+      if (nSig < 19) {
+        mant = 10 * mant + (*pp - '0');
+        if (mant != 0) {
+          ++nSig;
+        }
+        --exp10;
+      }
+    }
+  }
+
+  if (pp == end && nDigits > 0 && mant < (Q_UINT64_C(1) << 53) &&
+      exp10 >= -22 && exp10 <= 22) {
+    double dd = double(mant);
+    dd  = (exp10 < 0) ? dd / pow10[-exp10] : dd * pow10[exp10];
+    val = neg ? -dd : dd;
+    return true;
+  }
+
+  bool   ok;
+  double dd = QByteArray(tok, len).toDouble(&ok);
+  if (ok) {
+    val = dd;
+  }
+  return ok;
+}
+
+// Next token as a number
+////////////////////////////////////////////////////////////////////////////
+static bool nextDouble(const char*& pos, const char* end, double& val) {
+  const char* tok;
+  int         len;
+  return nextToken(pos, end, tok, len) && toDouble(tok, len, val);
+}
+
+// Vector of numVal values (at most 3 are kept)
+////////////////////////////////////////////////////////////////////////////
+static bool nextVector(const char*& pos, const char* end, int numVal,
+                       ColumnVector& vec) {
+  vec.ReSize(3);
+  vec = 0.0;
+  for (int ii = 0; ii < numVal; ii++) {
+    double hlp;
+    if (!nextDouble(pos, end, hlp)) {
+      return false;
+    }
+    if (ii < 3) {
+      vec[ii] = hlp;
+    }
+  }
+  return true;
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+t_rtnetEpoch::t_rtnetEpoch() {
+  _dispersiveBiasConsistencyIndicator = 0;
+  _mwConsistencyIndicator             = 0;
+  _vtecUpdateInt                      = 0.0;
+  _numLines                           = 0;
+  memset(&_vtec, 0, sizeof(_vtec));
+}
+
+// Constructor
+////////////////////////////////////////////////////////////////////////////
+bncRtnetParser::bncRtnetParser() {
+  _line.reserve(4096);   // keeps the capacity when the line is reset
+}
+
+// Destructor
+////////////////////////////////////////////////////////////////////////////
+bncRtnetParser::~bncRtnetParser() {
+}
+
+// Append new data, return the epochs completed by them
+////////////////////////////////////////////////////////////////////////////
+void bncRtnetParser::input(const char* buffer, int bufLen,
+                           QList<QSharedPointer<const t_rtnetEpoch> >& epochs) {
+
+  const char* pos = buffer;
+  const char* end = buffer + bufLen;
+  while (pos < end) {
+    const char* eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+    if (eol == 0) {
+      _line.append(pos, end - pos);
+      break;
+    }
+    _line.append(pos, eol - pos);
+    parseLine(epochs);
+    _line.resize(0);
+    pos = eol + 1;
+  }
+}
+
+// Parse one complete line
+////////////////////////////////////////////////////////////////////////////
+void bncRtnetParser::parseLine(QList<QSharedPointer<const t_rtnetEpoch> >& epochs) {
+
+  const char* pos = _line.constData();
+  const char* end = pos + _line.size();
+  const char* tok;
+  int         len;
+
+  if (!nextToken(pos, end, tok, len)) {
+    return;
+  }
+
+  // Epoch line (an incomplete previous epoch is dropped)
+  // ----------------------------------------------------
+  if (tok[0] == '*') {
+    _epoch.clear();
+    double year, month, day, hour, min, sec;
+    if (nextDouble(pos, end, year) && nextDouble(pos, end, month) &&
+        nextDouble(pos, end, day)  && nextDouble(pos, end, hour)  &&
+        nextDouble(pos, end, min)  && nextDouble(pos, end, sec)) {
+      _epoch = QSharedPointer<t_rtnetEpoch>(new t_rtnetEpoch());
+      _epoch->_time.set(int(year), int(month), int(day), int(hour), int(min), sec);
+    }
+    return;
+  }
+
+  if (!_epoch) {
+    return;
+  }
+
+  // End of epoch
+  // ------------
+  if (len >= 3 && strncmp(tok, "EOE", 3) == 0) {
+    if (_epoch->_numLines > 0) {
+      epochs.append(_epoch);
+    }
+    _epoch.clear();
+    return;
+  }
+
+  _epoch->_numLines += 1;
+
+  QByteArray key = QByteArray::fromRawData(tok, len);
+
+  // Non-satellite specific parameters
+  // ---------------------------------
+  if (key.contains("IND")) {
+    double dispersive, mw;
+    if (nextDouble(pos, end, dispersive) && nextDouble(pos, end, mw)) {
+      _epoch->_dispersiveBiasConsistencyIndicator = unsigned(dispersive);
+      _epoch->_mwConsistencyIndicator             = unsigned(mw);
+    }
+    return;
+  }
+  if (key.contains("VTEC")) {
+    parseVtec(pos, end);
+    return;
+  }
+
+  // Satellite specific parameters
+  // -----------------------------
+  char sys    = tok[0];
+  int  number = 0;
+  for (int ii = 1; ii < len && ii <= 2 && tok[ii] >= '0' && tok[ii] <= '9'; ii++) {
+    number = 10 * number + (tok[ii] - '0');
+  }
+  int  flags  = 0;
+  if (sys == 'E') { // I/NAV
+    flags = 1;
+  }
+  _epoch->_sats.push_back(t_rtnetSat());
+  t_rtnetSat& sat = _epoch->_sats.back();
+  sat._prn.set(sys, number, flags);
+  parseSatellite(pos, end, sat);
+}
+
+// Corrections of one satellite
+////////////////////////////////////////////////////////////////////////////
+void bncRtnetParser::parseSatellite(const char*& pos, const char* end,
+                                    t_rtnetSat& sat) {
+  const char* tok;
+  int         len;
+  while (nextToken(pos, end, tok, len)) {
+    QByteArray key = QByteArray::fromRawData(tok, len);
+    double     hlp;
+    if (!nextDouble(pos, end, hlp)) {
+      break;
+    }
+    int numVal = int(hlp);
+    if      (key == "APC") {
+      if (!nextVector(pos, end, numVal, sat._APC)) break;
+    }
+    else if (key == "Clk") {
+      for (int ii = 0; ii < numVal; ii++) {
+        if (!nextDouble(pos, end, hlp)) return;
+        if (ii == 0 && numVal == 1) {
+          sat._clk = hlp;
+        }
+      }
+    }
+    else if (key == "Vel") {
+      if (!nextVector(pos, end, numVal, sat._vel)) break;
+    }
+    else if (key == "CoM") {
+      if (!nextVector(pos, end, numVal, sat._CoM)) break;
+    }
+    else if (key == "CodeBias") {
+      for (int ii = 0; ii < numVal; ii++) {
+        if (!nextToken(pos, end, tok, len) || !nextDouble(pos, end, hlp)) return;
+        sat._codeBiases[QString::fromLatin1(tok, len)] = hlp;
+      }
+    }
+    else if (key == "YawAngle") {
+      if (!nextDouble(pos, end, sat._pbSat.yawAngle)) break;
+      if      (sat._pbSat.yawAngle < 0.0) {
+        sat._pbSat.yawAngle += (2*M_PI);
+      }
+      else if (sat._pbSat.yawAngle > 2*M_PI) {
+        sat._pbSat.yawAngle -= (2*M_PI);
+      }
+    }
+    else if (key == "YawRate") {
+      if (!nextDouble(pos, end, sat._pbSat.yawRate)) break;
+    }
+    else if (key == "PhaseBias") {
+      for (int ii = 0; ii < numVal; ii++) {
+        phaseBiasSignal pb;
+        double integer, wl, disc;
+        if (!nextToken(pos, end, tok, len) || !nextDouble(pos, end, pb.bias) ||
+            !nextDouble(pos, end, integer) || !nextDouble(pos, end, wl)  ||
+            !nextDouble(pos, end, disc)) {
+          return;
+        }
+        pb.type                 = QString::fromLatin1(tok, len);
+        pb.integerIndicator     = unsigned(integer);
+        pb.wlIndicator          = unsigned(wl);
+        pb.discontinuityCounter = unsigned(disc);
+        sat._phaseBiases.append(pb);
+      }
+    }
+    else {
+      for (int ii = 0; ii < numVal; ii++) {
+        if (!nextToken(pos, end, tok, len)) return;
+      }
+    }
+  }
+}
+
+// Ionosphere (spherical harmonics of up to CLOCKORBIT_NUMIONOLAYERS layers)
+////////////////////////////////////////////////////////////////////////////
+void bncRtnetParser::parseVtec(const char*& pos, const char* end) {
+
+  struct VTEC& vtec = _epoch->_vtec;
+
+  double ui, numLayers;
+  if (!nextDouble(pos, end, ui) || !nextDouble(pos, end, numLayers) ||
+      numLayers < 0 || numLayers > CLOCKORBIT_NUMIONOLAYERS) {
+    return;
+  }
+  _epoch->_vtecUpdateInt = ui;
+
+  unsigned nLayers = unsigned(numLayers);
+  for (unsigned ll = 0; ll < nLayers; ll++) {
+    struct VTEC::IonoLayers& layer = vtec.Layers[ll];
+    double dummy, degree, order;
+    if (!nextDouble(pos, end, dummy)  || !nextDouble(pos, end, degree) ||
+        !nextDouble(pos, end, order)  || !nextDouble(pos, end, layer.Height) ||
+        degree < 0 || degree >= CLOCKORBIT_MAXIONODEGREE ||
+        order  < 0 || order  >= CLOCKORBIT_MAXIONOORDER) {
+      return;
+    }
+    layer.Degree = unsigned(degree);
+    layer.Order  = unsigned(order);
+    for (unsigned iDeg = 0; iDeg <= layer.Degree; iDeg++) {
+      for (unsigned iOrd = 0; iOrd <= layer.Order; iOrd++) {
+        if (!nextDouble(pos, end, layer.Cosinus[iDeg][iOrd])) return;
+      }
+    }
+    for (unsigned iDeg = 0; iDeg <= layer.Degree; iDeg++) {
+      for (unsigned iOrd = 0; iOrd <= layer.Order; iOrd++) {
+        if (!nextDouble(pos, end, layer.Sinus[iDeg][iOrd])) return;
+      }
+    }
+  }
+  vtec.NumLayers = nLayers;
+}
@@ -0,0 +1,107 @@
+// Part of BNC, a utility for retrieving decoding and
+// converting GNSS data streams from NTRIP broadcasters.
+//
+// Copyright (C) 2007
+// German Federal Agency for Cartography and Geodesy (BKG)
+// http://www.bkg.bund.de
+// Czech Technical University Prague, Department of Geodesy
+// http://www.fsv.cvut.cz
+//
+// Email: euref-ip@bkg.bund.de
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef BNCRTNETPARSER_H
+#define BNCRTNETPARSER_H
+
+#include <vector>
+#include <QtCore>
+#include <newmat.h>
+#include "bnctime.h"
+#include "t_prn.h"
+extern "C" {
+#include "clock_orbit_rtcm.h"
+}
+
+struct phaseBiasesSat {
+  phaseBiasesSat() {
+    yawAngle = 0.0;
+    yawRate = 0.0;
+  }
+  double yawAngle;
+  double yawRate;
+};
+
+struct phaseBiasSignal {
+  phaseBiasSignal() {
+    bias      = 0.0;
+    integerIndicator     = 0;
+    wlIndicator          = 0;
+    discontinuityCounter = 0;
+  }
+  QString type;
+  double bias;
+  unsigned int integerIndicator;
+  unsigned int wlIndicator;
+  unsigned int discontinuityCounter;
+};
+
+// Corrections of one satellite as received from RTNet
+////////////////////////////////////////////////////////////////////////////
+class t_rtnetSat {
+ public:
+  t_rtnetSat() : _clk(0.0) {}
+  t_prn                  _prn;
+  ColumnVector           _APC;          // empty if not received
+  double                 _clk;
+  ColumnVector           _vel;
+  ColumnVector           _CoM;
+  QMap<QString, double>  _codeBiases;
+  QList<phaseBiasSignal> _phaseBiases;
+  phaseBiasesSat         _pbSat;
+};
+
+// One complete RTNet epoch (shared read-only by all upload casters)
+////////////////////////////////////////////////////////////////////////////
+class t_rtnetEpoch {
+ public:
+  t_rtnetEpoch();
+  bncTime                 _time;
+  unsigned                _dispersiveBiasConsistencyIndicator;
+  unsigned                _mwConsistencyIndicator;
+  double                  _vtecUpdateInt;   // VTEC update interval [s]
+  struct VTEC             _vtec;            // NumLayers and Layers only
+  std::vector<t_rtnetSat> _sats;
+  unsigned                _numLines;        // lines following the epoch line
+};
+
+// Incremental parser of the RTNet (SP3-like) stream
+////////////////////////////////////////////////////////////////////////////
+class bncRtnetParser {
+ public:
+  bncRtnetParser();
+  ~bncRtnetParser();
+  void input(const char* buffer, int bufLen,
+             QList<QSharedPointer<const t_rtnetEpoch> >& epochs);
+
+ private:
+  void parseLine(QList<QSharedPointer<const t_rtnetEpoch> >& epochs);
+  void parseSatellite(const char*& pos, const char* end, t_rtnetSat& sat);
+  void parseVtec(const char*& pos, const char* end);
+
+  QByteArray                    _line;    // current (incomplete) line
+  QSharedPointer<t_rtnetEpoch>  _epoch;   // epoch being assembled
+};
+
+#endif
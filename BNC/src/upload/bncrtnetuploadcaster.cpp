@@ -15,6 +15,7 @@
  * -----------------------------------------------------------------------*/
 
 #include <math.h>
+#include <string.h>
 #include "bncrtnetuploadcaster.h"
 #include "bncsettings.h"
 #include "bncephuser.h"
@@ -24,6 +25,37 @@
 
 using namespace std;
 
+// Orbit and clock corrections of one satellite (runs in the satellite
+// thread pool, writes into the slot reserved in struct ClockOrbit)
+////////////////////////////////////////////////////////////////////////////
+class bncRtnetUploadCaster::t_satTask : public QRunnable {
+ public:
+  t_satTask(const bncRtnetUploadCaster* caster) {
+    _caster   = caster;
+    _sat      = 0;
+    _sd       = 0;
+    _GPSweek  = 0;
+    _GPSweeks = 0.0;
+    _sp3Clk   = 0.0;
+    _xB.ReSize(4); _xB = 0.0;
+    _vB.ReSize(3); _vB = 0.0;
+    setAutoDelete(false);
+  }
+  virtual void run() {
+    _caster->computeSatellite(this);
+  }
+  const bncRtnetUploadCaster* _caster;
+  QSharedPointer<const t_eph> _eph;
+  const t_rtnetSat*           _sat;
+  QString                     _prn;
+  int                         _GPSweek;
+  double                      _GPSweeks;
+  struct ClockOrbit::SatData* _sd;
+  double                      _sp3Clk;   // clock for clock RINEX and SP3 [s]
+  ColumnVector                _xB;       // broadcast position and clock
+  ColumnVector                _vB;       // broadcast velocity
+};
+
 // Constructor
 ////////////////////////////////////////////////////////////////////////////
 bncRtnetUploadCaster::bncRtnetUploadCaster(const QString& mountpoint,
@@ -74,7 +106,7 @@ bncRtnetUploadCaster::bncRtnetUploadCaster(const QString& mountpoint,
     _usedEph = 0;
   }
   else {
-    _usedEph = new QMap<QString, const t_eph*>;
+    _usedEph = new QMap<QString, QSharedPointer<const t_eph> >;
   }
 
   // RINEX writer
@@ -237,62 +269,24 @@ bncRtnetUploadCaster::~bncRtnetUploadCaster() {
   delete _sp3;
   delete _ephUser;
   delete _usedEph;
+  qDeleteAll(_satTasks);
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
+void bncRtnetUploadCaster::decodeRtnetEpoch(QSharedPointer<const t_rtnetEpoch> epoch,
+                                            QThreadPool* pool) {
 
   QMutexLocker locker(&_mutex);
 
-  // Append to internal buffer
-  // -------------------------
-  _rtnetStreamBuffer.append(QByteArray(buffer, bufLen));
-
-  // Select buffer part that contains last epoch
-  // -------------------------------------------
-  QStringList lines;
-  int iEpoBeg = _rtnetStreamBuffer.lastIndexOf('*');   // begin of last epoch
-  if (iEpoBeg == -1) {
-    _rtnetStreamBuffer.clear();
-    return;
-  }
-  int iEpoBegEarlier = _rtnetStreamBuffer.indexOf('*');
-  if (iEpoBegEarlier != -1 && iEpoBegEarlier < iEpoBeg) { // are there two epoch lines in buffer?
-    _rtnetStreamBuffer = _rtnetStreamBuffer.mid(iEpoBegEarlier);
-  }
-  else {
-    _rtnetStreamBuffer = _rtnetStreamBuffer.mid(iEpoBeg);
-  }
-
-  int iEpoEnd = _rtnetStreamBuffer.lastIndexOf("EOE"); // end   of last epoch
-  if (iEpoEnd == -1) {
-    return;
-  }
-  else {
-    lines = _rtnetStreamBuffer.left(iEpoEnd).split('\n',
-        QString::SkipEmptyParts);
-    _rtnetStreamBuffer = _rtnetStreamBuffer.mid(iEpoEnd + 3);
-  }
-
-  if (lines.size() < 2) {
-    return;
-  }
+  QElapsedTimer latency;
+  latency.start();
 
-  // Read first line (with epoch time)
-  // ---------------------------------
-  QTextStream in(lines[0].toLatin1());
-  QString hlp;
-  int year, month, day, hour, min;
-  double sec;
-  in >> hlp >> year >> month >> day >> hour >> min >> sec;
-  bncTime epoTime;
-  epoTime.set(year, month, day, hour, min, sec);
-
-  emit(newMessage(
-      "bncRtnetUploadCaster: decode " + QByteArray(epoTime.datestr().c_str())
-          + " " + QByteArray(epoTime.timestr().c_str()) + " "
-          + _casterID.toLatin1(), false));
+  // Epoch time
+  // ----------
+  const bncTime& epoTime = epoch->_time;
+  unsigned int year, month, day;
+  epoTime.civil_date(year, month, day);
 
   struct ClockOrbit co;
   memset(&co, 0, sizeof(co));
@@ -324,8 +318,8 @@ void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
 
   struct PhaseBias phasebias;
   memset(&phasebias, 0, sizeof(phasebias));
-  unsigned int dispersiveBiasConsistenyIndicator = 0;
-  unsigned int mwConsistencyIndicator = 0;
+  unsigned int dispersiveBiasConsistenyIndicator = epoch->_dispersiveBiasConsistencyIndicator;
+  unsigned int mwConsistencyIndicator = epoch->_mwConsistencyIndicator;
   phasebias.EpochTime[CLOCKORBIT_SATGPS] = co.EpochTime[CLOCKORBIT_SATGPS];
   phasebias.EpochTime[CLOCKORBIT_SATGLONASS] = co.EpochTime[CLOCKORBIT_SATGLONASS];
   phasebias.EpochTime[CLOCKORBIT_SATGALILEO] = co.EpochTime[CLOCKORBIT_SATGALILEO];
@@ -336,8 +330,10 @@ void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
   phasebias.SSRProviderID = _PID;
   phasebias.SSRSolutionID = _SID;
 
-  struct VTEC vtec;
-  memset(&vtec, 0, sizeof(vtec));
+  struct VTEC vtec = epoch->_vtec;
+  if (vtec.NumLayers > 0) {
+    vtec.UpdateInterval = (unsigned int) determineUpdateInd(epoch->_vtecUpdateInt);
+  }
   vtec.EpochTime = static_cast<int>(epoTime.gpssec());
   vtec.SSRIOD = _IOD;
   vtec.SSRProviderID = _PID;
@@ -362,59 +358,17 @@ void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
   bias.UpdateInterval = clkUpdInd;
   phasebias.UpdateInterval = clkUpdInd;
 
-  for (int ii = 1; ii < lines.size(); ii++) {
-    QString key;  // prn or key VTEC, IND (phase bias indicators)
-    ColumnVector rtnAPC;
-    ColumnVector rtnVel;
-    ColumnVector rtnCoM;
-    double rtnClk;
-    t_prn prn;
-
-    QTextStream in(lines[ii].toLatin1());
-
-    in >> key;
+  int numTasks = 0;
 
-    // non-satellite specific parameters
-    if (key.contains("IND", Qt::CaseSensitive)) {
-      in >> dispersiveBiasConsistenyIndicator >> mwConsistencyIndicator;
-      continue;
-    }
-    // non-satellite specific parameters
-    if (key.contains("VTEC", Qt::CaseSensitive)) {
-      double ui;
-      in >> ui >> vtec.NumLayers;
-      vtec.UpdateInterval = (unsigned int) determineUpdateInd(ui);
-      for (unsigned ll = 0; ll < vtec.NumLayers; ll++) {
-        int dummy;
-        in >> dummy >> vtec.Layers[ll].Degree >> vtec.Layers[ll].Order
-            >> vtec.Layers[ll].Height;
-        for (unsigned iDeg = 0; iDeg <= vtec.Layers[ll].Degree; iDeg++) {
-          for (unsigned iOrd = 0; iOrd <= vtec.Layers[ll].Order; iOrd++) {
-            in >> vtec.Layers[ll].Cosinus[iDeg][iOrd];
-          }
-        }
-        for (unsigned iDeg = 0; iDeg <= vtec.Layers[ll].Degree; iDeg++) {
-          for (unsigned iOrd = 0; iOrd <= vtec.Layers[ll].Order; iOrd++) {
-            in >> vtec.Layers[ll].Sinus[iDeg][iOrd];
-          }
-        }
-      }
-      continue;
-    }
-    // satellite specific parameters
-    char sys = key.mid(0, 1).at(0).toLatin1();
-    int number = key.mid(1, 2).toInt();
-    int flags = 0;
-    if (sys == 'E') { // I/NAV
-      flags = 1;
-    }
-    prn.set(sys, number, flags);
+  for (unsigned iSat = 0; iSat < epoch->_sats.size(); iSat++) {
+    const t_rtnetSat& sat = epoch->_sats[iSat];
+    const t_prn&      prn = sat._prn;
     QString prnInternalStr = QString::fromStdString(prn.toInternalString());
     QString prnStr = QString::fromStdString(prn.toString());
 
-    const t_eph* ephLast = _ephUser->ephLast(prnInternalStr);
-    const t_eph* ephPrev = _ephUser->ephPrev(prnInternalStr);
-    const t_eph* eph = ephLast;
+    QSharedPointer<const t_eph> ephLast = _ephUser->ephLast(prn);
+    QSharedPointer<const t_eph> ephPrev = _ephUser->ephPrev(prn);
+    QSharedPointer<const t_eph> eph     = ephLast;
     if (eph) {
 
       // Use previous ephemeris if the last one is too recent
@@ -432,9 +386,9 @@ void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
           (*_usedEph)[prnInternalStr] = eph;
         }
         else {
-          eph = 0;
+          eph.clear();
           if (_usedEph->contains(prnInternalStr)) {
-            const t_eph* usedEph = _usedEph->value(prnInternalStr);
+            QSharedPointer<const t_eph> usedEph = _usedEph->value(prnInternalStr);
             if (usedEph == ephLast) {
               eph = ephLast;
             }
@@ -448,117 +402,31 @@ void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
 
     if (eph) {
 
-      QMap<QString, double> codeBiases;
-      QList<phaseBiasSignal> phaseBiasList;
-      phaseBiasesSat pbSat;
-
-      while (true) {
-        QString key;
-        int numVal = 0;
-        in >> key;
-        if (in.status() != QTextStream::Ok) {
-          break;
-        }
-        if (key == "APC") {
-          in >> numVal;
-          rtnAPC.ReSize(3);
-          for (int ii = 0; ii < numVal; ii++) {
-            in >> rtnAPC[ii];
-          }
-        }
-        else if (key == "Clk") {
-          in >> numVal;
-          if (numVal == 1)
-            in >> rtnClk;
+      const QMap<QString, double>&  codeBiases    = sat._codeBiases;
+      const QList<phaseBiasSignal>& phaseBiasList = sat._phaseBiases;
+      const phaseBiasesSat&         pbSat         = sat._pbSat;
+
+      const ColumnVector& rtnCrd = _CoM ? sat._CoM : sat._APC;
+      if (rtnCrd.Nrows() != 3 || sat._vel.Nrows() != 3) {
+        // reported once until the orbit of the satellite is complete again
+        if (!_incompleteOrbit.contains(prnStr)) {
+          _incompleteOrbit.insert(prnStr);
+          emit(newMessage("bncRtnetUploadCaster: incomplete orbit " +
+                          prnStr.toLatin1() + " " + _casterID.toLatin1(), false));
         }
-        else if (key == "Vel") {
-          rtnVel.ReSize(3);
-          in >> numVal;
-          for (int ii = 0; ii < numVal; ii++) {
-            in >> rtnVel[ii];
-          }
-        }
-        else if (key == "CoM") {
-          rtnCoM.ReSize(3);
-          in >> numVal;
-          for (int ii = 0; ii < numVal; ii++) {
-            in >> rtnCoM[ii];
-          }
-        }
-        else if (key == "CodeBias") {
-          in >> numVal;
-          for (int ii = 0; ii < numVal; ii++) {
-            QString type;
-            double value;
-            in >> type >> value;
-            codeBiases[type] = value;
-          }
-        }
-        else if (key == "YawAngle") {
-          in >> numVal >> pbSat.yawAngle;
-          if      (pbSat.yawAngle < 0.0) {
-            pbSat.yawAngle += (2*M_PI);
-          }
-          else if (pbSat.yawAngle > 2*M_PI) {
-            pbSat.yawAngle -= (2*M_PI);
-          }
-        }
-        else if (key == "YawRate") {
-          in >> numVal >> pbSat.yawRate;
-        }
-        else if (key == "PhaseBias") {
-          in >> numVal;
-          for (int ii = 0; ii < numVal; ii++) {
-            phaseBiasSignal pb;
-            in >> pb.type >> pb.bias >> pb.integerIndicator
-              >> pb.wlIndicator >> pb.discontinuityCounter;
-            phaseBiasList.append(pb);
-          }
-        }
-        else {
-          in >> numVal;
-          for (int ii = 0; ii < numVal; ii++) {
-            double dummy;
-            in >> dummy;
-          }
-        }
-      }
-
-      struct ClockOrbit::SatData* sd = 0;
-      if (prn.system() == 'G') {
-        sd = co.Sat + co.NumberOfSat[CLOCKORBIT_SATGPS];
-        ++co.NumberOfSat[CLOCKORBIT_SATGPS];
-      }
-      else if (prn.system() == 'R') {
-        sd = co.Sat + CLOCKORBIT_NUMGPS + co.NumberOfSat[CLOCKORBIT_SATGLONASS];
-        ++co.NumberOfSat[CLOCKORBIT_SATGLONASS];
-      }
-      else if (prn.system() == 'E') {
-        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
-            + co.NumberOfSat[CLOCKORBIT_SATGALILEO];
-        ++co.NumberOfSat[CLOCKORBIT_SATGALILEO];
-      }
-      else if (prn.system() == 'J') {
-        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
-            + CLOCKORBIT_NUMGALILEO + co.NumberOfSat[CLOCKORBIT_SATQZSS];
-        ++co.NumberOfSat[CLOCKORBIT_SATQZSS];
       }
-      else if (prn.system() == 'S') {
-        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
-            + CLOCKORBIT_NUMGALILEO + CLOCKORBIT_NUMQZSS
-            + co.NumberOfSat[CLOCKORBIT_SATSBAS];
-        ++co.NumberOfSat[CLOCKORBIT_SATSBAS];
-      }
-      else if (prn.system() == 'C') {
-        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
-            + CLOCKORBIT_NUMGALILEO + CLOCKORBIT_NUMQZSS + CLOCKORBIT_NUMSBAS
-            + co.NumberOfSat[CLOCKORBIT_SATBDS];
-        ++co.NumberOfSat[CLOCKORBIT_SATBDS];
-      }
-      if (sd) {
-        QString outLine;
-        processSatellite(eph, epoTime.gpsw(), epoTime.gpssec(), prnStr, rtnAPC,
-            rtnClk, rtnVel, rtnCoM, sd, outLine);
+      else if (prn.system() != '\0' && strchr("GREJSC", prn.system())) {
+        _incompleteOrbit.remove(prnStr);
+        if (numTasks == _satTasks.size()) {
+          _satTasks.push_back(new t_satTask(this));
+        }
+        t_satTask* task = _satTasks[numTasks++];
+        task->_eph      = eph;
+        task->_sat      = &sat;
+        task->_prn      = prnStr;
+        task->_GPSweek  = epoTime.gpsw();
+        task->_GPSweeks = epoTime.gpssec();
+        task->_sd       = 0;
       }
 
       // Code Biases
@@ -2091,6 +1959,101 @@ void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
     }
   }
 
+  // Broadcast orbits and clocks of all satellites at once
+  // -----------------------------------------------------
+  if (numTasks > 0) {
+    _ephBatch.clear();
+    for (int iTask = 0; iTask < numTasks; iTask++) {
+      _ephBatch.add(_satTasks[iTask]->_eph.data());
+    }
+    vector<double> xx(numTasks), yy(numTasks), zz(numTasks), clk(numTasks);
+    vector<double> vx(numTasks), vy(numTasks), vz(numTasks);
+    vector<t_irc>  irc(numTasks);
+    _ephBatch.getCrd(epoTime, &xx[0], &yy[0], &zz[0], &clk[0],
+                     &vx[0], &vy[0], &vz[0], &irc[0]);
+    int numOK = 0;
+    for (int iTask = 0; iTask < numTasks; iTask++) {
+
+      // Satellites without broadcast orbit are skipped, the other tasks
+      // keep their order
+      // ----------------------------------------------------------------
+      if (irc[iTask] != success) {
+        continue;
+      }
+      t_satTask* task = _satTasks[iTask];
+      task->_xB[0] = xx[iTask]; task->_xB[1] = yy[iTask];
+      task->_xB[2] = zz[iTask]; task->_xB[3] = clk[iTask];
+      task->_vB[0] = vx[iTask]; task->_vB[1] = vy[iTask]; task->_vB[2] = vz[iTask];
+
+      // Slot in struct ClockOrbit
+      // -------------------------
+      const t_prn& prn = task->_sat->_prn;
+      struct ClockOrbit::SatData* sd = 0;
+      if      (prn.system() == 'G') {
+        sd = co.Sat + co.NumberOfSat[CLOCKORBIT_SATGPS];
+        ++co.NumberOfSat[CLOCKORBIT_SATGPS];
+      }
+      else if (prn.system() == 'R') {
+        sd = co.Sat + CLOCKORBIT_NUMGPS + co.NumberOfSat[CLOCKORBIT_SATGLONASS];
+        ++co.NumberOfSat[CLOCKORBIT_SATGLONASS];
+      }
+      else if (prn.system() == 'E') {
+        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
+            + co.NumberOfSat[CLOCKORBIT_SATGALILEO];
+        ++co.NumberOfSat[CLOCKORBIT_SATGALILEO];
+      }
+      else if (prn.system() == 'J') {
+        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
+            + CLOCKORBIT_NUMGALILEO + co.NumberOfSat[CLOCKORBIT_SATQZSS];
+        ++co.NumberOfSat[CLOCKORBIT_SATQZSS];
+      }
+      else if (prn.system() == 'S') {
+        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
+            + CLOCKORBIT_NUMGALILEO + CLOCKORBIT_NUMQZSS
+            + co.NumberOfSat[CLOCKORBIT_SATSBAS];
+        ++co.NumberOfSat[CLOCKORBIT_SATSBAS];
+      }
+      else if (prn.system() == 'C') {
+        sd = co.Sat + CLOCKORBIT_NUMGPS + CLOCKORBIT_NUMGLONASS
+            + CLOCKORBIT_NUMGALILEO + CLOCKORBIT_NUMQZSS + CLOCKORBIT_NUMSBAS
+            + co.NumberOfSat[CLOCKORBIT_SATBDS];
+        ++co.NumberOfSat[CLOCKORBIT_SATBDS];
+      }
+      task->_sd = sd;
+      _satTasks[iTask]   = _satTasks[numOK];
+      _satTasks[numOK++] = task;
+    }
+    numTasks = numOK;
+  }
+
+  // Orbit and clock corrections in parallel on the pool of the decoder
+  // (the casters are called one after the other)
+  // ------------------------------------------------------------------
+  if (numTasks > 1 && pool->maxThreadCount() > 1) {
+    for (int iTask = 0; iTask < numTasks; iTask++) {
+      pool->start(_satTasks[iTask]);
+    }
+    pool->waitForDone();
+  }
+  else {
+    for (int iTask = 0; iTask < numTasks; iTask++) {
+      _satTasks[iTask]->run();
+    }
+  }
+
+  // Clock RINEX and SP3 output in the original satellite order
+  // ----------------------------------------------------------
+  for (int iTask = 0; iTask < numTasks; iTask++) {
+    const t_satTask* task = _satTasks[iTask];
+    if (_rnx) {
+      _rnx->write(task->_GPSweek, task->_GPSweeks, task->_prn, task->_sp3Clk);
+    }
+    if (_sp3) {
+      _sp3->write(task->_GPSweek, task->_GPSweeks, task->_prn, task->_sat->_CoM,
+                  task->_sp3Clk);
+    }
+  }
+
   QByteArray hlpBufferCo;
 
   // Orbit and Clock Corrections together
@@ -2268,24 +2231,34 @@ void bncRtnetUploadCaster::decodeRtnetStream(char* buffer, int bufLen) {
 
   _outBuffer += hlpBufferCo + hlpBufferBias + hlpBufferPhaseBias
       + hlpBufferVtec;
+
+  emit(newMessage(
+      "bncRtnetUploadCaster: decode " + QByteArray(epoTime.datestr().c_str())
+          + " " + QByteArray(epoTime.timestr().c_str()) + " "
+          + _casterID.toLatin1()
+          + QString(" %1 sat %2 ms").arg(numTasks)
+                .arg(latency.nsecsElapsed() * 1.e-6, 0, 'f', 1).toLatin1(), false));
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
-void bncRtnetUploadCaster::processSatellite(const t_eph* eph, int GPSweek,
-    double GPSweeks, const QString& prn, const ColumnVector& rtnAPC,
-    double rtnClk, const ColumnVector& rtnVel, const ColumnVector& rtnCoM,
-    struct ClockOrbit::SatData* sd, QString& outLine) {
+void bncRtnetUploadCaster::computeSatellite(t_satTask* task) const {
+
+  const t_eph*        eph      = task->_eph.data();
+  const t_rtnetSat*   sat      = task->_sat;
+  int                 GPSweek  = task->_GPSweek;
+  double              GPSweeks = task->_GPSweeks;
+  const ColumnVector& rtnVel   = sat->_vel;
+  double              rtnClk   = sat->_clk;
 
-  // Broadcast Position and Velocity
-  // -------------------------------
-  ColumnVector xB(4);
-  ColumnVector vB(3);
-  eph->getCrd(bncTime(GPSweek, GPSweeks), xB, vB, false);
+  // Broadcast Position and Velocity (evaluated for all satellites at once)
+  // ----------------------------------------------------------------------
+  const ColumnVector& xB = task->_xB;
+  const ColumnVector& vB = task->_vB;
 
   // Precise Position
   // ----------------
-  ColumnVector xP = _CoM ? rtnCoM : rtnAPC;
+  ColumnVector xP = _CoM ? sat->_CoM : sat->_APC;
 
   double dc = 0.0;
   //TODO: the following 3 lines can be activated again if all parameters are updated regarding ITRF2014
@@ -2327,8 +2300,9 @@ void bncRtnetUploadCaster::processSatellite(const t_eph* eph, int GPSweek,
   // ----------------
   double dClk = rtnClk - (xB(4) - dc) * t_CST::c;
 
+  struct ClockOrbit::SatData* sd = task->_sd;
   if (sd) {
-    sd->ID = prn.mid(1).toInt();
+    sd->ID = task->_prn.mid(1).toInt();
     sd->IOD = eph->IOD();
     sd->Clock.DeltaA0 = dClk;
     sd->Clock.DeltaA1 = 0.0; // TODO
@@ -2341,25 +2315,14 @@ void bncRtnetUploadCaster::processSatellite(const t_eph* eph, int GPSweek,
     sd->Orbit.DotDeltaCrossTrack = dotRsw(3);
   }
 
-  outLine.sprintf("%d %.1f %s  %u  %10.3f  %8.3f %8.3f %8.3f\n", GPSweek,
-      GPSweeks, eph->prn().toString().c_str(), eph->IOD(), dClk, rsw(1), rsw(2),
-      rsw(3));
-
   double relativity = -2.0 * DotProduct(xP, rtnVel) / t_CST::c;
-  double sp3Clk = (rtnClk - relativity) / t_CST::c;  // in seconds
-
-  if (_rnx) {
-    _rnx->write(GPSweek, GPSweeks, prn, sp3Clk);
-  }
-  if (_sp3) {
-    _sp3->write(GPSweek, GPSweeks, prn, rtnCoM, sp3Clk);
-  }
+  task->_sp3Clk = (rtnClk - relativity) / t_CST::c;  // in seconds
 }
 
 // Transform Coordinates
 ////////////////////////////////////////////////////////////////////////////
 void bncRtnetUploadCaster::crdTrafo(int GPSWeek, ColumnVector& xyz,
-    double& dc) {
+    double& dc) const {
 
   // Current epoch minus 2000.0 in years
   // ------------------------------------
@@ -2442,7 +2405,7 @@ void bncRtnetUploadCaster::crdTrafo(int GPSWeek, ColumnVector& xyz,
 // Transform Coordinates
 ////////////////////////////////////////////////////////////////////////////
 void bncRtnetUploadCaster::crdTrafo8(int GPSWeek, ColumnVector& xyz,
-    double& dc) {
+    double& dc) const {
 
   // Current epoch minus 2000.0 in years
   // ------------------------------------
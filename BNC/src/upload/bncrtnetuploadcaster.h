@@ -5,9 +5,7 @@
 #include "bncuploadcaster.h"
 #include "bnctime.h"
 #include "ephemeris.h"
-extern "C" {
-#include "clock_orbit_rtcm.h"
-}
+#include "bncrtnetparser.h"
 
 class bncEphUser;
 class bncoutf;
@@ -25,28 +23,21 @@ class bncRtnetUploadCaster : public bncUploadCaster {
                   const QString& sp3FileName,
                   const QString& rnxFileName,
                   int PID, int SID, int IOD, int iRow);
-  void decodeRtnetStream(char* buffer, int bufLen);
+  void decodeRtnetEpoch(QSharedPointer<const t_rtnetEpoch> epoch, QThreadPool* pool);
  protected:
   virtual ~bncRtnetUploadCaster();
  private:
-  void processSatellite(const t_eph* eph, int GPSweek,
-                        double GPSweeks, const QString& prn,
-                        const ColumnVector& rtnAPC,
-                        double rtnClk,
-                        const ColumnVector& rtnVel,
-                        const ColumnVector& rtnCoM,
-                        struct ClockOrbit::SatData* sd,
-                        QString& outLine);
-  void crdTrafo(int GPSWeek, ColumnVector& xyz, double& dc);
+  class t_satTask;
+  void computeSatellite(t_satTask* task) const;
+  void crdTrafo(int GPSWeek, ColumnVector& xyz, double& dc) const;
 
   // TODO: the following lines can be deleted if all parameters are updated regarding ITRF2014
-  void crdTrafo8(int GPSWeek, ColumnVector& xyz, double& dc);
+  void crdTrafo8(int GPSWeek, ColumnVector& xyz, double& dc) const;
 
   int determineUpdateInd(double samplingRate);
 
   QString        _casterID;
   bncEphUser*    _ephUser;
-  QString        _rtnetStreamBuffer;
   QString        _crdTrafo;
   bool           _CoM;
   int            _PID;
@@ -71,7 +62,10 @@ class bncRtnetUploadCaster : public bncUploadCaster {
   double         _t0;
   bncClockRinex* _rnx;
   bncSP3*        _sp3;
-  QMap<QString, const t_eph*>* _usedEph;
+  QMap<QString, QSharedPointer<const t_eph> >* _usedEph;
+  t_ephBatch     _ephBatch;        // broadcast orbits of the satellite tasks
+  QVector<t_satTask*> _satTasks;   // re-used from epoch to epoch
+  QSet<QString>  _incompleteOrbit; // satellites reported without orbit
   // TODO: the following lines can be deleted if all parameters are updated regarding ITRF2014
   double         _dx8;
   double         _dy8;
@@ -90,27 +84,4 @@ class bncRtnetUploadCaster : public bncUploadCaster {
   double         _t08;
 };
 
-struct phaseBiasesSat {
-  phaseBiasesSat() {
-    yawAngle = 0.0;
-    yawRate = 0.0;
-  }
-  double yawAngle;
-  double yawRate;
-};
-
-struct phaseBiasSignal {
-  phaseBiasSignal() {
-    bias      = 0.0;
-    integerIndicator     = 0;
-    wlIndicator          = 0;
-    discontinuityCounter = 0;
-  }
-  QString type;
-  double bias;
-  unsigned int integerIndicator;
-  unsigned int wlIndicator;
-  unsigned int discontinuityCounter;
-};
-
 #endif